@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui printsupport
+QT       += core gui printsupport concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -30,11 +30,32 @@ SOURCES += \
         finddialog.cpp \
     editor.cpp \
     utilityfunctions.cpp \
-    searchhistory.cpp \
     gotodialog.cpp \
     tabbededitor.cpp \
     highlighter.cpp \
-    language.cpp
+    language.cpp \
+    metricstracker.cpp \
+    textcounter.cpp \
+    fileloader.cpp \
+    streamingloader.cpp \
+    largefileviewer.cpp \
+    filesaver.cpp \
+    filefollower.cpp \
+    linediff.cpp \
+    matchindex.cpp \
+    searchpattern.cpp \
+    literalsearcher.cpp \
+    filesearch.cpp \
+    findinfilesmodel.cpp \
+    findinfilespanel.cpp \
+    multipatternsearcher.cpp \
+    watchlist.cpp \
+    watchlistdialog.cpp \
+    undohistory.cpp \
+    keywordtable.cpp \
+    lexer.cpp \
+    grammar.cpp \
+    lexcache.cpp
 
 HEADERS += \
         mainwindow.h \
@@ -43,12 +64,34 @@ HEADERS += \
     editor.h \
     linenumberarea.h \
     utilityfunctions.h \
-    searchhistory.h \
     gotodialog.h \
     tabbededitor.h \
     highlighter.h \
     language.h \
-    ui_mainwindow.h
+    ui_mainwindow.h \
+    textblockdata.h \
+    metricstracker.h \
+    textcounter.h \
+    fileloader.h \
+    streamingloader.h \
+    largefileviewer.h \
+    filesaver.h \
+    filefollower.h \
+    linediff.h \
+    matchindex.h \
+    searchpattern.h \
+    literalsearcher.h \
+    filesearch.h \
+    findinfilesmodel.h \
+    findinfilespanel.h \
+    multipatternsearcher.h \
+    watchlist.h \
+    watchlistdialog.h \
+    undohistory.h \
+    keywordtable.h \
+    lexer.h \
+    grammar.h \
+    lexcache.h
 
 FORMS += \
         mainwindow.ui
@@ -64,3 +107,6 @@ RESOURCES += \
 DISTFILES +=
 
 RC_FILE = texteditor.rc
+
+# Peak memory reporting (GetProcessMemoryInfo)
+win32: LIBS += -lpsapi
@@ -3,9 +3,10 @@
 
 struct DocumentMetrics
 {
-    DocumentMetrics() : charCount(0), wordCount(0), currentColumn(1) {}
+    DocumentMetrics() : charCount(0), wordCount(0), lineCount(1), currentColumn(1) {}
     int charCount;
     int wordCount;
+    int lineCount;
     int currentColumn;
 };
 
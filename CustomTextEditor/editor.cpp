@@ -3,12 +3,16 @@
 #include "utilityfunctions.h"
 #include <QPainter>
 #include <QTextBlock>
+#include <QScrollBar>
 #include <QFontDialog>
 #include <QTextDocumentFragment>
+#include <QContextMenuEvent>
+#include <QMenu>
 #include <QPalette>
 #include <QStack>
 #include <QSet>
 #include <QQueue>
+#include <QVector>
 #include <QtDebug>
 
 
@@ -19,17 +23,33 @@ Editor::Editor(QWidget *parent) : QPlainTextEdit (parent)
     document()->setModified(false);
     setLineWrapMode(QPlainTextEdit::LineWrapMode::NoWrap);
 
-    setProgrammingLanguage(Language::None);
     metrics = DocumentMetrics();
+    metricsTracker = new MetricsTracker(document());
+    matchIndex = new MatchIndex(document(), this);
+    watchList = new WatchList(document(), this);
+    undoHistory = new UndoHistory(document());
     lineNumberArea = new LineNumberArea(this);
 
     connect(this, SIGNAL(blockCountChanged(int)), this, SLOT(updateLineNumberAreaWidth()));
     connect(this, SIGNAL(updateRequest(QRect,int)), this, SLOT(updateLineNumberArea(QRect,int)));
     connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(on_cursorPositionChanged()));
     connect(this, SIGNAL(textChanged()), this, SLOT(on_textChanged()));
+    connect(metricsTracker, SIGNAL(metricsChanged()), this, SLOT(on_metricsChanged()));
+    connect(matchIndex, SIGNAL(updated()), this, SLOT(on_matchIndexUpdated()));
+    connect(watchList, SIGNAL(updated()), this, SLOT(on_watchListUpdated()));
+    connect(&highlightTimer, SIGNAL(timeout()), this, SLOT(updateMatchHighlights()));
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), &highlightTimer, SLOT(start()));
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(highlightVisibleBlocks()));
+    connect(undoHistory, SIGNAL(undoAvailable(bool)), this, SIGNAL(undoAvailable(bool)));
+    connect(undoHistory, SIGNAL(redoAvailable(bool)), this, SIGNAL(redoAvailable(bool)));
+    connect(undoHistory, SIGNAL(memoryUsageChanged(qint64, qint64)), this, SIGNAL(undoMemoryChanged(qint64, qint64)));
     connect(this, SIGNAL(undoAvailable(bool)), this, SLOT(setUndoAvailable(bool)));
     connect(this, SIGNAL(redoAvailable(bool)), this, SLOT(setRedoAvailable(bool)));
 
+    // Highlights are recomputed once control returns to the event loop
+    highlightTimer.setSingleShot(true);
+    highlightTimer.setInterval(0);
+
     installEventFilter(this);
     updateLineNumberAreaWidth();
     on_cursorPositionChanged();
@@ -40,6 +60,7 @@ Editor::Editor(QWidget *parent) : QPlainTextEdit (parent)
  */
 Editor::~Editor()
 {
+    delete metricsTracker;
     delete lineNumberArea;
     delete syntaxHighlighter;
 }
@@ -52,7 +73,38 @@ void Editor::reset()
     metricCalculationEnabled = true;
     currentFilePath.clear();
     document()->setModified(false);
+
+    // Like loading a file, starting over isn't something the user should be able to undo
+    undoHistory->suspend();
     setPlainText(QString());
+    undoHistory->resume();
+}
+
+
+/* Undoes the most recent edit, or run of typing, and moves the cursor to where it was made.
+ * The document keeps no undo history of its own; see UndoHistory.
+ */
+void Editor::undo()
+{
+    int position = undoHistory->undo();
+
+    if(position >= 0)
+    {
+        moveCursorTo(position);
+    }
+}
+
+
+/* Redoes the most recently undone edit and moves the cursor to where it was made.
+ */
+void Editor::redo()
+{
+    int position = undoHistory->redo();
+
+    if(position >= 0)
+    {
+        moveCursorTo(position);
+    }
 }
 
 
@@ -130,27 +182,24 @@ void Editor::setProgrammingLanguage(Language language)
         return;
     }
 
+    // The old highlighter clears its formats as it goes
+    delete syntaxHighlighter;
+
     this->programmingLanguage = language;
     this->syntaxHighlighter = generateHighlighterFor(language);
+    highlightVisibleBlocks();
 }
 
 
-/* Returns a Highlighter corresponding to the given language.
+/* Returns a Highlighter corresponding to the given language, or a null pointer if the
+ * language isn't highlighted. Its grammar is shared with every other tab of that language.
  * @param language - the programming language for which a
  * syntax highlighter should be generated
  */
 Highlighter *Editor::generateHighlighterFor(Language language)
 {
-    QTextDocument *doc = document();
-
-    switch (language)
-    {
-        case(Language::C): return cHighlighter(doc);
-        case(Language::CPP): return cppHighlighter(doc);
-        case(Language::Java): return javaHighlighter(doc);
-        case(Language::Python): return pythonHighlighter(doc);
-        default: return nullptr;
-    }
+    QSharedPointer<const Grammar> grammar = Grammar::of(language);
+    return grammar ? new Highlighter(grammar, document()) : nullptr;
 }
 
 
@@ -173,77 +222,501 @@ QTextDocument::FindFlags Editor::getSearchOptionsFromFlags(bool caseSensitive, b
 }
 
 
-/* Called when the findDialog object emits its queryReady signal. Initiates the
- * actual searching within the editor. First searches for a match from the current
- * position to the end of the document. If nothing is found, the search proceeds
- * from the beginning of the document, but stops once it encounters the first match
- * (if any) that was found in prior iterations for the current query.
+/* Called when the findDialog object emits its startFinding signal. Selects the next
+ * match after the cursor, wrapping around to the top of the document if need be.
  * @param query - the text the user wants to search for
  * @param caseSensitive - flag denoting whether the search should heed the case of results
  * @param wholeWords - flag denoting whether the search should look for whole word matches or partials
+ * @param regex - flag denoting whether the query is a regular expression
  */
-bool Editor::find(QString query, bool caseSensitive, bool wholeWords)
+bool Editor::find(QString query, bool caseSensitive, bool wholeWords, bool regex)
 {
-    // Keep track of the cursor position prior to this search so we can return to it if no match is found
-    int cursorPositionBeforeCurrentSearch = textCursor().position();
+    return findMatch(patternFor(query, caseSensitive, wholeWords, regex), true);
+}
 
-    // Specify the options we'll be searching with
-    QTextDocument::FindFlags searchOptions = getSearchOptionsFromFlags(caseSensitive, wholeWords);
 
-    // Search from the current position until the end of the document
-    bool matchFound = QPlainTextEdit::find(query, searchOptions);
+/* Called when the findDialog object emits its startFindingPrevious signal. Selects the
+ * last match before the cursor, wrapping around to the bottom of the document if need be.
+ * @param query - the text the user wants to search for
+ * @param caseSensitive - flag denoting whether the search should heed the case of results
+ * @param wholeWords - flag denoting whether the search should look for whole word matches or partials
+ * @param regex - flag denoting whether the query is a regular expression
+ */
+bool Editor::findPrevious(QString query, bool caseSensitive, bool wholeWords, bool regex)
+{
+    return findMatch(patternFor(query, caseSensitive, wholeWords, regex), false);
+}
 
-    // If we didn't find a match, search from the top of the document
-    if(!matchFound)
+
+/* Called as the user types in FindDialog. Selects the first match at or after where the
+ * cursor was when the user started typing, wrapping around to the top if need be, so the
+ * selection follows the query as it grows or shrinks. Misses aren't announced with a
+ * message; the match count shows them instead. Only the match index is consulted, so no
+ * keystroke searches the whole document; if the index isn't ready yet, the match is
+ * selected once it is.
+ * @param query - the text the user has typed so far
+ * @param caseSensitive - flag denoting whether the search should heed the case of results
+ * @param wholeWords - flag denoting whether the search should look for whole word matches or partials
+ * @param regex - flag denoting whether the query is a regular expression
+ */
+void Editor::findIncrementally(QString query, bool caseSensitive, bool wholeWords, bool regex)
+{
+    // Only an emptied query moves the cursor back; with no query yet, there's nothing to undo
+    if(query.isEmpty() && incrementalSearchStart < 0)
+    {
+        return;
+    }
+
+    if(incrementalSearchStart < 0)
     {
-        moveCursor(QTextCursor::Start);
-        matchFound = QPlainTextEdit::find(query, searchOptions);
+        incrementalSearchStart = textCursor().selectionStart();
     }
 
-    // If we found a match...
-    if(matchFound)
+    const SearchPattern &pattern = patternFor(query, caseSensitive, wholeWords, regex);
+    bool searchable = !pattern.isEmpty() && pattern.isValid();
+    SearchPattern::Match match = {-1, 0};
+    highlightSearch(searchable);
+
+    if(searchable)
     {
-        int foundPosition = textCursor().position();
-        bool previouslyFound = searchHistory.previouslyFound(query);
+        matchIndex->setPattern(pattern);
+        resetSearchChain();
+        match = incrementalMatch();
+    }
+
+    awaitingIncrementalMatch = searchable && match.position < 0 && !matchIndex->isReady();
+    selectIncrementalMatch(match);
 
-        // If it's the first time finding this, log the first position at which this query was found in the current document state
-        // Search history is always reset whenever we do a full cycle back to the first match or start a new search "chain"
-        if(!previouslyFound)
+    if(searchable)
+    {
+        updateMatchCount();
+    }
+}
+
+
+/* Returns the match an incremental search selects: the first one at or after where the
+ * search started, or else the first in the document. While the index is being refined,
+ * some of the old matches stand in for it; otherwise, until it's ready, there's none.
+ */
+SearchPattern::Match Editor::incrementalMatch()
+{
+    SearchPattern::Match match = {-1, 0};
+
+    if(matchIndex->isReady())
+    {
+        match = matchIndex->nextMatch(incrementalSearchStart);
+        if(match.position < 0)
         {
-            searchHistory.add(query, cursorPositionBeforeCurrentSearch, foundPosition);
+            match = matchIndex->nextMatch(0);
         }
-        // If term was previously found, check that we didn't cycle back to the first-ever find
-        else
+        return match;
+    }
+
+    match = matchIndex->nextCandidate(incrementalSearchStart);
+    if(match.position < 0)
+    {
+        match = matchIndex->nextCandidate(0);
+    }
+    return match;
+}
+
+
+/* Selects the given match of an incremental search, or puts the cursor back where the
+ * search started if there is none, without ending the search.
+ */
+void Editor::selectIncrementalMatch(const SearchPattern::Match &match)
+{
+    QTextCursor cursor = textCursor();
+    if(match.position < 0)
+    {
+        cursor.setPosition(qMin(incrementalSearchStart, document()->characterCount() - 1));
+    }
+    else
+    {
+        cursor.setPosition(match.position);
+        cursor.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+    }
+
+    selectingIncrementalMatch = true;
+    setTextCursor(cursor);
+    selectingIncrementalMatch = false;
+}
+
+
+/* Called whenever the match index changes. Selects the match an incremental search was
+ * waiting on, if any, and updates the match count.
+ */
+void Editor::on_matchIndexUpdated()
+{
+    if(awaitingIncrementalMatch && matchIndex->isReady())
+    {
+        awaitingIncrementalMatch = false;
+        selectIncrementalMatch(incrementalMatch());
+    }
+    updateMatchCount();
+}
+
+
+/* Returns the pattern for the given query and options. The last pattern is kept, so a
+ * regular expression is only compiled again when the query or its options change.
+ */
+const SearchPattern &Editor::patternFor(const QString &query, bool caseSensitive, bool wholeWords, bool regex)
+{
+    if(!searchPattern.isFor(query, caseSensitive, wholeWords, regex))
+    {
+        searchPattern = SearchPattern(query, caseSensitive, wholeWords, regex);
+    }
+    return searchPattern;
+}
+
+
+/* Does the actual searching for find and findPrevious. Consecutive searches for the same
+ * pattern in the same direction form a "chain" that starts at the cursor position of the
+ * first one. A chain may wrap around the end of the document once; when it would pass
+ * its starting point again, every match has been visited, so the user is told there are
+ * no more results and the cursor goes back to where the chain started.
+ * @param pattern - what to search for
+ * @param forward - flag denoting whether to search towards the end of the document or the start
+ */
+bool Editor::findMatch(const SearchPattern &pattern, bool forward)
+{
+    if(!pattern.isValid())
+    {
+        emit(findResultReady("Invalid regular expression: " + pattern.getErrorString()));
+        return false;
+    }
+
+    highlightSearch(true);
+
+    // A new query, new options or a change of direction starts a new chain
+    if(matchIndex->setPattern(pattern) || forward != searchChainForward)
+    {
+        resetSearchChain();
+    }
+
+    QTextCursor cursor = textCursor();
+    int from = forward ? cursor.selectionEnd() : cursor.selectionStart();
+
+    if(searchChainStart < 0)
+    {
+        searchChainStart = from;
+        searchChainForward = forward;
+    }
+
+    SearchPattern::Match match = nearestMatch(pattern, from, forward);
+    bool wrapping = match.position < 0;
+
+    // If we didn't find a match, search from the other end of the document
+    if(wrapping)
+    {
+        match = nearestMatch(pattern, forward ? 0 : document()->characterCount() - 1, forward);
+    }
+
+    if(match.position < 0)
+    {
+        resetSearchChain();
+        emit(findResultReady("No results found."));
+        return false;
+    }
+
+    bool cameFullCircle = searchChainWrapped && (wrapping || (forward ? match.position >= searchChainStart : match.position < searchChainStart));
+    if(cameFullCircle)
+    {
+        moveCursorTo(searchChainStart);
+        resetSearchChain();
+        updateMatchCount();
+
+        // Inform the user of the unsuccessful search (note the "no MORE results found")
+        emit(findResultReady("No more results found."));
+        return false;
+    }
+
+    searchChainWrapped = searchChainWrapped || wrapping;
+
+    cursor.setPosition(match.position);
+    cursor.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+    setTextCursor(cursor);
+    updateMatchCount();
+    return true;
+}
+
+
+/* Returns the first match at or after the given position (or the last one before it,
+ * searching backwards), or one with a position of -1 if there is none. Uses the match
+ * index once it's been built, and QTextDocument::find until then.
+ */
+SearchPattern::Match Editor::nearestMatch(const SearchPattern &pattern, int from, bool forward)
+{
+    if(matchIndex->isReady())
+    {
+        return forward ? matchIndex->nextMatch(from) : matchIndex->previousMatch(from);
+    }
+
+    QTextDocument::FindFlags searchOptions = getSearchOptionsFromFlags(pattern.isCaseSensitive(), pattern.isWholeWords());
+    if(!forward)
+    {
+        searchOptions |= QTextDocument::FindBackward;
+    }
+
+    QTextCursor match = pattern.isRegex() ? document()->find(pattern.getRegularExpression(), from, searchOptions)
+                                          : document()->find(pattern.getQuery(), from, searchOptions);
+    if(match.isNull())
+    {
+        return SearchPattern::Match{-1, 0};
+    }
+    return SearchPattern::Match{match.selectionStart(), match.selectionEnd() - match.selectionStart()};
+}
+
+
+/* Forgets where the current search chain started, so that the next search starts a new one.
+ */
+void Editor::resetSearchChain()
+{
+    searchChainStart = -1;
+    searchChainWrapped = false;
+}
+
+
+/* Emits matchCountReady with the number of the selected match (0 if the selection isn't
+ * a match) and the total number of matches, or -1 for the total while they're still
+ * being counted. Called after every search and whenever the match index changes.
+ */
+void Editor::updateMatchCount()
+{
+    if(!matchIndex->isReady())
+    {
+        emit(matchCountReady(0, -1));
+        return;
+    }
+
+    QTextCursor cursor = textCursor();
+    SearchPattern::Match selection = {cursor.selectionStart(), cursor.selectionEnd() - cursor.selectionStart()};
+    emit(matchCountReady(matchIndex->ordinalOf(selection), matchIndex->count()));
+}
+
+
+/* Called when the user starts watching for a list of patterns in WatchListDialog.
+ * Searches the document for all of them at once, in the background, and highlights
+ * each one's occurrences in its own color. An empty list stops watching.
+ * @param patterns - the literal patterns to watch for
+ * @param caseSensitive - flag denoting whether the search should heed the case of results
+ */
+void Editor::setWatchList(QStringList patterns, bool caseSensitive)
+{
+    watchList->setPatterns(patterns, caseSensitive);
+    highlightTimer.start();
+}
+
+
+/* Called when the user picks one of the watched patterns in WatchListDialog. Selects
+ * its next occurrence after the cursor, wrapping around to the top if need be.
+ * @param pattern - the index of the pattern in the watch list
+ */
+void Editor::findWatched(int pattern)
+{
+    QTextCursor cursor = textCursor();
+    WatchList::Match match = watchList->nextMatch(pattern, cursor.selectionEnd());
+
+    if(match.position < 0)
+    {
+        match = watchList->nextMatch(pattern, 0);
+    }
+    if(match.position < 0 || match.position + match.length > document()->characterCount() - 1)
+    {
+        return;
+    }
+
+    cursor.setPosition(match.position);
+    cursor.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+    setTextCursor(cursor);
+}
+
+
+/* Called whenever the watch list has been rescanned. Redoes the highlights and passes on
+ * the new counts.
+ */
+void Editor::on_watchListUpdated()
+{
+    highlightTimer.start();
+    emit(watchListCountsReady(watchList->getPatterns(), watchList->getCounts()));
+}
+
+
+/* Turns highlighting of the search pattern's matches on or off. While it's off, the
+ * occurrences of the word under the cursor are highlighted instead.
+ */
+void Editor::highlightSearch(bool enabled)
+{
+    searchHighlighted = enabled;
+    highlightTimer.start();
+}
+
+
+/* Called when the Find dialog is closed. Goes back to highlighting the word under the
+ * cursor, and lets the match index drop its copy of the text.
+ */
+void Editor::clearSearchHighlights()
+{
+    highlightSearch(false);
+    awaitingIncrementalMatch = false;
+    matchIndex->releaseSnapshot();
+}
+
+
+/* Recomputes the match highlights for the blocks on screen, plus highlightMarginBlocks
+ * blocks on either side so that scrolling a little doesn't uncover unhighlighted text
+ * before the next update. Blocks further away are never looked at, and in blocks longer
+ * than longBlockLength only the part on screen is, so the cost of an update depends on
+ * the size of the viewport rather than of the document. Called (via
+ * highlightTimer, so that a burst of changes is dealt with once) after scrolling,
+ * resizing, editing, and whenever the highlighted patterns change.
+ */
+void Editor::updateMatchHighlights()
+{
+    matchSelections.clear();
+
+    QTextBlock firstBlock = firstVisibleBlock();
+    for(int i = 0; i < highlightMarginBlocks && firstBlock.previous().isValid(); i++)
+    {
+        firstBlock = firstBlock.previous();
+    }
+
+    const int viewportBottom = viewport()->rect().bottom();
+    QTextBlock lastBlock = firstBlock;
+    int blocksBelowViewport = 0;
+
+    while(lastBlock.next().isValid() && blocksBelowViewport < highlightMarginBlocks)
+    {
+        if(blocksBelowViewport > 0 || blockBoundingGeometry(lastBlock).translated(contentOffset()).top() > viewportBottom)
+        {
+            blocksBelowViewport++;
+        }
+        lastBlock = lastBlock.next();
+    }
+
+    // Watch list patterns, each in its own color
+    if(!watchList->isEmpty())
+    {
+        const int documentEnd = document()->characterCount() - 1;
+
+        for(const WatchList::Match &match : watchList->matchesBetween(firstBlock.position(), lastBlock.position() + lastBlock.length()))
         {
-            bool loopedBackToFirstMatch = foundPosition == searchHistory.firstFoundAt(query);
+            // Until a rescan after an edit is done, some of the occurrences may be out of date
+            if(match.position + match.length > documentEnd)
+            {
+                break;
+            }
+
+            QTextEdit::ExtraSelection selection;
+            selection.format.setBackground(WatchList::colorFor(match.pattern));
+            selection.cursor = QTextCursor(document());
+            selection.cursor.setPosition(match.position);
+            selection.cursor.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+            matchSelections.append(selection);
 
-            if(loopedBackToFirstMatch)
+            // Long runs of matches (say, on a minified line) are cut off rather than making the editor sluggish
+            if(matchSelections.size() >= maxHighlights)
             {
-                // It's not really a match that we found; it's a repeat of the very first-ever match
-                matchFound = false;
+                break;
+            }
+        }
+    }
 
-                // Reset the cursor to its original position prior to first search for this term
-                int cursorPositionBeforeFirstSearch = searchHistory.cursorPositionBeforeFirstSearchFor(query);
-                moveCursorTo(cursorPositionBeforeFirstSearch);
+    // The search pattern, or else the word under the cursor
+    const SearchPattern &pattern = searchHighlighted ? searchPattern : wordPattern;
+    if(!pattern.isEmpty() && pattern.isValid())
+    {
+        QTextCharFormat format;
+        format.setBackground(searchHighlighted ? QColor(255, 230, 120) : QColor(Qt::lightGray).lighter(110));
+
+        for(QTextBlock block = firstBlock; block.isValid() && matchSelections.size() < maxHighlights; block = block.next())
+        {
+            int start = 0;
+            int end = block.length() - 1;
 
-                // Clear search history
-                searchHistory.clear();
+            if(block.length() > longBlockLength)
+            {
+                visibleSpan(block, &start, &end);
+            }
 
-                // Inform the user of the unsuccessful search (note the "no MORE results found")
-                emit(("No more results found."));
+            for(const SearchPattern::Match &match : pattern.findAll(block.text().mid(start, end - start), block.position() + start))
+            {
+                QTextEdit::ExtraSelection selection;
+                selection.format = format;
+                selection.cursor = QTextCursor(document());
+                selection.cursor.setPosition(match.position);
+                selection.cursor.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+                matchSelections.append(selection);
+
+                if(matchSelections.size() >= maxHighlights)
+                {
+                    break;
+                }
+            }
+
+            if(block == lastBlock)
+            {
+                break;
             }
         }
     }
-    else
+
+    refreshExtraSelections();
+}
+
+
+/* Finds the part of the given block that is on screen, widened by highlightMarginChars on
+ * either side, as offsets into the block's text. The span is empty if none of it is.
+ * @param block - the block to look at
+ * @param start - set to the offset the span starts at
+ * @param end - set to the offset just past the span
+ */
+void Editor::visibleSpan(const QTextBlock &block, int *start, int *end) const
+{
+    const QRectF geometry = blockBoundingGeometry(block).translated(contentOffset());
+    const QRect viewportRect = viewport()->rect();
+
+    // The first and last on-screen lines of the block (with no wrapping, the block's one line scrolled sideways)
+    const int top = qBound(viewportRect.top(), int(geometry.top()) + 1, viewportRect.bottom());
+    const int bottom = qBound(viewportRect.top(), int(geometry.bottom()) - 1, viewportRect.bottom());
+    const int first = cursorForPosition(QPoint(viewportRect.left(), top)).position() - block.position();
+    const int last = cursorForPosition(QPoint(viewportRect.right(), bottom)).position() - block.position();
+
+    *start = qBound(0, first - highlightMarginChars, block.length() - 1);
+    *end = qBound(*start, last + highlightMarginChars, block.length() - 1);
+}
+
+
+/* Tells the syntax highlighter which blocks are on screen, so that it highlights them
+ * before they're painted and works outward from them in the background. Unlike the match
+ * highlights, this is done right away after scrolling, resizing and editing.
+ */
+void Editor::highlightVisibleBlocks()
+{
+    if(syntaxHighlighter == nullptr)
     {
-        // Reset the cursor to its position prior to this particular search
-        moveCursorTo(cursorPositionBeforeCurrentSearch);
+        return;
+    }
 
-        // Inform the user of the unsuccessful search
-        emit(findResultReady("No results found."));
+    const QTextBlock firstBlock = firstVisibleBlock();
+    const int viewportBottom = viewport()->rect().bottom();
+    QTextBlock lastBlock = firstBlock;
+
+    while(lastBlock.next().isValid() && blockBoundingGeometry(lastBlock).translated(contentOffset()).bottom() < viewportBottom)
+    {
+        lastBlock = lastBlock.next();
     }
 
-    return matchFound;
+    syntaxHighlighter->setVisibleBlocks(firstBlock.blockNumber(), lastBlock.blockNumber());
+}
+
+
+/* Hands the current line highlight and the match highlights to QPlainTextEdit, which
+ * paints them in order, so matches stay visible on the current line.
+ */
+void Editor::refreshExtraSelections()
+{
+    setExtraSelections(currentLineSelections + matchSelections);
 }
 
 
@@ -252,14 +725,32 @@ bool Editor::find(QString query, bool caseSensitive, bool wholeWords)
  * @param with - the string with which to replace any match
  * @param caseSensitive - flag denoting whether the search should heed the case of results
  * @param wholeWords - flag denoting whether the search should look for whole word matches or partials
+ * @param regex - flag denoting whether the query is a regular expression
  */
-void Editor::replace(QString what, QString with, bool caseSensitive, bool wholeWords)
+void Editor::replace(QString what, QString with, bool caseSensitive, bool wholeWords, bool regex)
 {
-    bool found = find(what, caseSensitive, wholeWords);
+    bool found = find(what, caseSensitive, wholeWords, regex);
 
     if(found)
     {
         QTextCursor cursor = textCursor();
+
+        // Capture groups are filled in from the match in context, so that lookarounds see what they saw when it was found;
+        // a window of replaceContextChars on either side stands in for the whole document
+        if(regex)
+        {
+            const int windowStart = qMax(0, cursor.selectionStart() - replaceContextChars);
+            const int windowEnd = qMin(document()->characterCount() - 1, cursor.selectionEnd() + replaceContextChars);
+
+            QTextCursor window(document());
+            window.setPosition(windowStart);
+            window.setPosition(windowEnd, QTextCursor::KeepAnchor);
+            const QString text = window.selectedText().replace(QChar(QChar::ParagraphSeparator), QLatin1Char('\n'));
+
+            SearchPattern::Match match = {cursor.selectionStart() - windowStart, cursor.selectionEnd() - cursor.selectionStart()};
+            with = searchPattern.replacementFor(text, match, with);
+        }
+
         cursor.beginEditBlock();
         cursor.insertText(with);
         cursor.endEditBlock();
@@ -267,50 +758,78 @@ void Editor::replace(QString what, QString with, bool caseSensitive, bool wholeW
 }
 
 
-/* Called when the user clicks the Replace All button in FindDialog.
+/* Called when the user clicks the Replace All button in FindDialog. Finds every match in
+ * a snapshot of the text first, then replaces the span from the first match to the last
+ * with the rebuilt text in a single edit, so the document is only changed (and laid out)
+ * once and the whole replacement can be undone in one step.
  * @param what - the string to find and replace
  * @param with - the string with which to replace all matches
  * @param caseSensitive - flag denoting whether the search should heed the case of results
  * @param wholeWords - flag denoting whether the search should look for whole word matches or partials
+ * @param regex - flag denoting whether the query is a regular expression
  */
-void Editor::replaceAll(QString what, QString with, bool caseSensitive, bool wholeWords)
+void Editor::replaceAll(QString what, QString with, bool caseSensitive, bool wholeWords, bool regex)
 {
-    // Optimization, don't update screen until the end of all replacements
-    metricCalculationEnabled = false;
-
-    // Search the entire document from the very beginning
-    moveCursorTo(0);
-
-    // Conduct an initial search; don't rely on our custom find
-    QTextDocument::FindFlags searchOptions = getSearchOptionsFromFlags(caseSensitive, wholeWords);
-    bool found = QPlainTextEdit::find(what, searchOptions);
-    int replacements = 0;
-
-    // Keep replacing while there are matches left
-    QTextCursor cursor(document());
-    cursor.beginEditBlock();
-    while(found)
+    const SearchPattern &pattern = patternFor(what, caseSensitive, wholeWords, regex);
+    if(!pattern.isValid())
     {
-        QTextCursor currentPosition = textCursor();
-        currentPosition.insertText(with);
-        replacements++;
-        found = QPlainTextEdit::find(what, searchOptions);
+        emit(findResultReady("Invalid regular expression: " + pattern.getErrorString()));
+        return;
     }
-    cursor.endEditBlock();
 
-    // End-of-operation feedback
-    if(replacements == 0)
+    const QString text = SearchPattern::searchableText(document());
+    QVector<SearchPattern::Match> matches = pattern.findAll(text);
+
+    if(matches.isEmpty())
     {
         emit(findResultReady("No results found."));
+        return;
     }
-    else
+
+    // Rebuild the text between the first and last matches with every match replaced
+    const int spanStart = matches.first().position;
+    const int spanEnd = matches.last().position + matches.last().length;
+    QString replacement;
+    replacement.reserve(spanEnd - spanStart);
+
+    int copiedUpTo = spanStart;
+    int cursorPosition = textCursor().position();
+    int newCursorPosition = cursorPosition;
+
+    for(const SearchPattern::Match &match : matches)
     {
-        emit(findResultReady("Document searched. Replaced " + QString::number(replacements) + " instances."));
+        // findAll already checked the text, so there's no need to check it again for every match
+        QString matchReplacement = pattern.replacementFor(text, match, with, false);
+        replacement += text.midRef(copiedUpTo, match.position - copiedUpTo);
+        replacement += matchReplacement;
+        copiedUpTo = match.position + match.length;
+
+        // Keep the cursor on the same text it was on, shifted by the replacements before it
+        if(match.position + match.length <= cursorPosition)
+        {
+            newCursorPosition += matchReplacement.length() - match.length;
+        }
+        else if(match.position < cursorPosition)
+        {
+            newCursorPosition -= cursorPosition - match.position;
+        }
     }
 
+    // Optimization, don't update screen until the end of all replacements
+    metricCalculationEnabled = false;
+
+    QTextCursor cursor(document());
+    cursor.beginEditBlock();
+    cursor.setPosition(spanStart);
+    cursor.setPosition(spanEnd, QTextCursor::KeepAnchor);
+    cursor.insertText(replacement);
+    cursor.endEditBlock();
+
+    moveCursorTo(newCursorPosition);
     metricCalculationEnabled = true; // reset here
-    updateFileMetrics();
-    emit(windowNeedsToBeUpdated(metrics));
+
+    // End-of-operation feedback
+    emit(findResultReady("Document searched. Replaced " + QString::number(matches.size()) + " instances."));
 }
 
 
@@ -361,82 +880,38 @@ void Editor::formatSubtext(int startIndex, int endIndex, QTextCharFormat format,
 }
 
 
-/* Scans the entire document character by character and tallies the number of
- * characters and words and storing the counts internally for reporting.
+/* Copies the character and word counts maintained by this Editor's MetricsTracker
+ * into the metrics reported to the main window. The tracker only rescans the blocks
+ * touched by each edit, so this is cheap regardless of the document's size.
  * Note: column counting is handled by highlightCurrentLine.
  */
 void Editor::updateFileMetrics()
 {
-    QString documentContents = toPlainText().toUtf8();
-    int documentLength = documentContents.length();
-    metrics = DocumentMetrics();
-    QString currentWord = "";
-
-    // Loop through each character in the document
-    for(int i = 0; i < documentLength; i++)
-    {
-        // Convert to unsigned char to avoid running into debug assertion problems
-        unsigned char currentCharacter = qvariant_cast<unsigned char>(documentContents[i].toLatin1());
-
-        // Newline
-        if(currentCharacter == '\n')
-        {
-            // Special case: newline following a word
-            if(!currentWord.isEmpty())
-            {
-                metrics.wordCount++;
-                currentWord.clear();
-            }
-        }
-        // All other valid characters
-        else
-        {
-            metrics.charCount++;
-
-            // Alphanumeric character
-            if(isalnum(currentCharacter))
-            {
-                currentWord += qvariant_cast<char>(currentCharacter);
-            }
-            // Whitespace (excluding newline, handled separately above)
-            else if(isspace(currentCharacter))
-            {
-                // Whitespace following a word means we completed a word
-                if(!currentWord.isEmpty())
-                {
-                    metrics.wordCount++;
-                    currentWord.clear();
-                }
-                // Consume all other instances of whitespace
-                else
-                {
-                    while(i + 1 < documentLength &&
-                          isspace(qvariant_cast<unsigned char>(documentContents[i + 1].toLatin1())))
-                    {
-                        i++;
-                    }
-                }
-            }
-        }
-    }
-
-    // e.g., if we stopped typing and still had a word in progress, we need to count it
-    if(!currentWord.isEmpty())
-    {
-        metrics.wordCount++;
-        currentWord.clear();
-    }
+    metrics.charCount = metricsTracker->getCharCount();
+    metrics.wordCount = metricsTracker->getWordCount();
+    metrics.lineCount = blockCount();
 }
 
 
 /* Called whenever the contents of the text editor change, even if they are deleted
- * and restored to their original state. Marks the document as needing to be saved
- * and updates the file metrics. Emits the windowNeedsToBeUpdated signal when it's done
- * to direct its parent window to update any information it displays to the user.
+ * and restored to their original state. Invalidates the current search chain and the
+ * match highlights; the file metrics are kept up to date separately by this Editor's
+ * MetricsTracker.
  */
 void Editor::on_textChanged()
 {
-    searchHistory.clear();
+    resetSearchChain();
+    highlightVisibleBlocks();
+    highlightTimer.start();
+}
+
+
+/* Called by the MetricsTracker once a burst of edits has settled and every block has
+ * been counted. Emits the windowNeedsToBeUpdated signal to direct its parent window
+ * to update any information it displays to the user.
+ */
+void Editor::on_metricsChanged()
+{
     updateFileMetrics();
     emit(windowNeedsToBeUpdated(metrics));
 }
@@ -540,8 +1015,8 @@ bool Editor::handleKeyPress(QObject* obj, QEvent* event, int key)
 
                 return true;
             }
-            // Hit ENTER after colon (for Python only)
-            else if(character == ':' && programmingLanguage == Language::Python)
+            // Hit ENTER after colon (for languages like Python)
+            else if(character == ':' && syntaxHighlighter != nullptr && syntaxHighlighter->getGrammar().indentsAfterColon())
             {
                 int level = indentationLevelOfCurrentLine();
                 insertPlainText("\n");
@@ -608,9 +1083,21 @@ bool Editor::eventFilter(QObject* obj, QEvent* event)
 
     if(isKeyPress)
     {
-        int key = static_cast<QKeyEvent*>(event)->key();
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
 
-        return handleKeyPress(obj, event, key);
+        // QPlainTextEdit would hand these to the document, whose own undo is off
+        if(keyEvent->matches(QKeySequence::Undo))
+        {
+            undo();
+            return true;
+        }
+        if(keyEvent->matches(QKeySequence::Redo))
+        {
+            redo();
+            return true;
+        }
+
+        return handleKeyPress(obj, event, keyEvent->key());
     }
     else
     {
@@ -621,6 +1108,30 @@ bool Editor::eventFilter(QObject* obj, QEvent* event)
 }
 
 
+/* Shows the standard context menu, with its Undo and Redo options going through this
+ * Editor's UndoHistory.
+ */
+void Editor::contextMenuEvent(QContextMenuEvent *event)
+{
+    QMenu *menu = createStandardContextMenu(event->pos());
+
+    for(QAction *action : menu->actions())
+    {
+        if(action->objectName() == "edit-undo" || action->objectName() == "edit-redo")
+        {
+            bool isUndo = action->objectName() == "edit-undo";
+
+            disconnect(action, SIGNAL(triggered()), nullptr, nullptr);
+            connect(action, SIGNAL(triggered()), this, isUndo ? SLOT(undo()) : SLOT(redo()));
+            action->setEnabled(isUndo ? undoHistory->canUndo() : undoHistory->canRedo());
+        }
+    }
+
+    menu->exec(event->globalPos());
+    delete menu;
+}
+
+
 /* -----------------------------------------------------------
  * All functions below this line are used for lineNumberArea
  * -----------------------------------------------------------
@@ -681,15 +1192,18 @@ void Editor::resizeEvent(QResizeEvent *event)
 
     QRect cr = contentsRect();
     lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), getLineNumberAreaWidth(), cr.height()));
+    highlightVisibleBlocks();
+    highlightTimer.start();
 }
 
 
-/* Called when the cursor changes position. Highlights the line the cursor is on.
+/* Called when the cursor changes position. Highlights the line the cursor is on, and
+ * (unless a search is being highlighted) the occurrences of the word under the cursor.
  * Also computes the current column within that line.
  */
 void Editor::on_cursorPositionChanged()
 {
-    QList<QTextEdit::ExtraSelection> extraSelections;
+    currentLineSelections.clear();
     if (!isReadOnly())
     {
        QTextEdit::ExtraSelection selection;
@@ -699,9 +1213,38 @@ void Editor::on_cursorPositionChanged()
        selection.format.setProperty(QTextFormat::FullWidthSelection, true);
        selection.cursor = textCursor();
        selection.cursor.clearSelection();
-       extraSelections.append(selection);
+       currentLineSelections.append(selection);
+    }
+    refreshExtraSelections();
+
+    // Only a change of word means the highlights need recomputing
+    QString word;
+    if(!textCursor().hasSelection())
+    {
+        QTextCursor wordCursor = textCursor();
+        wordCursor.select(QTextCursor::WordUnderCursor);
+        word = wordCursor.selectedText();
+
+        if(!word.isEmpty() && !word.at(0).isLetterOrNumber() && word.at(0) != QLatin1Char('_'))
+        {
+            word.clear();
+        }
+    }
+    if(word != wordPattern.getQuery())
+    {
+        wordPattern = SearchPattern(word, true, true, false);
+        if(!searchHighlighted)
+        {
+            highlightTimer.start();
+        }
+    }
+
+    // The user moved the cursor, so the next incremental search starts from wherever it is now
+    if(!selectingIncrementalMatch)
+    {
+        incrementalSearchStart = -1;
+        awaitingIncrementalMatch = false;
     }
-    setExtraSelections(extraSelections);
 
     // When the cursor position changes, the column changes, so we need to update that
     if(metricCalculationEnabled)
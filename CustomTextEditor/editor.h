@@ -2,17 +2,26 @@
 #define EDITOR_H
 #include "finddialog.h"
 #include "gotodialog.h"
-#include "searchhistory.h"
+#include "matchindex.h"
+#include "watchlist.h"
+#include "undohistory.h"
 #include "documentmetrics.h"
 #include "language.h"
 #include "highlighter.h"
+#include "metricstracker.h"
 #include <QPlainTextEdit>
 #include <QFont>
 #include <QMessageBox>
+#include <QTimer>
+#include <QTextEdit>
 
 
 using namespace ProgrammingLanguage;
 
+class StreamingLoader;
+class FileSaver;
+class FileFollower;
+
 
 /* Disclaimer: the code for painting the editor line numbers was not written by me.
  * I only changed some of the variable names and code to make things clearer,
@@ -35,12 +44,27 @@ public:
 
     inline QString getFileName() { return getFileNameFromPath(); }
     void setCurrentFilePath(QString newPath);
+    inline void clearCurrentFilePath() { currentFilePath.clear(); fileIsUntitled = true; }
     inline QString getCurrentFilePath() const { return currentFilePath; }
     inline void setProgrammingLanguage(Language language);
     inline Language getProgrammingLanguage() const { return programmingLanguage; }
     inline bool isUntitled() const { return fileIsUntitled; }
 
+    inline StreamingLoader *getLoader() const { return loader; }
+    inline void setLoader(StreamingLoader *loader) { this->loader = loader; }
+    inline bool isLoading() const { return loader != nullptr; }
+
+    inline FileSaver *getSaver() const { return saver; }
+    inline void setSaver(FileSaver *saver) { this->saver = saver; }
+    inline bool isSaving() const { return saver != nullptr; }
+
+    inline FileFollower *getFollower() const { return follower; }
+    inline void setFollower(FileFollower *follower) { this->follower = follower; }
+    inline bool isFollowing() const { return follower != nullptr; }
+
     inline DocumentMetrics getDocumentMetrics() const { return metrics; }
+    inline const WatchList *getWatchList() const { return watchList; }
+    inline UndoHistory *getUndoHistory() const { return undoHistory; }
     void launchFontDialog();
     void setFont(QString family, QFont::StyleHint styleHint, bool fixedPitch, int pointSize, int tabStopWidth);
     void updateFileMetrics();
@@ -61,21 +85,38 @@ public:
 protected:
     void resizeEvent(QResizeEvent *event) override;
     bool eventFilter(QObject* obj, QEvent* event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
 
 signals:
     void findResultReady(QString message);
     void gotoResultReady(QString message);
     void columnCountChanged(int col);
     void windowNeedsToBeUpdated(DocumentMetrics metrics);
+    void matchCountReady(int currentMatch, int matchCount);
+    void watchListCountsReady(QStringList patterns, QVector<int> counts);
+    void undoMemoryChanged(qint64 inMemory, qint64 onDisk);
 
 public slots:
-    bool find(QString query, bool caseSensitive, bool wholeWords);
-    void replace(QString what, QString with, bool caseSensitive, bool wholeWords);
-    void replaceAll(QString what, QString with, bool caseSensitive, bool wholeWords);
+    void undo();
+    void redo();
+    bool find(QString query, bool caseSensitive, bool wholeWords, bool regex);
+    bool findPrevious(QString query, bool caseSensitive, bool wholeWords, bool regex);
+    void findIncrementally(QString query, bool caseSensitive, bool wholeWords, bool regex);
+    void replace(QString what, QString with, bool caseSensitive, bool wholeWords, bool regex);
+    void replaceAll(QString what, QString with, bool caseSensitive, bool wholeWords, bool regex);
     void goTo(int line);
+    void clearSearchHighlights();
+    void setWatchList(QStringList patterns, bool caseSensitive);
+    void findWatched(int pattern);
 
 private slots:
     void on_textChanged();
+    void on_metricsChanged();
+    void updateMatchCount();
+    void on_matchIndexUpdated();
+    void updateMatchHighlights();
+    void highlightVisibleBlocks();
+    void on_watchListUpdated();
     void updateLineNumberAreaWidth();
     void on_cursorPositionChanged();
     void updateLineNumberArea(const QRect &rectToBeRedrawn, int numPixelsScrolledVertically);
@@ -87,6 +128,15 @@ private:
     Highlighter *generateHighlighterFor(Language language);
     QString getFileNameFromPath();
     QTextDocument::FindFlags getSearchOptionsFromFlags(bool caseSensitive, bool wholeWords);
+    const SearchPattern &patternFor(const QString &query, bool caseSensitive, bool wholeWords, bool regex);
+    bool findMatch(const SearchPattern &pattern, bool forward);
+    SearchPattern::Match nearestMatch(const SearchPattern &pattern, int from, bool forward);
+    SearchPattern::Match incrementalMatch();
+    void selectIncrementalMatch(const SearchPattern::Match &match);
+    void resetSearchChain();
+    void highlightSearch(bool enabled);
+    void refreshExtraSelections();
+    void visibleSpan(const QTextBlock &block, int *start, int *end) const;
     bool handleKeyPress(QObject* obj, QEvent* event, int key);
     void moveCursorTo(int positionInText);
 
@@ -95,15 +145,40 @@ private:
     void insertTabs(int numTabs);
 
     Language programmingLanguage;
-    Highlighter *syntaxHighlighter;
+    Highlighter *syntaxHighlighter = nullptr;
 
     DocumentMetrics metrics;
+    MetricsTracker *metricsTracker;
     QString currentFilePath;
     bool fileIsUntitled = true;
+    StreamingLoader *loader = nullptr;
+    FileSaver *saver = nullptr;
+    FileFollower *follower = nullptr;
 
     QFont font;
     QTextCharFormat defaultCharFormat;
-    SearchHistory searchHistory;
+    SearchPattern searchPattern;
+    MatchIndex *matchIndex;
+    WatchList *watchList;
+    UndoHistory *undoHistory;
+    int searchChainStart = -1;
+    bool searchChainForward = true;
+    bool searchChainWrapped = false;
+    int incrementalSearchStart = -1;
+    bool selectingIncrementalMatch = false;
+    bool awaitingIncrementalMatch = false;
+    static const int replaceContextChars = 4096;
+
+    // Occurrences of the search pattern (or else the word under the cursor) in and around the viewport
+    QList<QTextEdit::ExtraSelection> currentLineSelections;
+    QList<QTextEdit::ExtraSelection> matchSelections;
+    SearchPattern wordPattern;
+    bool searchHighlighted = false;
+    QTimer highlightTimer;
+    static const int highlightMarginBlocks = 20;
+    static const int maxHighlights = 2000;
+    static const int longBlockLength = 10000;
+    static const int highlightMarginChars = 1000;
 
     QWidget *lineNumberArea;
     const int lineNumberAreaPadding = 30;
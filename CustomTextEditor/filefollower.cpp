@@ -0,0 +1,158 @@
+#include "filefollower.h"
+#include "editor.h"
+#include "utilityfunctions.h"
+#include <QFile>
+#include <QTextCursor>
+
+const qint64 FileFollower::maxBytesPerRead;
+const int FileFollower::pollInterval;
+const int FileFollower::rewatchInterval;
+
+
+/* Starts following the file at the given path. Only what gets appended to the file
+ * from now on is added to the editor.
+ */
+FileFollower::FileFollower(const QString &filePath, Editor *editor)
+    : QObject(editor), filePath(filePath), editor(editor)
+{
+    skipToEnd();
+
+    // Writers tend to append in bursts, so changes are gathered up for a moment before reading
+    readTimer.setSingleShot(true);
+    readTimer.setInterval(readInterval);
+    connect(&readTimer, SIGNAL(timeout()), this, SLOT(readAppendedBytes()));
+
+    pollTimer.setInterval(pollInterval);
+    connect(&pollTimer, SIGNAL(timeout()), this, SLOT(on_pollTimeout()));
+
+    connect(&watcher, SIGNAL(fileChanged(QString)), this, SLOT(on_fileChanged()));
+    if(!watch())
+    {
+        pollTimer.start();
+    }
+}
+
+
+/* Starts watching the file, if it exists. Returns true if it's being watched now.
+ */
+bool FileFollower::watch()
+{
+    return watcher.files().contains(filePath) || (QFile::exists(filePath) && watcher.addPath(filePath));
+}
+
+
+/* Treats everything currently in the file as already followed. Used when starting to
+ * follow, and after the editor itself has written the file.
+ */
+void FileFollower::skipToEnd()
+{
+    bytesFollowed = QFile(filePath).size();
+    identity = Utility::fileIdentity(filePath);
+    decoder.reset();
+}
+
+
+/* Called by the watcher when the file is modified, replaced or removed.
+ */
+void FileFollower::on_fileChanged()
+{
+    // Some writers replace the file instead of appending to it, which ends the watch, and
+    // the new file may not have been created yet
+    if(!watch())
+    {
+        pollTimer.start(rewatchInterval);
+    }
+
+    if(!readTimer.isActive())
+    {
+        readTimer.start();
+    }
+}
+
+
+/* Called while the file can't be watched. Watching takes over again as soon as it can;
+ * until then, the file is checked less and less often, down to once every pollInterval.
+ */
+void FileFollower::on_pollTimeout()
+{
+    if(watch())
+    {
+        pollTimer.stop();
+    }
+    else if(pollTimer.interval() < pollInterval)
+    {
+        pollTimer.setInterval(qMin(2 * pollTimer.interval(), pollInterval));
+    }
+
+    readAppendedBytes();
+}
+
+
+/* Reads whatever has been appended to the file since the last read and adds it to the
+ * end of the document. Large amounts are added a few megabytes at a time.
+ */
+void FileFollower::readAppendedBytes()
+{
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    qint64 fileSize = file.size();
+    quint64 currentIdentity = Utility::fileIdentity(filePath);
+
+    // The file was truncated, or rotated (it's a different file now), so follow it again from the start
+    if(fileSize < bytesFollowed || (currentIdentity != 0 && identity != 0 && currentIdentity != identity))
+    {
+        bytesFollowed = 0;
+        decoder.reset();
+    }
+    if(currentIdentity != 0)
+    {
+        identity = currentIdentity;
+    }
+
+    if(fileSize == bytesFollowed)
+    {
+        return;
+    }
+
+    file.seek(bytesFollowed);
+    QByteArray bytes = file.read(qMin(fileSize - bytesFollowed, maxBytesPerRead));
+    file.close();
+
+    if(bytes.isEmpty())
+    {
+        return;
+    }
+    bytesFollowed += bytes.size();
+
+    QTextDocument *document = editor->document();
+    bool followingEnd = editor->textCursor().atEnd();
+    bool wasModified = document->isModified();
+
+    QTextCursor cursor(document);
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+    cursor.insertText(decoder.decode(bytes.constData(), bytes.size()));
+    cursor.endEditBlock();
+
+    // What's on disk isn't an unsaved change
+    if(!wasModified)
+    {
+        document->setModified(false);
+    }
+
+    if(followingEnd)
+    {
+        editor->moveCursor(QTextCursor::End);
+        editor->ensureCursorVisible();
+    }
+
+    // Come back for the rest once the event loop has had a chance to repaint
+    if(bytesFollowed < fileSize)
+    {
+        QTimer::singleShot(0, this, SLOT(readAppendedBytes()));
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef FILEFOLLOWER_H
+#define FILEFOLLOWER_H
+#include "fileloader.h"
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+class Editor;
+
+
+/* Keeps an Editor in step with a file that keeps growing, like a log being written to.
+ * Whenever the file changes, only the bytes appended since the last read are decoded and
+ * added to the end of the document, as a single edit, so the editor's metrics and syntax
+ * highlighting only have to deal with the new lines. The editor only scrolls along with
+ * the new text if its cursor was at the end of the document.
+ *
+ * Changes are picked up through a QFileSystemWatcher, falling back to polling the
+ * file's size where the file can't be watched. A writer that rotates the file (renaming
+ * it away and starting a new one) ends the watch; the follower then polls, quickly at
+ * first and less often the longer it takes, until the new file appears and can be
+ * watched again. The file's identity (see Utility::fileIdentity) is remembered, so a
+ * rotated file is followed from its start even if the new one has already grown past
+ * the old one's size.
+ */
+class FileFollower : public QObject
+{
+    Q_OBJECT
+
+public:
+    FileFollower(const QString &filePath, Editor *editor);
+
+    inline QString getFilePath() const { return filePath; }
+    void skipToEnd();
+
+private slots:
+    void on_fileChanged();
+    void on_pollTimeout();
+    void readAppendedBytes();
+
+private:
+    bool watch();
+
+    QString filePath;
+    Editor *editor;
+    qint64 bytesFollowed = 0;
+    quint64 identity = 0;
+    TextChunkDecoder decoder;
+
+    QFileSystemWatcher watcher;
+    QTimer readTimer;
+    QTimer pollTimer;
+
+    static const qint64 maxBytesPerRead = 4 * 1024 * 1024;
+    static const int readInterval = 100;
+    static const int pollInterval = 1000;
+    static const int rewatchInterval = 100;
+};
+
+#endif // FILEFOLLOWER_H
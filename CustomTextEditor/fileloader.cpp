@@ -0,0 +1,270 @@
+#include "fileloader.h"
+#include "utilityfunctions.h"
+#include "linediff.h"
+#include "undohistory.h"
+#include <QFile>
+#include <QTextCursor>
+#include <QElapsedTimer>
+
+const qint64 FileLoader::windowSize;
+
+
+/* Decodes the next chunk of raw bytes. Detects the encoding on the first call.
+ * @param bytes - the raw bytes to decode
+ * @param length - the number of bytes to decode
+ */
+QString TextChunkDecoder::decode(const char *bytes, int length)
+{
+    if(decoder.isNull())
+    {
+        QByteArray head = QByteArray::fromRawData(bytes, qMin(length, 4));
+        QTextCodec *codec = QTextCodec::codecForUtfText(head, QTextCodec::codecForName("UTF-8"));
+        decoder.reset(codec->makeDecoder());
+    }
+
+    QString text = decoder->toUnicode(bytes, length);
+    text.remove(QLatin1Char('\r'));
+    return text;
+}
+
+
+/* Notes how much memory is in use before a load, and resets the process's high-water
+ * mark where the platform allows it, so that the peak reached during the load can be
+ * told apart from that of earlier ones.
+ */
+void FileLoader::Statistics::startMeasuringMemory()
+{
+    residentBytesBefore = Utility::residentSetSize();
+    peakBytesBefore = Utility::resetPeakResidentSetSize() ? -1 : Utility::peakResidentSetSize();
+}
+
+
+/* Notes the most memory in use during the load. Without a reset high-water mark, that's
+ * only known if the load raised it; otherwise the memory in use now stands in for it.
+ */
+void FileLoader::Statistics::stopMeasuringMemory()
+{
+    const qint64 peak = Utility::peakResidentSetSize();
+    peakMeasured = peak >= 0 && peak > peakBytesBefore;
+    peakResidentBytes = peakMeasured ? peak : Utility::residentSetSize();
+}
+
+
+/* Replaces the contents of the given document with the contents of the file at the given
+ * path. The document's undo history is cleared, as with setPlainText. Returns true on
+ * success; otherwise, returns false and describes the problem in errorString.
+ * @param filePath - the path of the file to load
+ * @param document - the document to load the file into
+ * @param errorString - receives a description of the error, if any
+ * @param statistics - if not null, receives the elapsed time and peak memory usage of the load
+ */
+bool FileLoader::load(const QString &filePath, QTextDocument *document, QString *errorString, Statistics *statistics)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if(statistics != nullptr)
+    {
+        statistics->startMeasuringMemory();
+    }
+
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        *errorString = file.errorString();
+        return false;
+    }
+
+    TextChunkDecoder decoder;
+    qint64 fileSize = file.size();
+    qint64 offset = 0;
+
+    // Like setPlainText, loading a file isn't something the user should be able to undo
+    bool undoRedoEnabled = document->isUndoRedoEnabled();
+    document->setUndoRedoEnabled(false);
+
+    UndoHistory *undoHistory = UndoHistory::of(document);
+    if(undoHistory != nullptr)
+    {
+        undoHistory->suspend();
+    }
+
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    cursor.select(QTextCursor::Document);
+    cursor.removeSelectedText();
+
+    while(offset < fileSize)
+    {
+        qint64 length = qMin(windowSize, fileSize - offset);
+        uchar *window = file.map(offset, length);
+
+        // Some files (e.g., on special file systems) can't be mapped, so fall back to reading them
+        if(window == nullptr)
+        {
+            QByteArray bytes = file.read(windowSize);
+            if(bytes.isEmpty())
+            {
+                break;
+            }
+            cursor.insertText(decoder.decode(bytes.constData(), bytes.size()));
+            offset += bytes.size();
+            continue;
+        }
+
+        cursor.insertText(decoder.decode(reinterpret_cast<const char*>(window), static_cast<int>(length)));
+        file.unmap(window);
+        offset += length;
+
+        if(!file.seek(offset))
+        {
+            break;
+        }
+    }
+
+    cursor.endEditBlock();
+    document->setUndoRedoEnabled(undoRedoEnabled);
+    file.close();
+
+    if(undoHistory != nullptr)
+    {
+        undoHistory->resume();
+    }
+
+    if(statistics != nullptr)
+    {
+        statistics->bytesRead = offset;
+        statistics->elapsedMilliseconds = timer.elapsed();
+        statistics->stopMeasuringMemory();
+    }
+
+    return true;
+}
+
+
+/* Reads and decodes the whole file at the given path into text. Returns false and
+ * describes the problem in errorString if the file can't be read.
+ */
+bool FileLoader::readAll(const QString &filePath, QString *text, QString *errorString)
+{
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        *errorString = file.errorString();
+        return false;
+    }
+
+    TextChunkDecoder decoder;
+    qint64 fileSize = file.size();
+    qint64 offset = 0;
+    text->clear();
+
+    while(offset < fileSize)
+    {
+        qint64 length = qMin(windowSize, fileSize - offset);
+        uchar *window = file.map(offset, length);
+
+        if(window == nullptr)
+        {
+            file.seek(offset);
+            QByteArray bytes = file.read(windowSize);
+            if(bytes.isEmpty())
+            {
+                break;
+            }
+            text->append(decoder.decode(bytes.constData(), bytes.size()));
+            offset += bytes.size();
+            continue;
+        }
+
+        text->append(decoder.decode(reinterpret_cast<const char*>(window), static_cast<int>(length)));
+        file.unmap(window);
+        offset += length;
+    }
+
+    return true;
+}
+
+
+/* Brings the given document in line with the current contents of the file at the given
+ * path by replacing only the lines that differ (see LineDiff). All of the replacements
+ * make up a single undoable edit, and blocks outside of them are left alone, so their
+ * highlighting, counts and the cursors in them are kept. Returns false and describes
+ * the problem in errorString if the file can't be read.
+ * @param filePath - the path of the file to reload
+ * @param document - the document to update
+ * @param errorString - receives a description of the error, if any
+ * @param hunkCount - if not null, receives the number of separately changed line ranges
+ */
+bool FileLoader::reload(const QString &filePath, QTextDocument *document, QString *errorString, int *hunkCount)
+{
+    QString newText;
+    if(!readAll(filePath, &newText, errorString))
+    {
+        return false;
+    }
+
+    // Raw text keeps one line per block, unlike toPlainText
+    QString oldText = document->toRawText();
+    QVector<QStringRef> oldLines = oldText.splitRef(QChar::ParagraphSeparator);
+    QVector<QStringRef> newLines = newText.splitRef(QLatin1Char('\n'));
+    QVector<LineDiff::Hunk> hunks = LineDiff::compute(oldLines, newLines);
+
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+
+    // Going bottom-up keeps the block numbers of the hunks still to be applied valid
+    for(int i = hunks.size() - 1; i >= 0; i--)
+    {
+        const LineDiff::Hunk &hunk = hunks.at(i);
+        QString replacement;
+        int start;
+        int end;
+
+        // The last line has no line break after it, so hunks reaching it are special
+        if(hunk.oldStart + hunk.oldCount < oldLines.size())
+        {
+            start = document->findBlockByNumber(hunk.oldStart).position();
+            end = document->findBlockByNumber(hunk.oldStart + hunk.oldCount).position();
+            for(int line = hunk.newStart; line < hunk.newStart + hunk.newCount; line++)
+            {
+                replacement += newLines.at(line);
+                replacement += QLatin1Char('\n');
+            }
+        }
+        else
+        {
+            // Take over the line break ending the line before, if there is one
+            QTextBlock previous = document->findBlockByNumber(hunk.oldStart - 1);
+            start = previous.isValid() ? previous.position() + previous.length() - 1 : 0;
+            end = document->characterCount() - 1;
+            for(int line = hunk.newStart; line < hunk.newStart + hunk.newCount; line++)
+            {
+                if(line > 0)
+                {
+                    replacement += QLatin1Char('\n');
+                }
+                replacement += newLines.at(line);
+            }
+        }
+
+        cursor.setPosition(start);
+        cursor.setPosition(end, QTextCursor::KeepAnchor);
+        if(replacement.isEmpty())
+        {
+            cursor.removeSelectedText();
+        }
+        else
+        {
+            cursor.insertText(replacement);
+        }
+    }
+
+    cursor.endEditBlock();
+
+    if(hunkCount != nullptr)
+    {
+        *hunkCount = hunks.size();
+    }
+    return true;
+}
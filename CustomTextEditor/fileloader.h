@@ -0,0 +1,61 @@
+#ifndef FILELOADER_H
+#define FILELOADER_H
+#include <QString>
+#include <QTextDocument>
+#include <QTextCodec>
+#include <QScopedPointer>
+
+
+/* Incrementally decodes raw file bytes into text suitable for a QTextDocument. The
+ * encoding is detected from the first chunk (UTF-8 unless a BOM says otherwise), and
+ * multi-byte sequences split across chunks are carried over to the next call. Carriage
+ * returns are dropped, as a QFile opened in text mode would, so that "\r\n" doesn't
+ * turn into two blocks.
+ */
+class TextChunkDecoder
+{
+public:
+    TextChunkDecoder() {}
+    QString decode(const char *bytes, int length);
+    inline void reset() { decoder.reset(); }
+
+private:
+    QScopedPointer<QTextDecoder> decoder;
+};
+
+
+/* Reads a file into a QTextDocument by memory-mapping it one window at a time and
+ * decoding each window straight into the document. Unlike QTextStream::readAll followed
+ * by setPlainText, this never holds more than one window's worth of decoded text on top
+ * of the document itself.
+ */
+class FileLoader
+{
+public:
+    // What a load took. The memory figures are the resident set size before the load
+    // and the most it reached during it; where the platform can't say what the most was
+    // (its high-water mark can't be reset and wasn't raised), the size after the load
+    struct Statistics
+    {
+        qint64 bytesRead = 0;
+        qint64 elapsedMilliseconds = 0;
+        qint64 residentBytesBefore = -1;
+        qint64 peakResidentBytes = -1;
+        bool peakMeasured = false;
+
+        void startMeasuringMemory();
+        void stopMeasuringMemory();
+        inline bool memoryMeasured() const { return residentBytesBefore >= 0 && peakResidentBytes >= 0; }
+
+    private:
+        qint64 peakBytesBefore = -1;
+    };
+
+    static bool load(const QString &filePath, QTextDocument *document, QString *errorString, Statistics *statistics = nullptr);
+    static bool readAll(const QString &filePath, QString *text, QString *errorString);
+    static bool reload(const QString &filePath, QTextDocument *document, QString *errorString, int *hunkCount = nullptr);
+
+    static const qint64 windowSize = 16 * 1024 * 1024;
+};
+
+#endif // FILELOADER_H
@@ -0,0 +1,87 @@
+#include "filesaver.h"
+#include <QSaveFile>
+#include <QTextCodec>
+#include <QScopedPointer>
+#include <QtConcurrent>
+
+const int FileSaver::chunkSize;
+
+
+/* Prepares to save to the file at the given path. Nothing is written until start is called.
+ */
+FileSaver::FileSaver(const QString &filePath, QObject *parent) : QObject(parent), filePath(filePath)
+{
+    connect(&writeWatcher, SIGNAL(finished()), this, SLOT(on_writeFinished()));
+}
+
+
+/* Lets a write in progress finish before this saver goes away, so that quitting
+ * in the middle of a save doesn't lose the file.
+ */
+FileSaver::~FileSaver()
+{
+    writeWatcher.waitForFinished();
+}
+
+
+/* Starts writing the given text, taken from the document at the given revision.
+ * The finished signal reports how it went.
+ */
+void FileSaver::start(const QString &text, int revision)
+{
+    this->revision = revision;
+    elapsedTimer.start();
+    writeWatcher.setFuture(QtConcurrent::run(&FileSaver::write, filePath, text));
+}
+
+
+/* Runs on a worker thread. Encodes the text a chunk at a time and writes each chunk
+ * out before encoding the next, so the encoded file never has to exist in memory all
+ * at once. The original file is only replaced if every chunk was written.
+ */
+FileSaver::Result FileSaver::write(QString filePath, QString text)
+{
+    Result result;
+    QSaveFile file(filePath);
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        result.errorString = file.errorString();
+        return result;
+    }
+
+    // The encoder carries a surrogate pair split between two chunks over to the next one
+    QScopedPointer<QTextEncoder> encoder(QTextCodec::codecForName("UTF-8")->makeEncoder(QTextCodec::IgnoreHeader));
+
+    for(int start = 0; start < text.size(); start += chunkSize)
+    {
+        QByteArray bytes = encoder->fromUnicode(text.constData() + start, qMin(chunkSize, text.size() - start));
+
+        if(file.write(bytes) != bytes.size())
+        {
+            result.errorString = file.errorString();
+            file.cancelWriting();
+            return result;
+        }
+        result.bytesWritten += bytes.size();
+    }
+
+    if(!file.commit())
+    {
+        result.errorString = file.errorString();
+        return result;
+    }
+
+    result.succeeded = true;
+    return result;
+}
+
+
+/* Called on the UI thread once the worker thread is done writing.
+ */
+void FileSaver::on_writeFinished()
+{
+    result = writeWatcher.result();
+    elapsedMilliseconds = elapsedTimer.elapsed();
+    emit(finished(result.succeeded));
+}
@@ -0,0 +1,56 @@
+#ifndef FILESAVER_H
+#define FILESAVER_H
+#include <QObject>
+#include <QString>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+
+
+/* Writes a snapshot of a document's text to disk on a worker thread. The text is
+ * encoded as UTF-8 one chunk at a time and written through a QSaveFile, so the file on
+ * disk is replaced atomically once everything has been written and is left untouched
+ * if anything goes wrong. The snapshot remembers the document revision it was taken
+ * at, which lets the caller tell whether the document changed while it was being saved.
+ */
+class FileSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    FileSaver(const QString &filePath, QObject *parent = nullptr);
+    ~FileSaver() override;
+
+    void start(const QString &text, int revision);
+    inline QString getFilePath() const { return filePath; }
+    inline int getRevision() const { return revision; }
+    inline QString getErrorString() const { return result.errorString; }
+    inline qint64 getBytesWritten() const { return result.bytesWritten; }
+    inline qint64 getElapsedMilliseconds() const { return elapsedMilliseconds; }
+
+signals:
+    void finished(bool succeeded);
+
+private slots:
+    void on_writeFinished();
+
+private:
+    struct Result
+    {
+        bool succeeded = false;
+        QString errorString;
+        qint64 bytesWritten = 0;
+    };
+
+    static Result write(QString filePath, QString text);
+
+    QString filePath;
+    int revision = -1;
+    QFutureWatcher<Result> writeWatcher;
+    Result result;
+    QElapsedTimer elapsedTimer;
+    qint64 elapsedMilliseconds = 0;
+
+    static const int chunkSize = 1 << 20;
+};
+
+#endif // FILESAVER_H
@@ -0,0 +1,237 @@
+#include "filesearch.h"
+#include "fileloader.h"
+#include <QDirIterator>
+#include <QFile>
+#include <QtConcurrent>
+#include <cstring>
+#include <limits>
+
+
+const int FileSearch::maxHitsPerFile;
+const int FileSearch::maxLineTextLength;
+const int FileSearch::binaryCheckLength;
+
+
+namespace
+{
+    /* Searches one file for the pattern it was made with. QtConcurrent::mapped needs a
+     * function object that names its result type.
+     */
+    struct FileSearcher
+    {
+        typedef QVector<FileHit> result_type;
+
+        SearchPattern pattern;
+
+        QVector<FileHit> operator()(const QString &filePath) const
+        {
+            return FileSearch::searchFile(filePath, pattern);
+        }
+    };
+}
+
+
+FileSearch::FileSearch(QObject *parent) : QObject(parent)
+{
+    connect(&enumerationWatcher, SIGNAL(finished()), this, SLOT(on_enumerationFinished()));
+    connect(&searchWatcher, SIGNAL(resultReadyAt(int)), this, SLOT(on_fileSearched(int)));
+    connect(&searchWatcher, SIGNAL(progressValueChanged(int)), this, SLOT(on_progressValueChanged(int)));
+    connect(&searchWatcher, SIGNAL(finished()), this, SLOT(on_searchFinished()));
+}
+
+
+/* Stops the search, and waits for the files being searched right now.
+ */
+FileSearch::~FileSearch()
+{
+    cancel();
+    enumerationWatcher.waitForFinished();
+    searchWatcher.waitForFinished();
+}
+
+
+/* Starts searching the files under the given directory. Does nothing if a search is
+ * already running; cancel it and wait for finished first.
+ * @param directory - the directory to search, along with all of its subdirectories
+ * @param nameFilters - wildcards the names of the files to search must match (all files if empty)
+ * @param maxFileSize - the size, in bytes, above which files are skipped
+ * @param pattern - the pattern to search for
+ */
+void FileSearch::start(const QString &directory, const QStringList &nameFilters, qint64 maxFileSize, const SearchPattern &pattern)
+{
+    if(running)
+    {
+        return;
+    }
+
+    this->pattern = pattern;
+    running = true;
+    fileCount = 0;
+    cancelled.store(0);
+
+    enumerationWatcher.setFuture(QtConcurrent::run(&FileSearch::enumerate, directory, nameFilters, maxFileSize,
+                                                   static_cast<const QAtomicInt*>(&cancelled)));
+}
+
+
+/* Stops the search. Files already being searched are finished, and their hits still
+ * reported, before finished is emitted.
+ */
+void FileSearch::cancel()
+{
+    cancelled.store(1);
+    searchWatcher.cancel();
+}
+
+
+/* Returns the paths of the readable, non-empty files under the given directory whose
+ * names match one of the given wildcards and that aren't bigger than the given size.
+ * Hidden files and directories, and symbolic links to directories, are skipped. Stops
+ * early once the given flag is set.
+ */
+QStringList FileSearch::enumerate(const QString &directory, const QStringList &nameFilters, qint64 maxFileSize,
+                                  const QAtomicInt *cancelled)
+{
+    QStringList filePaths;
+    QDirIterator iterator(directory, nameFilters, QDir::Files | QDir::Readable | QDir::NoDotAndDotDot,
+                          QDirIterator::Subdirectories);
+
+    while(iterator.hasNext() && cancelled->load() == 0)
+    {
+        iterator.next();
+        qint64 size = iterator.fileInfo().size();
+
+        if(size > 0 && size <= maxFileSize)
+        {
+            filePaths.append(iterator.filePath());
+        }
+    }
+
+    return filePaths;
+}
+
+
+/* Returns the lines of the given file that match the given pattern, one hit per line
+ * (at its first match), up to maxHitsPerFile of them. The file is mapped into memory
+ * rather than read. Files that look binary (a NUL byte near the start, unless it begins
+ * with a UTF-16 byte order mark) have no hits. Safe to call from any thread.
+ */
+QVector<FileHit> FileSearch::searchFile(const QString &filePath, const SearchPattern &pattern)
+{
+    QVector<FileHit> hits;
+
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly) || file.size() == 0 || file.size() > std::numeric_limits<int>::max())
+    {
+        return hits;
+    }
+
+    qint64 length = file.size();
+    const char *bytes = reinterpret_cast<const char*>(file.map(0, length));
+    QByteArray contents;
+
+    // Some files (on special file systems, for instance) can't be mapped
+    if(bytes == nullptr)
+    {
+        contents = file.readAll();
+        bytes = contents.constData();
+        length = contents.size();
+    }
+
+    bool utf16 = length >= 2 && ((bytes[0] == '\xFF' && bytes[1] == '\xFE') || (bytes[0] == '\xFE' && bytes[1] == '\xFF'));
+    if(!utf16 && std::memchr(bytes, 0, static_cast<size_t>(qMin<qint64>(length, binaryCheckLength))) != nullptr)
+    {
+        return hits;
+    }
+
+    TextChunkDecoder decoder;
+    const QString text = decoder.decode(bytes, static_cast<int>(length));
+    const QChar *characters = text.constData();
+
+    int line = 1;
+    int lineStart = 0;
+    int scanned = 0;
+    int lastHitLine = 0;
+
+    for(const SearchPattern::Match &match : pattern.findAll(text))
+    {
+        for(; scanned < match.position; scanned++)
+        {
+            if(characters[scanned] == QLatin1Char('\n'))
+            {
+                line++;
+                lineStart = scanned + 1;
+            }
+        }
+
+        if(line == lastHitLine)
+        {
+            continue;
+        }
+        lastHitLine = line;
+
+        int lineEnd = text.indexOf(QLatin1Char('\n'), lineStart);
+        if(lineEnd < 0)
+        {
+            lineEnd = text.length();
+        }
+
+        hits.append({filePath, line, match.position - lineStart + 1, text.mid(lineStart, qMin(lineEnd - lineStart, maxLineTextLength))});
+        if(hits.size() == maxHitsPerFile)
+        {
+            break;
+        }
+    }
+
+    return hits;
+}
+
+
+/* Called once the directory tree has been walked. Starts searching the files it turned
+ * up, unless the search was cancelled in the meantime.
+ */
+void FileSearch::on_enumerationFinished()
+{
+    QStringList filePaths = enumerationWatcher.result();
+
+    if(cancelled.load() != 0 || filePaths.isEmpty())
+    {
+        running = false;
+        emit(progressChanged(0, 0));
+        emit(finished(cancelled.load() != 0));
+        return;
+    }
+
+    fileCount = filePaths.size();
+    emit(progressChanged(0, fileCount));
+    searchWatcher.setFuture(QtConcurrent::mapped(filePaths, FileSearcher{pattern}));
+}
+
+
+/* Called each time a file has been searched. Passes on its hits, if it had any.
+ * @param index - the index of the file among the ones being searched
+ */
+void FileSearch::on_fileSearched(int index)
+{
+    QVector<FileHit> hits = searchWatcher.resultAt(index);
+
+    if(!hits.isEmpty())
+    {
+        emit(hitsFound(hits));
+    }
+}
+
+
+void FileSearch::on_progressValueChanged(int filesSearched)
+{
+    emit(progressChanged(filesSearched, fileCount));
+}
+
+
+/* Called once every file has been searched, or the search was cancelled.
+ */
+void FileSearch::on_searchFinished()
+{
+    running = false;
+    emit(finished(searchWatcher.isCanceled()));
+}
@@ -0,0 +1,75 @@
+#ifndef FILESEARCH_H
+#define FILESEARCH_H
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+#include "searchpattern.h"
+
+
+/* One line of one file that matched a search.
+ */
+struct FileHit
+{
+    QString filePath;
+    int line;
+    int column;
+    QString lineText;
+};
+
+
+/* Searches every file under a directory for one pattern. The directory tree is walked on
+ * a worker thread first; the files it turns up are then mapped into memory and searched
+ * in parallel on the global thread pool, and the hits in each file are handed out from
+ * the event loop as soon as that file is done, so results show up while the search is
+ * still going.
+ */
+class FileSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    FileSearch(QObject *parent = nullptr);
+    ~FileSearch() override;
+
+    void start(const QString &directory, const QStringList &nameFilters, qint64 maxFileSize, const SearchPattern &pattern);
+    inline bool isRunning() const { return running; }
+
+    static QStringList enumerate(const QString &directory, const QStringList &nameFilters, qint64 maxFileSize,
+                                 const QAtomicInt *cancelled);
+    static QVector<FileHit> searchFile(const QString &filePath, const SearchPattern &pattern);
+
+    static const int maxHitsPerFile = 1000;
+    static const int maxLineTextLength = 300;
+    static const int binaryCheckLength = 8000;
+
+signals:
+    void hitsFound(QVector<FileHit> hits);
+    void progressChanged(int filesSearched, int fileCount);
+    void finished(bool cancelled);
+
+public slots:
+    void cancel();
+
+private slots:
+    void on_enumerationFinished();
+    void on_fileSearched(int index);
+    void on_progressValueChanged(int filesSearched);
+    void on_searchFinished();
+
+private:
+    SearchPattern pattern;
+    bool running = false;
+    int fileCount = 0;
+
+    // Checked by the thread walking the directory tree, which has no future to cancel
+    QAtomicInt cancelled;
+
+    QFutureWatcher<QStringList> enumerationWatcher;
+    QFutureWatcher<QVector<FileHit>> searchWatcher;
+};
+
+#endif // FILESEARCH_H
@@ -2,6 +2,8 @@
 #include <QHBoxLayout>
 #include <QMessageBox>
 #include <QSplitter>
+#include <QLocale>
+#include <QRegularExpression>
 
 
 /* Initializes this FindDialog object.
@@ -12,13 +14,16 @@ FindDialog::FindDialog(QWidget *parent)
     // Initialize all members
     findLabel = new QLabel(tr("Find what:    "));
     replaceLabel = new QLabel(tr("Replace with:"));
+    matchCountLabel = new QLabel();
     findLineEdit = new QLineEdit();
     replaceLineEdit = new QLineEdit();
     findNextButton = new QPushButton(tr("&Find next"));
+    findPreviousButton = new QPushButton(tr("Find &previous"));
     replaceButton = new QPushButton(tr("&Replace"));
     replaceAllButton = new QPushButton(tr("&Replace all"));
     caseSensitiveCheckBox = new QCheckBox(tr("&Match case"));
     wholeWordsCheckBox = new QCheckBox(tr("&Whole words"));
+    regexCheckBox = new QCheckBox(tr("Regular e&xpression"));
 
     // Ensures that the line edit gets the focus whenever the dialog is the active window
     setFocusProxy(findLineEdit);
@@ -32,6 +37,7 @@ FindDialog::FindDialog(QWidget *parent)
     verticalLayout->addLayout(findHorizontalLayout);
     verticalLayout->addLayout(replaceHorizontalLayout);
     verticalLayout->addLayout(optionsLayout);
+    verticalLayout->addWidget(matchCountLabel);
 
     findHorizontalLayout->addWidget(findLabel);
     findHorizontalLayout->addWidget(findLineEdit);
@@ -40,7 +46,9 @@ FindDialog::FindDialog(QWidget *parent)
 
     optionsLayout->addWidget(caseSensitiveCheckBox);
     optionsLayout->addWidget(wholeWordsCheckBox);
+    optionsLayout->addWidget(regexCheckBox);
     optionsLayout->addWidget(findNextButton);
+    optionsLayout->addWidget(findPreviousButton);
     optionsLayout->addWidget(replaceButton);
     optionsLayout->addWidget(replaceAllButton);
 
@@ -48,8 +56,15 @@ FindDialog::FindDialog(QWidget *parent)
     setWindowTitle(tr("Find and Replace"));
 
     connect(findNextButton, SIGNAL(clicked()), this, SLOT(on_findNextButton_clicked()));
+    connect(findPreviousButton, SIGNAL(clicked()), this, SLOT(on_findNextButton_clicked()));
     connect(replaceButton, SIGNAL(clicked()), this, SLOT(on_replaceOperation_initiated()));
     connect(replaceAllButton, SIGNAL(clicked()), this, SLOT(on_replaceOperation_initiated()));
+
+    // Search as the user types
+    connect(findLineEdit, SIGNAL(textEdited(QString)), this, SLOT(on_query_changed()));
+    connect(caseSensitiveCheckBox, SIGNAL(toggled(bool)), this, SLOT(on_query_changed()));
+    connect(wholeWordsCheckBox, SIGNAL(toggled(bool)), this, SLOT(on_query_changed()));
+    connect(regexCheckBox, SIGNAL(toggled(bool)), this, SLOT(on_query_changed()));
 }
 
 
@@ -59,13 +74,16 @@ FindDialog::~FindDialog()
 {
     delete findLabel;
     delete replaceLabel;
+    delete matchCountLabel;
     delete findLineEdit;
     delete replaceLineEdit;
     delete findNextButton;
+    delete findPreviousButton;
     delete replaceButton;
     delete replaceAllButton;
     delete caseSensitiveCheckBox;
     delete wholeWordsCheckBox;
+    delete regexCheckBox;
     delete findHorizontalLayout;
     delete replaceHorizontalLayout;
     delete optionsLayout;
@@ -73,8 +91,9 @@ FindDialog::~FindDialog()
 }
 
 
-/* Called when the user clicks the Find Next button. If the query is empty, it informs the user.
- * Otherwise, it emits an appropriate signal for startFinding with all relevant search criteria.
+/* Called when the user clicks the Find Next or Find Previous button. If the query is empty, it
+ * informs the user. Otherwise, it emits startFinding or startFindingPrevious (respectively)
+ * with all relevant search criteria.
  */
 void FindDialog::on_findNextButton_clicked()
 {
@@ -88,7 +107,68 @@ void FindDialog::on_findNextButton_clicked()
 
     bool caseSensitive = caseSensitiveCheckBox->isChecked();
     bool wholeWords = wholeWordsCheckBox->isChecked();
-    emit(startFinding(query, caseSensitive, wholeWords));
+    bool regex = regexCheckBox->isChecked();
+
+    if(sender() == findPreviousButton)
+    {
+        emit(startFindingPrevious(query, caseSensitive, wholeWords, regex));
+    }
+    else
+    {
+        emit(startFinding(query, caseSensitive, wholeWords, regex));
+    }
+}
+
+
+/* Called whenever the user edits the query or changes one of the options. Emits
+ * queryChanged with all relevant search criteria so the first match can be selected
+ * as the user types. A regular expression that doesn't compile yet (because the user
+ * is still typing it, say) is noted next to the match count instead.
+ */
+void FindDialog::on_query_changed()
+{
+    QString query = findLineEdit->text();
+    bool regex = regexCheckBox->isChecked();
+
+    if(regex && !QRegularExpression(query).isValid())
+    {
+        matchCountLabel->setText(tr("Invalid regular expression"));
+        return;
+    }
+
+    emit(queryChanged(query, caseSensitiveCheckBox->isChecked(), wholeWordsCheckBox->isChecked(), regex));
+
+    if(query.isEmpty())
+    {
+        matchCountLabel->clear();
+    }
+}
+
+
+/* Shows which match is selected and how many there are, e.g. "Match 37 of 12,480".
+ * @param currentMatch - the one-based number of the selected match, or 0 if no match is selected
+ * @param matchCount - the total number of matches, or -1 if they're still being counted
+ */
+void FindDialog::onMatchCountReady(int currentMatch, int matchCount)
+{
+    QLocale locale;
+
+    if(matchCount < 0)
+    {
+        matchCountLabel->setText(tr("Counting matches..."));
+    }
+    else if(matchCount == 0)
+    {
+        matchCountLabel->setText(tr("No results found."));
+    }
+    else if(currentMatch > 0)
+    {
+        matchCountLabel->setText(tr("Match %1 of %2").arg(locale.toString(currentMatch), locale.toString(matchCount)));
+    }
+    else
+    {
+        matchCountLabel->setText(tr("%1 matches").arg(locale.toString(matchCount)));
+    }
 }
 
 
@@ -109,15 +189,16 @@ void FindDialog::on_replaceOperation_initiated()
     QString with = replaceLineEdit->text();
     bool caseSensitive = caseSensitiveCheckBox->isChecked();
     bool wholeWords = wholeWordsCheckBox->isChecked();
+    bool regex = regexCheckBox->isChecked();
     bool replace = sender() == replaceButton;
 
     if(replace)
     {
-        emit(startReplacing(what, with, caseSensitive, wholeWords));
+        emit(startReplacing(what, with, caseSensitive, wholeWords, regex));
     }
     else
     {
-        emit(startReplacingAll(what, with, caseSensitive, wholeWords));
+        emit(startReplacingAll(what, with, caseSensitive, wholeWords, regex));
     }
 
 }
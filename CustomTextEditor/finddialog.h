@@ -20,27 +20,35 @@ public:
 
 signals:
 
-    void startFinding(QString queryText, bool caseSensitive, bool wholeWords);
-    void startReplacing(QString what, QString with, bool caseSensitive, bool wholeWords);
-    void startReplacingAll(QString what, QString with, bool caseSensitive, bool wholeWords);
+    void startFinding(QString queryText, bool caseSensitive, bool wholeWords, bool regex);
+    void startFindingPrevious(QString queryText, bool caseSensitive, bool wholeWords, bool regex);
+    void queryChanged(QString queryText, bool caseSensitive, bool wholeWords, bool regex);
+    void startReplacing(QString what, QString with, bool caseSensitive, bool wholeWords, bool regex);
+    void startReplacingAll(QString what, QString with, bool caseSensitive, bool wholeWords, bool regex);
 
 public slots:
 
     void on_findNextButton_clicked();
     void on_replaceOperation_initiated();
+    void on_query_changed();
     void onFindResultReady(QString message) { QMessageBox::information(this, "Find and Replace", message); }
+    void onMatchCountReady(int currentMatch, int matchCount);
+    void clearMatchCount() { matchCountLabel->clear(); }
 
 private:
 
     QLabel *findLabel;
     QLabel *replaceLabel;
+    QLabel *matchCountLabel;
     QPushButton *findNextButton;
+    QPushButton *findPreviousButton;
     QPushButton *replaceButton;
     QPushButton *replaceAllButton;
     QLineEdit *findLineEdit;
     QLineEdit *replaceLineEdit;
     QCheckBox *caseSensitiveCheckBox;
     QCheckBox *wholeWordsCheckBox;
+    QCheckBox *regexCheckBox;
 
     QHBoxLayout *findHorizontalLayout;
     QHBoxLayout *replaceHorizontalLayout;
@@ -0,0 +1,61 @@
+#include "findinfilesmodel.h"
+
+
+FindInFilesModel::FindInFilesModel(QObject *parent) : QAbstractListModel(parent)
+{
+}
+
+
+int FindInFilesModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : hits.size();
+}
+
+
+/* Shows each hit as "path:line: text", with the path relative to the directory that was
+ * searched, and the full path as a tool tip.
+ */
+QVariant FindInFilesModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= hits.size())
+    {
+        return QVariant();
+    }
+
+    const FileHit &hit = hits.at(index.row());
+
+    if(role == Qt::DisplayRole)
+    {
+        return rootDirectory.relativeFilePath(hit.filePath) + QLatin1Char(':') + QString::number(hit.line) +
+               QLatin1String(": ") + hit.lineText.trimmed();
+    }
+    if(role == Qt::ToolTipRole)
+    {
+        return QDir::toNativeSeparators(hit.filePath);
+    }
+
+    return QVariant();
+}
+
+
+/* Adds the given hits after the ones already in the model.
+ */
+void FindInFilesModel::append(const QVector<FileHit> &newHits)
+{
+    if(newHits.isEmpty())
+    {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), hits.size(), hits.size() + newHits.size() - 1);
+    hits += newHits;
+    endInsertRows();
+}
+
+
+void FindInFilesModel::clear()
+{
+    beginResetModel();
+    hits.clear();
+    endResetModel();
+}
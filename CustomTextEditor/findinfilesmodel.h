@@ -0,0 +1,33 @@
+#ifndef FINDINFILESMODEL_H
+#define FINDINFILESMODEL_H
+#include <QAbstractListModel>
+#include <QDir>
+#include <QVector>
+#include "filesearch.h"
+
+
+/* The hits of a Find in Files search, one row per hit. Rows are only formatted when a
+ * view asks for them, which (with uniform item sizes) is just the ones on screen, so
+ * the list stays responsive however many hits come in.
+ */
+class FindInFilesModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    FindInFilesModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void setRootDirectory(const QString &directory) { rootDirectory = QDir(directory); }
+    void append(const QVector<FileHit> &newHits);
+    void clear();
+    inline const FileHit &hitAt(int row) const { return hits.at(row); }
+
+private:
+    QVector<FileHit> hits;
+    QDir rootDirectory;
+};
+
+#endif // FINDINFILESMODEL_H
@@ -0,0 +1,251 @@
+#include "findinfilespanel.h"
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QLocale>
+#include <QRegularExpression>
+
+
+const int FindInFilesPanel::maxHits;
+
+
+/* Initializes this FindInFilesPanel object.
+ */
+FindInFilesPanel::FindInFilesPanel(QWidget *parent)
+    : QWidget(parent)
+{
+    // Initialize all members
+    findLabel = new QLabel(tr("Find what:"));
+    directoryLabel = new QLabel(tr("In:"));
+    filtersLabel = new QLabel(tr("Files:"));
+    maxSizeLabel = new QLabel(tr("Skip files over:"));
+    statusLabel = new QLabel();
+    findLineEdit = new QLineEdit();
+    directoryLineEdit = new QLineEdit();
+    filtersLineEdit = new QLineEdit(QStringLiteral("*"));
+    maxSizeSpinBox = new QSpinBox();
+    browseButton = new QPushButton(tr("..."));
+    searchButton = new QPushButton(tr("&Search"));
+    caseSensitiveCheckBox = new QCheckBox(tr("&Match case"));
+    wholeWordsCheckBox = new QCheckBox(tr("&Whole words"));
+    regexCheckBox = new QCheckBox(tr("Regular e&xpression"));
+    resultsView = new QListView();
+
+    search = new FileSearch(this);
+    model = new FindInFilesModel(this);
+
+    filtersLineEdit->setToolTip(tr("Wildcards separated by spaces or semicolons, e.g. *.cpp *.h"));
+    maxSizeSpinBox->setRange(1, 2047);
+    maxSizeSpinBox->setValue(16);
+    maxSizeSpinBox->setSuffix(tr(" MB"));
+    searchButton->setDefault(true);
+
+    // Every row is one line of text, so the view only ever lays out the rows on screen
+    resultsView->setModel(model);
+    resultsView->setUniformItemSizes(true);
+    resultsView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    setFocusProxy(findLineEdit);
+
+    // Set up all the widgets and layouts
+    findHorizontalLayout = new QHBoxLayout();
+    optionsLayout = new QHBoxLayout();
+    verticalLayout = new QVBoxLayout();
+
+    verticalLayout->addLayout(findHorizontalLayout);
+    verticalLayout->addLayout(optionsLayout);
+    verticalLayout->addWidget(resultsView);
+    verticalLayout->addWidget(statusLabel);
+
+    findHorizontalLayout->addWidget(findLabel);
+    findHorizontalLayout->addWidget(findLineEdit, 2);
+    findHorizontalLayout->addWidget(directoryLabel);
+    findHorizontalLayout->addWidget(directoryLineEdit, 2);
+    findHorizontalLayout->addWidget(browseButton);
+
+    optionsLayout->addWidget(filtersLabel);
+    optionsLayout->addWidget(filtersLineEdit);
+    optionsLayout->addWidget(maxSizeLabel);
+    optionsLayout->addWidget(maxSizeSpinBox);
+    optionsLayout->addWidget(caseSensitiveCheckBox);
+    optionsLayout->addWidget(wholeWordsCheckBox);
+    optionsLayout->addWidget(regexCheckBox);
+    optionsLayout->addWidget(searchButton);
+
+    setLayout(verticalLayout);
+
+    connect(searchButton, SIGNAL(clicked()), this, SLOT(on_searchButton_clicked()));
+    connect(findLineEdit, SIGNAL(returnPressed()), this, SLOT(on_searchButton_clicked()));
+    connect(browseButton, SIGNAL(clicked()), this, SLOT(on_browseButton_clicked()));
+    connect(resultsView, SIGNAL(activated(QModelIndex)), this, SLOT(on_result_activated(QModelIndex)));
+    connect(resultsView, SIGNAL(clicked(QModelIndex)), this, SLOT(on_result_activated(QModelIndex)));
+    connect(search, SIGNAL(hitsFound(QVector<FileHit>)), this, SLOT(on_hitsFound(QVector<FileHit>)));
+    connect(search, SIGNAL(progressChanged(int, int)), this, SLOT(on_progressChanged(int, int)));
+    connect(search, SIGNAL(finished(bool)), this, SLOT(on_searchFinished(bool)));
+}
+
+
+/* Performs all required memory cleanup operations.
+ */
+FindInFilesPanel::~FindInFilesPanel()
+{
+    delete search;
+    delete findLabel;
+    delete directoryLabel;
+    delete filtersLabel;
+    delete maxSizeLabel;
+    delete statusLabel;
+    delete findLineEdit;
+    delete directoryLineEdit;
+    delete filtersLineEdit;
+    delete maxSizeSpinBox;
+    delete browseButton;
+    delete searchButton;
+    delete caseSensitiveCheckBox;
+    delete wholeWordsCheckBox;
+    delete regexCheckBox;
+    delete resultsView;
+    delete findHorizontalLayout;
+    delete optionsLayout;
+    delete verticalLayout;
+}
+
+
+/* Sets the directory the next search will look in.
+ */
+void FindInFilesPanel::setDirectory(const QString &directory)
+{
+    directoryLineEdit->setText(QDir::toNativeSeparators(directory));
+}
+
+
+/* Called when the user clicks the Search button (or hits Enter in the query field). Starts
+ * a search with the given criteria, or cancels the one that's running.
+ */
+void FindInFilesPanel::on_searchButton_clicked()
+{
+    if(search->isRunning())
+    {
+        search->cancel();
+        return;
+    }
+
+    QString query = findLineEdit->text();
+    QString directory = QDir::fromNativeSeparators(directoryLineEdit->text().trimmed());
+
+    if(query.isEmpty())
+    {
+        QMessageBox::information(this, tr("Empty Field"), tr("Please enter a query."));
+        return;
+    }
+
+    if(directory.isEmpty() || !QFileInfo(directory).isDir())
+    {
+        QMessageBox::information(this, tr("Find in Files"), tr("Please choose a directory to search."));
+        return;
+    }
+
+    SearchPattern pattern(query, caseSensitiveCheckBox->isChecked(), wholeWordsCheckBox->isChecked(), regexCheckBox->isChecked());
+    if(!pattern.isValid())
+    {
+        QMessageBox::information(this, tr("Find in Files"), tr("Invalid regular expression: ") + pattern.getErrorString());
+        return;
+    }
+
+    QStringList nameFilters = filtersLineEdit->text().split(QRegularExpression("[\\s;,]+"), QString::SkipEmptyParts);
+    qint64 maxFileSize = qint64(maxSizeSpinBox->value()) * 1024 * 1024;
+
+    model->clear();
+    model->setRootDirectory(directory);
+    hitLimitReached = false;
+
+    searchButton->setText(tr("&Cancel"));
+    statusLabel->setText(tr("Looking for files..."));
+    search->start(directory, nameFilters, maxFileSize, pattern);
+}
+
+
+/* Called when the user clicks the button next to the directory field. Lets the user pick
+ * the directory to search.
+ */
+void FindInFilesPanel::on_browseButton_clicked()
+{
+    QString directory = QFileDialog::getExistingDirectory(this, tr("Find in Files"), directoryLineEdit->text());
+
+    if(!directory.isNull())
+    {
+        setDirectory(directory);
+    }
+}
+
+
+/* Called whenever a file turns up hits. Adds them to the results, and stops the search
+ * once there are maxHits of them.
+ */
+void FindInFilesPanel::on_hitsFound(QVector<FileHit> hits)
+{
+    if(hitLimitReached)
+    {
+        return;
+    }
+
+    int room = maxHits - model->rowCount();
+    if(hits.size() >= room)
+    {
+        hits.resize(room);
+        hitLimitReached = true;
+        search->cancel();
+    }
+
+    model->append(hits);
+}
+
+
+/* Shows how many files have been searched so far, e.g. "Searched 1,200 of 8,450 files... 37 results".
+ */
+void FindInFilesPanel::on_progressChanged(int filesSearched, int fileCount)
+{
+    QLocale locale;
+    statusLabel->setText(tr("Searched %1 of %2 files... %3 results").arg(locale.toString(filesSearched),
+                                                                          locale.toString(fileCount),
+                                                                          locale.toString(model->rowCount())));
+}
+
+
+/* Called once the search is over. Sums up what it found.
+ * @param cancelled - flag denoting whether the search was stopped before searching every file
+ */
+void FindInFilesPanel::on_searchFinished(bool cancelled)
+{
+    QLocale locale;
+    QString results = tr("%1 results").arg(locale.toString(model->rowCount()));
+
+    searchButton->setText(tr("&Search"));
+
+    if(hitLimitReached)
+    {
+        statusLabel->setText(results + tr(" (stopped at the limit)"));
+    }
+    else if(cancelled)
+    {
+        statusLabel->setText(results + tr(" (cancelled)"));
+    }
+    else
+    {
+        statusLabel->setText(results);
+    }
+}
+
+
+/* Called when the user clicks a result (or hits Enter on it).
+ */
+void FindInFilesPanel::on_result_activated(const QModelIndex &index)
+{
+    if(!index.isValid())
+    {
+        return;
+    }
+
+    const FileHit &hit = model->hitAt(index.row());
+    emit(resultActivated(hit.filePath, hit.line));
+}
@@ -0,0 +1,70 @@
+#ifndef FINDINFILESPANEL_H
+#define FINDINFILESPANEL_H
+#include <QWidget>
+#include <QString>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QLabel>
+#include <QListView>
+#include <QLayout>
+#include <QModelIndex>
+#include "filesearch.h"
+#include "findinfilesmodel.h"
+
+class FindInFilesPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+
+    FindInFilesPanel(QWidget *parent = nullptr);
+    ~FindInFilesPanel();
+
+    void setDirectory(const QString &directory);
+    inline bool hasDirectory() const { return !directoryLineEdit->text().isEmpty(); }
+
+    static const int maxHits = 100000;
+
+signals:
+
+    void resultActivated(QString filePath, int line);
+
+private slots:
+
+    void on_searchButton_clicked();
+    void on_browseButton_clicked();
+    void on_hitsFound(QVector<FileHit> hits);
+    void on_progressChanged(int filesSearched, int fileCount);
+    void on_searchFinished(bool cancelled);
+    void on_result_activated(const QModelIndex &index);
+
+private:
+
+    QLabel *findLabel;
+    QLabel *directoryLabel;
+    QLabel *filtersLabel;
+    QLabel *maxSizeLabel;
+    QLabel *statusLabel;
+    QLineEdit *findLineEdit;
+    QLineEdit *directoryLineEdit;
+    QLineEdit *filtersLineEdit;
+    QSpinBox *maxSizeSpinBox;
+    QPushButton *browseButton;
+    QPushButton *searchButton;
+    QCheckBox *caseSensitiveCheckBox;
+    QCheckBox *wholeWordsCheckBox;
+    QCheckBox *regexCheckBox;
+    QListView *resultsView;
+
+    QHBoxLayout *findHorizontalLayout;
+    QHBoxLayout *optionsLayout;
+    QVBoxLayout *verticalLayout;
+
+    FileSearch *search;
+    FindInFilesModel *model;
+    bool hitLimitReached = false;
+};
+
+#endif // FINDINFILESPANEL_H
@@ -0,0 +1,320 @@
+#include "grammar.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+using namespace ProgrammingLanguage;
+
+
+namespace
+{
+    QDataStream &operator<<(QDataStream &stream, const Lexer::Syntax &syntax)
+    {
+        return stream << syntax.keywords << syntax.caseInsensitiveKeywords << syntax.lineComment
+                      << syntax.blockCommentStart << syntax.blockCommentEnd << syntax.quotes
+                      << syntax.tripleQuotedStrings << syntax.digitSeparators << syntax.identifierStart
+                      << syntax.identifierCharacters << syntax.capitalizedClassNames;
+    }
+
+    QDataStream &operator>>(QDataStream &stream, Lexer::Syntax &syntax)
+    {
+        return stream >> syntax.keywords >> syntax.caseInsensitiveKeywords >> syntax.lineComment
+                      >> syntax.blockCommentStart >> syntax.blockCommentEnd >> syntax.quotes
+                      >> syntax.tripleQuotedStrings >> syntax.digitSeparators >> syntax.identifierStart
+                      >> syntax.identifierCharacters >> syntax.capitalizedClassNames;
+    }
+}
+
+
+const QString Grammar::builtInDirectory = ":/languages/res/languages";
+const quint32 Grammar::cacheMagic;
+const quint32 Grammar::cacheVersion;
+
+
+/* Returns the grammar of the given language, or a null pointer if there's no such
+ * language (as for Language(), no language at all).
+ */
+QSharedPointer<const Grammar> Grammar::of(const Language &language)
+{
+    return catalog().grammars.value(language);
+}
+
+
+/* Returns the names of all the languages with a definition, in alphabetical order.
+ */
+QStringList Grammar::languages()
+{
+    QStringList names = catalog().grammars.keys();
+    names.sort(Qt::CaseInsensitive);
+    return names;
+}
+
+
+/* Creates a grammar around the given lexer, with the usual formats.
+ */
+Grammar::Grammar(const Lexer &lexer) : lexer(lexer)
+{
+    //关键字样式
+    keywordFormat.setForeground(Qt::darkBlue);
+    keywordFormat.setFontWeight(QFont::Bold);
+
+    //类的样式
+    classFormat.setFontWeight(QFont::Bold);
+    classFormat.setForeground(Qt::darkMagenta);
+
+    functionFormat.setFontItalic(true);
+    functionFormat.setForeground(Qt::blue);
+
+    //设置引用
+    quoteFormat.setForeground(Qt::darkGreen);
+
+    //行内注释
+    inlineCommentFormat.setForeground(Qt::darkGreen);
+
+    //块状注释
+    blockCommentFormat.setForeground(Qt::darkGreen);
+}
+
+
+/* Returns the format that tokens of the given type are highlighted with.
+ */
+const QTextCharFormat &Grammar::formatFor(Lexer::TokenType type) const
+{
+    switch(type)
+    {
+        case(Lexer::Keyword): return keywordFormat;
+        case(Lexer::ClassName): return classFormat;
+        case(Lexer::FunctionName): return functionFormat;
+        case(Lexer::Quote): return quoteFormat;
+        case(Lexer::InlineComment): return inlineCommentFormat;
+        default: return blockCommentFormat;
+    }
+}
+
+
+/* Returns why each definition that couldn't be loaded was skipped, one line per file.
+ */
+QStringList Grammar::loadErrors()
+{
+    return catalog().errors;
+}
+
+
+/* Returns every language's grammar, loading them all the first time it's called.
+ */
+const Grammar::Catalog &Grammar::catalog()
+{
+    static const Catalog catalog = loadAll();
+    return catalog;
+}
+
+
+/* Loads the built-in definitions, then the user's. A user's definition replaces the
+ * built-in one of the same name. Definitions that can't be read are skipped, and the
+ * reason noted.
+ */
+Grammar::Catalog Grammar::loadAll()
+{
+    Catalog catalog;
+    const QStringList directories = {builtInDirectory, QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/languages"};
+
+    for(const QString &directory : directories)
+    {
+        for(const QFileInfo &file : QDir(directory).entryInfoList(QStringList("*.json"), QDir::Files, QDir::Name))
+        {
+            QString error;
+            QSharedPointer<const Grammar> grammar = load(file.filePath(), &error);
+
+            if(grammar)
+            {
+                catalog.grammars.insert(grammar->name, grammar);
+            }
+            else
+            {
+                catalog.errors.append(QDir::toNativeSeparators(file.filePath()) + ": " + error);
+            }
+        }
+    }
+
+    return catalog;
+}
+
+
+/* Returns the grammar defined by the given file, read back from the cache if it was
+ * compiled before, and otherwise compiled now (and cached for next time). Returns a null
+ * pointer, and describes the problem in error, if the definition can't be read or isn't
+ * valid.
+ */
+QSharedPointer<const Grammar> Grammar::load(const QString &definitionPath, QString *error)
+{
+    QFile file(definitionPath);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        *error = file.errorString();
+        return QSharedPointer<const Grammar>();
+    }
+
+    const QByteArray definition = file.readAll();
+    const QString cachePath = cachePathFor(definition);
+
+    QSharedPointer<const Grammar> grammar = readCompiled(cachePath);
+    if(grammar)
+    {
+        return grammar;
+    }
+
+    grammar = compile(definition, error);
+
+    if(!grammar)
+    {
+        return grammar;
+    }
+
+    writeCompiled(*grammar, cachePath);
+    return grammar;
+}
+
+
+/* Compiles a language definition. Returns a null pointer, and describes what's wrong
+ * with the definition in error, if it isn't valid.
+ * @param definition - the contents of a definition file
+ * @param error - receives the reason the definition isn't valid
+ */
+QSharedPointer<const Grammar> Grammar::compile(const QByteArray &definition, QString *error)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(definition, &parseError);
+
+    if(!document.isObject())
+    {
+        *error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : "not a JSON object";
+        return QSharedPointer<const Grammar>();
+    }
+
+    const QJsonObject object = document.object();
+    const QString name = object.value("name").toString();
+
+    if(name.isEmpty())
+    {
+        *error = "the language has no name";
+        return QSharedPointer<const Grammar>();
+    }
+
+    Lexer::Syntax syntax;
+    syntax.keywords = object.value("keywords").toVariant().toStringList();
+    syntax.caseInsensitiveKeywords = object.value("caseInsensitiveKeywords").toBool(syntax.caseInsensitiveKeywords);
+    syntax.lineComment = object.value("lineComment").toString();
+    syntax.quotes = object.value("quotes").toString(syntax.quotes);
+    syntax.tripleQuotedStrings = object.value("tripleQuotedStrings").toBool(syntax.tripleQuotedStrings);
+    syntax.digitSeparators = object.value("digitSeparators").toString();
+    syntax.identifierStart = object.value("identifierStart").toString();
+    syntax.identifierCharacters = object.value("identifierCharacters").toString();
+    syntax.capitalizedClassNames = object.value("capitalizedClassNames").toBool(syntax.capitalizedClassNames);
+
+    const QStringList blockComment = object.value("blockComment").toVariant().toStringList();
+
+    if(blockComment.size() == 2 && !blockComment.at(0).isEmpty() && !blockComment.at(1).isEmpty())
+    {
+        syntax.blockCommentStart = blockComment.at(0);
+        syntax.blockCommentEnd = blockComment.at(1);
+    }
+    else if(!blockComment.isEmpty())
+    {
+        *error = "blockComment should be a start and an end";
+        return QSharedPointer<const Grammar>();
+    }
+
+    QSharedPointer<Grammar> grammar(new Grammar(Lexer(syntax)));
+    grammar->name = name;
+    grammar->extensions = object.value("extensions").toVariant().toStringList();
+    grammar->indentAfterColon = object.value("indentAfterColon").toBool(false);
+    return grammar;
+}
+
+
+/* Reads back a compiled grammar. Returns a null pointer if there's none at the given
+ * path, or if it was written by a different version of the cache format or is damaged.
+ */
+QSharedPointer<const Grammar> Grammar::readCompiled(const QString &cachePath)
+{
+    QFile file(cachePath);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return QSharedPointer<const Grammar>();
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_9);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+
+    if(magic != cacheMagic || version != cacheVersion)
+    {
+        return QSharedPointer<const Grammar>();
+    }
+
+    Language name;
+    QStringList extensions;
+    bool indentAfterColon = false;
+    Lexer::Syntax syntax;
+    KeywordTable keywords;
+    in >> name >> extensions >> indentAfterColon >> syntax >> keywords;
+
+    if(in.status() != QDataStream::Ok || name.isEmpty())
+    {
+        return QSharedPointer<const Grammar>();
+    }
+
+    QSharedPointer<Grammar> grammar(new Grammar(Lexer(syntax, keywords)));
+    grammar->name = name;
+    grammar->extensions = extensions;
+    grammar->indentAfterColon = indentAfterColon;
+    return grammar;
+}
+
+
+/* Saves a compiled grammar. The cache is only a shortcut, so failing to write it is
+ * ignored; the definition is simply compiled again next time.
+ */
+void Grammar::writeCompiled(const Grammar &grammar, const QString &cachePath)
+{
+    QDir().mkpath(QFileInfo(cachePath).path());
+    QSaveFile file(cachePath);
+
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_9);
+    out << cacheMagic << cacheVersion;
+    out << grammar.name << grammar.extensions << grammar.indentAfterColon;
+    out << grammar.lexer.getSyntax() << grammar.lexer.getKeywords();
+    file.commit();
+}
+
+
+/* Returns where the compiled form of the given definition is cached: a file named after
+ * a hash of the definition (and the cache format), so an edited definition gets a file
+ * of its own rather than a stale one.
+ */
+QString Grammar::cachePathFor(const QByteArray &definition)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(cacheVersion) + '\n');
+    hash.addData(definition);
+
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/grammars";
+    return directory + "/" + QString::fromLatin1(hash.result().toHex()) + ".grammar";
+}
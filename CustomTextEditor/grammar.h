@@ -0,0 +1,96 @@
+#ifndef GRAMMAR_H
+#define GRAMMAR_H
+#include "lexer.h"
+#include "language.h"
+#include <QSharedPointer>
+#include <QTextCharFormat>
+#include <QByteArray>
+#include <QStringList>
+#include <QMap>
+
+
+/* A language's compiled grammar: its lexer (along with the keyword table, whose perfect
+ * hash takes a search to build) and the format each kind of token is colored with.
+ * Grammars never change once compiled, so all the highlighters of a language (one per
+ * tab) share one, as do the worker threads lexing for them.
+ *
+ * Languages are defined by JSON files. The built-in ones are compiled into the program's
+ * resources; files in the user's languages directory (under AppDataLocation) add more,
+ * or replace the built-in language with the same name. A definition looks like this:
+ *
+ *     {
+ *         "name": "Shell",
+ *         "extensions": ["sh", "bash"],
+ *         "keywords": ["if", "then", "else", "fi", ...],
+ *         "caseInsensitiveKeywords": false,
+ *         "lineComment": "#",
+ *         "quotes": "\"'`",
+ *         "tripleQuotedStrings": false,
+ *         "digitSeparators": "",
+ *         "identifierStart": "",
+ *         "identifierCharacters": "",
+ *         "capitalizedClassNames": false,
+ *         "indentAfterColon": false
+ *     }
+ *
+ * Only the name is required; see Lexer::Syntax for what the rest mean and default to.
+ * A language with block comments gives their start and end as "blockComment", a pair of
+ * strings. indentAfterColon makes Enter after a colon indent the next line, as in Python.
+ *
+ * Every definition is compiled when the first grammar is asked for. The compiled form is
+ * saved in the cache directory, named after a hash of the definition's contents, and
+ * read back from there as long as the definition doesn't change, so the keyword tables
+ * are only ever built once. Definitions that can't be read or aren't valid are skipped;
+ * loadErrors says why, so the user can be told.
+ */
+class Grammar
+{
+public:
+    static QSharedPointer<const Grammar> of(const ProgrammingLanguage::Language &language);
+    static QStringList languages();
+    static QStringList loadErrors();
+
+    inline const ProgrammingLanguage::Language &getName() const { return name; }
+    inline const QStringList &getExtensions() const { return extensions; }
+    inline bool indentsAfterColon() const { return indentAfterColon; }
+    inline const Lexer &getLexer() const { return lexer; }
+    const QTextCharFormat &formatFor(Lexer::TokenType type) const;
+
+private:
+    Grammar(const Lexer &lexer);
+
+    typedef QMap<ProgrammingLanguage::Language, QSharedPointer<const Grammar>> Grammars;
+
+    // Every grammar that loaded, and what went wrong with the definitions that didn't
+    struct Catalog
+    {
+        Grammars grammars;
+        QStringList errors;
+    };
+
+    static const Catalog &catalog();
+    static Catalog loadAll();
+    static QSharedPointer<const Grammar> load(const QString &definitionPath, QString *error);
+    static QSharedPointer<const Grammar> compile(const QByteArray &definition, QString *error);
+    static QSharedPointer<const Grammar> readCompiled(const QString &cachePath);
+    static void writeCompiled(const Grammar &grammar, const QString &cachePath);
+    static QString cachePathFor(const QByteArray &definition);
+
+    ProgrammingLanguage::Language name;
+    QStringList extensions;
+    bool indentAfterColon = false;
+    Lexer lexer;
+
+    QTextCharFormat keywordFormat;
+    QTextCharFormat classFormat;
+    QTextCharFormat inlineCommentFormat;
+    QTextCharFormat blockCommentFormat;
+    QTextCharFormat quoteFormat;
+    QTextCharFormat functionFormat;
+
+    static const QString builtInDirectory;
+    static const quint32 cacheMagic = 0x53475243;
+    static const quint32 cacheVersion = 1;
+};
+
+#endif // GRAMMAR_H
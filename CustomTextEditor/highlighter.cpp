@@ -1,300 +1,488 @@
 #include "highlighter.h"
+#include <QElapsedTimer>
+#include <QTextCursor>
+#include <QtConcurrent>
 #include <QtDebug>
+#include <climits>
 
 
-void Highlighter::addKeywords(QStringList keywords)
+namespace
 {
-    setKeywordFormat();
+    // A block's user state holds the state it ends in, the state it was lexed with and
+    // whether its formats are current; -1 (the default) means its text has changed since
+    const int formattedFlag = 1 << 16;
 
-    foreach(const QString &keyword, keywords)
+    inline int pack(int incomingState, int endState, bool formatted)
     {
-        addRule(QRegularExpression(keyword), keywordFormat);
+        return (incomingState << 8) | endState | (formatted ? formattedFlag : 0);
     }
-}
 
+    inline int endStateOf(int userState) { return userState & 0xFF; }
+    inline int incomingStateOf(int userState) { return (userState >> 8) & 0xFF; }
+    inline bool isFormatted(int userState) { return (userState & formattedFlag) != 0; }
 
-void Highlighter::setKeywordFormat()//关键字样式
-{
-    keywordFormat.setForeground(Qt::darkBlue);
-    keywordFormat.setFontWeight(QFont::Bold);
+    // Whether a block with the given user state needs no more work, given its incoming state
+    inline bool isCurrent(int userState, int incomingState, bool format)
+    {
+        return userState >= 0 && incomingStateOf(userState) == incomingState && (isFormatted(userState) || !format);
+    }
 }
 
 
-void Highlighter::setClassPattern(QRegularExpression classPattern)//类的样式
+const int Highlighter::sliceMilliseconds;
+
+
+/* Creates a highlighter that colors a document with the given grammar. Nothing is
+ * highlighted until control returns to the event loop, or until the visible blocks are
+ * reported.
+ * @param grammar - the compiled grammar of the document's language
+ * @param parent - the document to highlight
+ */
+Highlighter::Highlighter(QSharedPointer<const Grammar> grammar, QTextDocument *parent)
+    : QObject(parent), document(parent), grammar(grammar)
 {
-    setClassFormat();
-    addRule(classPattern, classFormat);
+    sweepTimer.setSingleShot(true);
+    sweepTimer.setInterval(0);
+
+    knownBlockCount = document->blockCount();
+
+    connect(document, SIGNAL(contentsChange(int, int, int)), this, SLOT(on_contentsChange(int, int, int)));
+    connect(&sweepTimer, SIGNAL(timeout()), this, SLOT(highlightInBackground()));
+    connect(&lexWatcher, SIGNAL(finished()), this, SLOT(on_lexingFinished()));
+
+    restartSweep();
 }
 
 
-void Highlighter::setClassFormat()
+/* Stops any lexing in progress and removes all highlighting from the document, so that
+ * another highlighter (or none) can take over.
+ */
+Highlighter::~Highlighter()
 {
-    classFormat.setFontWeight(QFont::Bold);
-    classFormat.setForeground(Qt::darkMagenta);
+    cancelLexing();
+    lexWatcher.waitForFinished();
+
+    for(QTextBlock block = document->begin(); block.isValid(); block = block.next())
+    {
+        block.setUserState(-1);
+
+        if(!block.layout()->formats().isEmpty())
+        {
+            block.layout()->clearFormats();
+            document->markContentsDirty(block.position(), block.length());
+        }
+    }
 }
 
 
-void Highlighter::setFunctionPattern(QRegularExpression functionPattern)
+/* Highlights the given range of blocks (the ones on screen) right away, finding the
+ * states of any blocks above them the state frontier hasn't reached yet (from the latest
+ * lexed snapshot, where it can be used). The rest of the document is then highlighted in
+ * the background, outward from these blocks.
+ * @param first - the number of the first visible block
+ * @param last - the number of the last visible block
+ */
+void Highlighter::setVisibleBlocks(int first, int last)
 {
-    setFunctionFormat();
-    addRule(functionPattern, functionFormat);
+    firstVisible = first;
+    lastVisible = last;
+
+    QTextBlock block = document->findBlockByNumber(first);
+    for(int number = first; block.isValid() && number <= last; number++, block = block.next())
+    {
+        highlight(block, number);
+    }
+
+    restartSweep();
 }
 
 
-void Highlighter::setFunctionFormat()
+/* Called when the document's text changes. The blocks the edit touched are marked as
+ * changed and the state frontier is moved back to the first of them; they (and any
+ * blocks after them that end up in a different state) are highlighted again as usual.
+ */
+void Highlighter::on_contentsChange(int position, int charsRemoved, int charsAdded)
 {
-    functionFormat.setFontItalic(true);
-    functionFormat.setForeground(Qt::blue);
+    Q_UNUSED(charsRemoved);
+
+    QTextBlock block = document->findBlock(position);
+    const QTextBlock last = document->findBlock(position + charsAdded);
+
+    if(!block.isValid())
+    {
+        return;
+    }
+
+    stateFrontier = qMin(stateFrontier, block.blockNumber());
+
+    // Lexed blocks past an added or removed one no longer have the same numbers
+    if(document->blockCount() != knownBlockCount)
+    {
+        knownBlockCount = document->blockCount();
+        lexedValidEnd = qMin(lexedValidEnd, block.blockNumber());
+    }
+
+    const int firstEdited = block.blockNumber();
+    int lastEdited = firstEdited;
+
+    for(; block.isValid(); block = block.next(), lastEdited++)
+    {
+        block.setUserState(-1);
+
+        if(block == last)
+        {
+            break;
+        }
+    }
+
+    markEdited(firstEdited, lastEdited);
+    restartSweep();
 }
 
 
-void Highlighter::setQuotePattern(QRegularExpression quotePattern)
+/* Notes that the given range of blocks was edited, so that the latest lexed snapshot
+ * (or the one being lexed) isn't used for them.
+ */
+void Highlighter::markEdited(int firstBlock, int lastBlock)
 {
-    setQuoteFormat();
-    addRule(quotePattern, quoteFormat);
+    editedSinceLexing = true;
+
+    if(lexing)
+    {
+        editedWhileLexing.append(qMakePair(firstBlock, lastBlock));
+    }
+
+    const int end = qMin(lastBlock - lexed.firstBlock + 1, lexed.edited.size());
+    for(int i = qMax(0, firstBlock - lexed.firstBlock); i < end; i++)
+    {
+        lexed.edited[i] = true;
+    }
 }
 
 
-void Highlighter::setQuoteFormat()//设置引用
+/* Highlights blocks for a few milliseconds, picking whichever of the next block above the
+ * viewport and the next one below it is nearer, then yields to the event loop. Stops once
+ * it runs out of blocks in both directions, and pauses when it comes across a block that
+ * has to be lexed first (see startLexing).
+ */
+void Highlighter::highlightInBackground()
 {
-    quoteFormat.setForeground(Qt::darkGreen);
+    QElapsedTimer timer;
+    timer.start();
+
+    while(timer.elapsed() < sliceMilliseconds)
+    {
+        if(!above.isValid() && !below.isValid())
+        {
+            return;
+        }
+
+        // The sweep downward starts within the viewport, so those blocks come first
+        const bool downward = below.isValid() && (!above.isValid() || qMax(0, belowNumber - lastVisible) <= firstVisible - aboveNumber);
+        QTextBlock &block = downward ? below : above;
+        int &blockNumber = downward ? belowNumber : aboveNumber;
+
+        // Should an up-to-date snapshot somehow not do for a block it covers, the block is lexed here instead
+        if(needsLexing(block, blockNumber))
+        {
+            if(lexing)
+            {
+                return;
+            }
+
+            const int index = blockNumber - lexed.firstBlock;
+            if(index < 0 || index >= lexed.endStates.size() || editedSinceLexing)
+            {
+                startLexing();
+                return;
+            }
+        }
+
+        highlight(block, blockNumber);
+        block = downward ? block.next() : block.previous();
+        blockNumber += downward ? 1 : -1;
+    }
+
+    sweepTimer.start();
 }
 
 
-void Highlighter::setInlineCommentPattern(QRegularExpression inlineCommentPattern)//行内注释
+/* Brings the given block's formats up to date, first moving the state frontier up to it.
+ * @param block - the block to highlight
+ * @param blockNumber - its number
+ */
+void Highlighter::highlight(QTextBlock block, int blockNumber)
 {
-    setInlineCommentFormat();
-    addRule(inlineCommentPattern, inlineCommentFormat);
+    advanceFrontier(blockNumber);
+    update(block, blockNumber, stateBefore(block, blockNumber), true);
+    stateFrontier = qMax(stateFrontier, blockNumber + 1);
 }
 
 
-void Highlighter::setInlineCommentFormat()
+/* Returns true if highlighting the given block would mean lexing it on this thread: its
+ * formats aren't current, and the latest lexed snapshot can't be used for it.
+ */
+bool Highlighter::needsLexing(QTextBlock block, int blockNumber)
 {
-    inlineCommentFormat.setForeground(Qt::darkGreen);
+    advanceFrontier(blockNumber);
+
+    const int incomingState = stateBefore(block, blockNumber);
+    return !isCurrent(block.userState(), incomingState, true) && lexedIndexOf(block, blockNumber, incomingState) < 0;
 }
 
 
-void Highlighter::setBlockCommentStartPattern(QRegularExpression blockCommentStart)//块状注释
+/* Brings the given block up to date, unless its text and incoming state are the same as
+ * the last time (and, if it's to be formatted, its formats are current). It's colored
+ * from the latest lexed snapshot if possible, and otherwise lexed on the spot, or found
+ * in the LexCache if a block with the same text and incoming state was lexed before.
+ * Returns the state the block ends in.
+ * @param block - the block to update
+ * @param blockNumber - its number
+ * @param incomingState - the state the previous block ends in
+ * @param format - whether to apply the block's formats too, or only find its state
+ */
+int Highlighter::update(QTextBlock block, int blockNumber, int incomingState, bool format)
 {
-    setBlockCommentFormat();
-    this->blockCommentStart = blockCommentStart;
+    const int userState = block.userState();
+
+    if(isCurrent(userState, incomingState, format))
+    {
+        return endStateOf(userState);
+    }
+
+    int endState = Lexer::Normal;
+    ranges.clear();
+    const int index = lexedIndexOf(block, blockNumber, incomingState);
+
+    if(index >= 0)
+    {
+        endState = lexed.endStates.at(index);
+
+        for(int i = index > 0 ? lexed.runEnds.at(index - 1) : 0; format && i < lexed.runEnds.at(index); i++)
+        {
+            appendRange(lexed.runs.at(i));
+        }
+    }
+    else
+    {
+        const QString text = block.text();
+        runs.clear();
+        endState = LexCache::shared().tokenize(*grammar, text.constData(), text.length(), incomingState, &runs, &tokens);
+
+        for(int i = 0; format && i < runs.size(); i++)
+        {
+            appendRange(runs.at(i));
+        }
+    }
+
+    if(format)
+    {
+        applyFormats(block);
+    }
+
+    block.setUserState(pack(incomingState, endState, format));
+    return endState;
 }
 
 
-void Highlighter::setBlockCommentEndPattern(QRegularExpression blockCommentEnd)
+/* Returns where the given block is among the lexed blocks, or -1 if their result can't be
+ * used for it: it isn't among them, it was edited since the snapshot was taken, or the
+ * snapshot lexed it with a different incoming state.
+ */
+int Highlighter::lexedIndexOf(const QTextBlock &block, int blockNumber, int incomingState) const
 {
-    this->blockCommentEnd = blockCommentEnd;
+    const int index = blockNumber - lexed.firstBlock;
+
+    if(index < 0 || index >= lexed.endStates.size() || blockNumber >= lexedValidEnd || lexed.edited.at(index))
+    {
+        return -1;
+    }
+
+    const int lexedIncomingState = index > 0 ? int(lexed.endStates.at(index - 1)) : lexed.incomingState;
+    return lexedIncomingState == incomingState ? index : -1;
 }
 
 
-void Highlighter::setBlockCommentFormat()
+/* Returns the state the block before the given one ends in, which must be known.
+ */
+int Highlighter::stateBefore(const QTextBlock &block, int blockNumber) const
 {
-    blockCommentFormat.setForeground(Qt::darkGreen);
+    return blockNumber > 0 ? endStateOf(block.previous().userState()) : int(Lexer::Normal);
 }
 
 
-void Highlighter::addRule(QRegularExpression pattern, QTextCharFormat format)
+void Highlighter::appendRange(const Run &run)
 {
-    HighlightingRule rule;
-    rule.pattern = pattern;
-    rule.format = format;
-    rules.append(rule);
+    QTextLayout::FormatRange range;
+    range.start = run.start;
+    range.length = int(run.lengthAndType >> 3);
+    range.format = grammar->formatFor(Lexer::TokenType(run.lengthAndType & 7));
+    ranges.append(range);
 }
 
 
-/* Called whenever blocks of text change within the document. Used to apply custom
- * formatting/syntax highlighting to the given text.
- * @param text - the text to be parsed for pattern matches
+/* Colors the given block with the ranges just appended.
  */
-void Highlighter::highlightBlock(const QString &text)
+void Highlighter::applyFormats(QTextBlock block)
 {
-    // Try to find matches for all rules (except comments) and apply their formatting
-    foreach(const HighlightingRule &rule, rules)
+    // Laying the block out again is the expensive part, so it's skipped if nothing changed
+    QTextLayout *layout = block.layout();
+    if(layout->formats() == ranges)
     {
-        QRegularExpressionMatchIterator iterator = rule.pattern.globalMatch(text);
-
-        while(iterator.hasNext())
-        {
-            QRegularExpressionMatch match = iterator.next();
-            setFormat(match.capturedStart(), match.capturedLength(), rule.format);
-        }
+        return;
     }
 
-    highlightMultilineComments(text);//多行注释
+    layout->setFormats(ranges);
+    document->markContentsDirty(block.position(), block.length());
 }
 
 
-/* Formats multiline comments per this Highlighter's
- * blockCommentStart and blockCommentEnd patterns.
+/* Finds the state every block before the given one ends in, lexing just the blocks that
+ * changed (or whose incoming state did) since the state frontier last passed them, and
+ * that the latest lexed snapshot doesn't cover. Nothing is formatted along the way.
  */
-void Highlighter::highlightMultilineComments(const QString &text)
+void Highlighter::advanceFrontier(int blockNumber)
 {
-    setCurrentBlockState(BlockState::NotInComment);
-
-    // qDebug() << "Previous state: " << previousBlockState();
-
-    int startIndex = 0;
-
-    // If the previous state was not in comment, then start searching from very beginning
-    if(previousBlockState() != BlockState::InComment)
+    if(stateFrontier >= blockNumber)
     {
-        startIndex = text.indexOf(blockCommentStart);
+        return;
     }
 
-    //qDebug() << "Start index: " << startIndex;
+    QTextBlock block = document->findBlockByNumber(stateFrontier);
+    int state = stateBefore(block, stateFrontier);
 
-    while (startIndex >= 0)
+    for(; block.isValid() && stateFrontier < blockNumber; block = block.next(), stateFrontier++)
     {
-        QRegularExpressionMatch match = blockCommentEnd.match(text, startIndex);
-        int endIndex = match.capturedStart();
-        int commentLength = 0;
+        state = update(block, stateFrontier, state, false);
+    }
+}
 
-        //qDebug() << "End index: " << endIndex;
 
-        // If we have not yet found the terminating pattern, we are still in comment
-        if (endIndex == -1)
-        {
-           setCurrentBlockState(BlockState::InComment);
-           commentLength = text.length() - startIndex;
-        }
-        else
-        {
-           commentLength = endIndex - startIndex + match.capturedLength();
-        }
+/* Starts the background sweep over from the viewport: downward from its first block and
+ * upward from the block above it.
+ */
+void Highlighter::restartSweep()
+{
+    const int lastBlock = document->blockCount() - 1;
+    firstVisible = qMin(firstVisible, lastBlock);
+    lastVisible = qBound(firstVisible, lastVisible, lastBlock);
 
-        //qDebug() << "Comment length: " << commentLength << "\n";
+    aboveNumber = firstVisible - 1;
+    above = aboveNumber >= 0 ? document->findBlockByNumber(aboveNumber) : QTextBlock();
+    belowNumber = firstVisible;
+    below = document->findBlockByNumber(belowNumber);
 
-        setFormat(startIndex, commentLength, blockCommentFormat);
-        startIndex = text.indexOf(blockCommentStart, startIndex + commentLength);
-   }
+    sweepTimer.start();
 }
 
 
-/* Returns a Highlighter object specific to the C language and its grammar and syntax.
+/* Hands a snapshot of the document to a worker thread to be lexed. It starts at the top
+ * if the sweep upward isn't done yet, and otherwise at the first block the sweep downward
+ * may have to lex. The sweep carries on when the worker is done.
  */
-Highlighter *cHighlighter(QTextDocument *doc)
+void Highlighter::startLexing()
 {
-    QStringList keywords;
-
-    //c语言中的关键字
-    keywords << "\\bauto\\b" << "\\bbreak\\b" << "\\bcase\\b" << "\\bchar\\b" << "\\bconst\\b"
-             << "\\bcontinue\\b" << "\\bdefault\\b" << "\\bdo\\b" << "\\bdouble\\b" << "\\belse\\b"
-             << "\\benum\\b" << "\\bextern\\b" << "\\bfloat\\b" << "\\bfor\\b" << "\\bgoto\\b"
-             << "\\bif\\b" << "\\bint\\b" << "\\blong\\b" << "\\bregister\\b" << "\\breturn\\b"
-             << "\\bshort\\b" << "\\bsigned\\b" << "\\bsizeof\\b" << "\\bstatic\\b" << "\\bstruct\\b"
-             << "\\bswitch\\b" << "\\btypedef\\b" << "\\bunion\\b" << "\\bunsigned\\b" << "\\bvoid\\b"
-             << "\\bvolatile\\b" << "\\bwhile\\b";
-
-    QRegularExpression classPattern("\\b[A-Z_][a-zA-Z0-9_]*\\b");
-    QRegularExpression quotePattern("(\".*\")|('\\\\.')|('.{0,1}')");
-    QRegularExpression functionPattern("\\b[A-Za-z_][A-Za-z0-9_]*(?=\\()");
-    QRegularExpression inlineCommentPattern("//.*");
-    QRegularExpression blockCommentStart("/\\*");
-    QRegularExpression blockCommentEnd("\\*/");
-
-    Highlighter *highlighter = new Highlighter(doc);
-    highlighter->addKeywords(keywords);
-    highlighter->setClassPattern(classPattern);
-    highlighter->setQuotePattern(quotePattern);
-    highlighter->setFunctionPattern(functionPattern);
-    highlighter->setInlineCommentPattern(inlineCommentPattern);
-    highlighter->setBlockCommentStartPattern(blockCommentStart);
-    highlighter->setBlockCommentEndPattern(blockCommentEnd);
-
-    return highlighter;
+    // The state before the first block has to be known, so it can't be past the frontier
+    int firstBlock = above.isValid() ? 0 : qMin(stateFrontier, belowNumber);
+    firstBlock = qMin(firstBlock, document->blockCount() - 1);
+    const QTextBlock first = document->findBlockByNumber(firstBlock);
+
+    LexedBlocks blocks;
+    blocks.firstBlock = firstBlock;
+    blocks.incomingState = stateBefore(first, firstBlock);
+    blocks.edited.fill(false, document->blockCount() - firstBlock);
+
+    // A single copy of the text; it's split back into blocks on the worker thread
+    QTextCursor snapshot(document);
+    snapshot.setPosition(first.position());
+    snapshot.setPosition(document->characterCount() - 1, QTextCursor::KeepAnchor);
+
+    lexing = true;
+    lexed = LexedBlocks();
+    editedSinceLexing = false;
+    editedWhileLexing.clear();
+    lexedValidEnd = INT_MAX;
+    lexCancelled = QSharedPointer<QAtomicInt>::create(0);
+    lexWatcher.setFuture(QtConcurrent::run(&Highlighter::lex, grammar, snapshot.selectedText(), blocks, lexCancelled));
 }
 
 
-/* Returns a Highlighter object specific to the C++ language and its grammar and syntax.
+/* Tells the worker lexing a snapshot, if any, to stop.
  */
-Highlighter *cppHighlighter(QTextDocument *doc)
+void Highlighter::cancelLexing()
 {
-    Highlighter *cLanguage = cHighlighter(doc);
-    QStringList cppOnlyKeywords;
-
-    cppOnlyKeywords <<  "\\basm\\b" << "\\bbool\\b" << "\\bcatch\\b" <<
-                        "\\bclass\\b" << "\\bconst_cast\\b" << "\\bdelete\\b" <<
-                        "\\bdynamic_cast\\b" << "\\bexplicit\\b" << "\\bfalse\\b" <<
-                        "\\bfriend\\b" << "\\binline\\b" << "\\bmutable\\b" <<
-                        "\\bnamespace\\b" << "\\bnew\\b" << "\\boperator\\b" <<
-                        "\\bprivate\\b" << "\\bprotected\\b" << "\\bpublic\\b" <<
-                        "\\breinterpret_cast\\b" << "\\bstatic_cast\\b" <<
-                        "\\btemplate\\b" << "\\bthis\\b" << "\\bthrow\\b" <<
-                        "\\btrue\\b" << "\\btry\\b" << "\\btypeid\\b" << "\\btypename\\b" <<
-                        "\\bvirtual\\b" << "\\busing\\b" << "\\bwchar_t\\b";
-
-    cLanguage->addKeywords(cppOnlyKeywords);
-    return cLanguage;
+    if(lexCancelled)
+    {
+        lexCancelled->store(1);
+    }
 }
 
 
-/* Returns a Highlighter object specific to the Java language and its grammar and syntax.
+/* Lexes a snapshot of the document, one block (paragraph) after another, on a worker
+ * thread. Returns the given blocks with their runs and end states filled in, or no
+ * blocks at all if cancelled.
+ * @param grammar - the grammar to lex with
+ * @param text - the text of the blocks, separated by paragraph separators
+ * @param blocks - the first block's number and incoming state, and a flag for every block
  */
-Highlighter *javaHighlighter(QTextDocument *doc)
+Highlighter::LexedBlocks Highlighter::lex(QSharedPointer<const Grammar> grammar, QString text, LexedBlocks blocks, QSharedPointer<QAtomicInt> cancelled)
 {
-    QStringList keywords;
-
-    keywords << "\\babstract\\b" << "\\bassert\\b" << "\\bboolean\\b" << "\\bbreak\\b" << "\\bbyte\\b"
-             << "\\bcase\\b" << "\\bcatch\\b" << "\\bchar\\b" << "\\bclass\\b" << "\\bconst\\b" << "\\bcontinue\\b"
-             << "\\bdefault\\b" << "\\bdo\\b" << "\\bdouble\\b" << "\\belse\\b" << "\\benum\\b" << "\\bextends\\b"
-             << "\\bfinal\\b" << "\\bfinally\\b" << "\\bfloat\\b" << "\\bfor\\b" << "\\bgoto\\b" << "\\bif\\b"
-             << "\\bimplements\\b" << "\\bimport\\b" << "\\binstanceof\\b" << "\\bint\\b" << "\\binterface\\b"
-             << "\\blong\\b" << "\\bnative\\b" << "\\bnew\\b" << "\\bpackage\\b" << "\\bprivate\\b" << "\\bprotected\\b"
-             << "\\bpublic\\b" << "\\breturn\\b" << "\\bshort\\b" << "\\bstatic\\b" << "\\bstrictfp\\b" << "\\bsuper\\b"
-             << "\\bswitch\\b" << "\\bsynchronized\\b" << "\\bthis\\b" << "\\bthrow\\b" << "\\bthrows\\b" << "\\btransient\\b"
-             << "\\btry\\b" << "\\bvoid\\b" << "\\bvolatile\\b" << "\\bwhile\\b" << "\\btrue\\b" << "\\bfalse\\b" << "\\bnull\\b";
-
-    QRegularExpression classPattern("\\b[A-Z_][a-zA-Z0-9_]*\\b");
-    QRegularExpression quotePattern("(\".*\")|('\\\\.')|('.{0,1}')");
-    QRegularExpression functionPattern("\\b[A-Za-z_][A-Za-z0-9_]*(?=\\()");
-    QRegularExpression inlineCommentPattern("//.*");
-    QRegularExpression blockCommentStart("/\\*");
-    QRegularExpression blockCommentEnd("\\*/");
-
-    Highlighter *highlighter = new Highlighter(doc);
-    highlighter->addKeywords(keywords);
-    highlighter->setClassPattern(classPattern);
-    highlighter->setQuotePattern(quotePattern);
-    highlighter->setFunctionPattern(functionPattern);
-    highlighter->setInlineCommentPattern(inlineCommentPattern);
-    highlighter->setBlockCommentStartPattern(blockCommentStart);
-    highlighter->setBlockCommentEndPattern(blockCommentEnd);
-
-    return highlighter;
+    QVector<Lexer::Token> tokens;
+    int state = blocks.incomingState;
+    int start = 0;
+
+    blocks.endStates.reserve(blocks.edited.size());
+    blocks.runEnds.reserve(blocks.edited.size());
+
+    for(int i = 0; i < blocks.edited.size(); i++)
+    {
+        if(cancelled->load() != 0)
+        {
+            return LexedBlocks();
+        }
+
+        int end = text.indexOf(QChar::ParagraphSeparator, start);
+        if(end < 0)
+        {
+            end = text.length();
+        }
+
+        state = grammar->getLexer().tokenize(text.constData() + start, end - start, state, &tokens);
+
+        for(const Lexer::Token &token : tokens)
+        {
+            blocks.runs.append({token.start, (quint32(token.length) << 3) | quint32(token.type)});
+        }
+
+        blocks.runEnds.append(blocks.runs.size());
+        blocks.endStates.append(quint8(state));
+        start = end + 1;
+    }
+
+    return blocks;
 }
 
 
-/* Returns a Highlighter object specific to the Python language and its grammar and syntax.
+/* Called on the UI thread when a worker is done lexing a snapshot. Keeps the result,
+ * marking the blocks that were edited in the meantime so that lexedIndexOf leaves them
+ * out, and lets the sweep carry on.
  */
-Highlighter *pythonHighlighter(QTextDocument *doc)
+void Highlighter::on_lexingFinished()
 {
-    QStringList keywords;
-
-    keywords << "\\band\\b" << "\\bas\\b" << "\\bassert\\b" << "\\bbreak\\b" << "\\bclass\\b" << "\\bcontinue\\b"
-             << "\\bdef\\b" << "\\bdel\\b" << "\\belif\\b" << "\\belse\\b" << "\\bexcept\\b" << "\\bFalse\\b"
-             << "\\bfinally\\b" << "\\bfor\\b" << "\\bfrom\\b" << "\\bglobal\\b" << "\\bif\\b" << "\\bimport\\b"
-             << "\\bin\\b" << "\\bis\\b" << "\\blambda\\b" << "\\bNone\\b" << "\\bnonlocal\\b" << "\\bnot\\b"
-             << "\\bor\\b" << "\\bpass\\b" << "\\braise\\b" << "\\breturn\\b" << "\\bTrue\\b" << "\\btry\\b"
-             << "\\bwhile\\b" << "\\bwith\\b" << "\\byield\\b";
-
-    QRegularExpression classPattern("\\b[A-Z_][a-zA-Z0-9_]*\\b");
-    QRegularExpression quotePattern("(\".*\")|('.*')");
-    QRegularExpression functionPattern("\\b[A-Za-z_][A-Za-z0-9_]*(?=\\()");
-    QRegularExpression inlineCommentPattern("#.*");
-    // TODO change for Python
-    QRegularExpression blockCommentStart("'''");
-    QRegularExpression blockCommentEnd("'''");
-
-    Highlighter *highlighter = new Highlighter(doc);
-    highlighter->addKeywords(keywords);
-    highlighter->setClassPattern(classPattern);
-    highlighter->setQuotePattern(quotePattern);
-    highlighter->setFunctionPattern(functionPattern);
-    highlighter->setInlineCommentPattern(inlineCommentPattern);
-    highlighter->setBlockCommentStartPattern(blockCommentStart);
-    highlighter->setBlockCommentEndPattern(blockCommentEnd);
-
-    return highlighter;
-}
+    lexing = false;
 
+    if(lexCancelled->load() != 0)
+    {
+        return;
+    }
 
+    lexed = lexWatcher.result();
+
+    for(const QPair<int, int> &range : editedWhileLexing)
+    {
+        markEdited(range.first, range.second);
+    }
+    editedWhileLexing.clear();
+
+    sweepTimer.start();
+}
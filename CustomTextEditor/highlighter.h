@@ -1,72 +1,123 @@
 #ifndef HIGHLIGHTER_H
 #define HIGHLIGHTER_H
-#include <QSyntaxHighlighter>
-#include <QRegularExpression>
-
-class Highlighter : public QSyntaxHighlighter
+#include "grammar.h"
+#include "lexcache.h"
+#include <QObject>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QTextCharFormat>
+#include <QTimer>
+#include <QVector>
+#include <QPair>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QAtomicInt>
+
+
+/* Colors a document's source code, visible blocks first. Whoever shows the document
+ * reports which blocks are on screen (setVisibleBlocks); those are highlighted right
+ * away, and the rest a few milliseconds at a time whenever the event loop is idle,
+ * nearest to the viewport first. Unlike QSyntaxHighlighter, attaching a highlighter to
+ * a large document (or pasting a lot of text into one) never highlights it all at once.
+ *
+ * Only the blocks on screen are lexed on the UI thread, through the shared LexCache, so
+ * a block whose text and incoming state were lexed before (say, one an undo put back)
+ * isn't lexed again. When the background sweep comes across a block that needs lexing,
+ * a worker thread lexes a snapshot of the document into compact token runs and end
+ * states for each block, and the sweep applies those, pausing until they're ready. A
+ * block edited since the snapshot was taken (or that the snapshot lexed with a different
+ * incoming state) isn't colored from it; a newer snapshot is lexed instead. Edits are
+ * tracked from contentsChange rather than from block revisions, which QTextDocument
+ * stops updating once its undo stack is off (as UndoHistory turns it off).
+ *
+ * Each block's user state records the state it ends in, the state it was lexed with and
+ * whether its formats are current. Every block before the "state frontier" is known to
+ * end in the right state, so a block can be highlighted as soon as the frontier reaches
+ * it. Moving the frontier over blocks whose text and incoming state haven't changed
+ * costs no lexing; an edit moves it back to the first block it touched, and whichever
+ * later blocks end up lexed with a different state are highlighted again.
+ */
+class Highlighter : public QObject
 {
     Q_OBJECT
 
 public:
 
-    Highlighter(QTextDocument *parent = nullptr) : QSyntaxHighlighter (parent) {}
-    virtual void addKeywords(QStringList keywords);
-    virtual void setClassPattern(QRegularExpression classPattern);
-    virtual void setFunctionPattern(QRegularExpression functionPattern);
-    virtual void setQuotePattern(QRegularExpression quotePattern);
-    virtual void setInlineCommentPattern(QRegularExpression inlineCommentPattern);
-    virtual void setBlockCommentStartPattern(QRegularExpression blockCommentStart);
-    virtual void setBlockCommentEndPattern(QRegularExpression blockCommentEnd);
-    virtual void addRule(QRegularExpression pattern, QTextCharFormat format);
-
-protected:
+    Highlighter(QSharedPointer<const Grammar> grammar, QTextDocument *parent);
+    ~Highlighter() override;
 
-    virtual void highlightBlock(const QString &text) override;
-    virtual void highlightMultilineComments(const QString &text);
+    void setVisibleBlocks(int first, int last);
+    inline const Grammar &getGrammar() const { return *grammar; }
 
-    virtual void setKeywordFormat();
-    virtual void setClassFormat();
-    virtual void setFunctionFormat();
-    virtual void setQuoteFormat();
-    virtual void setInlineCommentFormat();
-    virtual void setBlockCommentFormat();
+private slots:
+    void on_contentsChange(int position, int charsRemoved, int charsAdded);
+    void on_lexingFinished();
+    void highlightInBackground();
 
 private:
 
-    struct HighlightingRule
+    typedef LexCache::Run Run;
+
+    // The blocks from some block to the end of a snapshot of the document, lexed, and
+    // which of them were edited since
+    struct LexedBlocks
     {
-        QRegularExpression pattern;
-        QTextCharFormat format;
+        int firstBlock = 0;
+        int incomingState = Lexer::Normal;
+        QVector<bool> edited;
+        QVector<quint8> endStates;
+        QVector<int> runEnds;
+        QVector<Run> runs;
     };
 
-    QVector<HighlightingRule> rules;
-
-    QRegularExpression blockCommentStart;
-    QRegularExpression blockCommentEnd;
-
-    QTextCharFormat keywordFormat;
-    QTextCharFormat classFormat;
-    QTextCharFormat inlineCommentFormat;
-    QTextCharFormat blockCommentFormat;
-    QTextCharFormat quoteFormat;
-    QTextCharFormat functionFormat;
+    static LexedBlocks lex(QSharedPointer<const Grammar> grammar, QString text, LexedBlocks blocks, QSharedPointer<QAtomicInt> cancelled);
+
+    void highlight(QTextBlock block, int blockNumber);
+    bool needsLexing(QTextBlock block, int blockNumber);
+    int update(QTextBlock block, int blockNumber, int incomingState, bool format);
+    int lexedIndexOf(const QTextBlock &block, int blockNumber, int incomingState) const;
+    int stateBefore(const QTextBlock &block, int blockNumber) const;
+    void appendRange(const Run &run);
+    void applyFormats(QTextBlock block);
+    void advanceFrontier(int blockNumber);
+    void markEdited(int firstBlock, int lastBlock);
+    void restartSweep();
+    void startLexing();
+    void cancelLexing();
+
+    QTextDocument *document;
+    QSharedPointer<const Grammar> grammar;
+    QVector<Lexer::Token> tokens;
+    QVector<Run> runs;
+    QVector<QTextLayout::FormatRange> ranges;
+
+    // The latest snapshot lexed on a worker thread; edits that add or remove blocks make
+    // the blocks from lexedValidEnd on line up with the wrong ones. Blocks edited while a
+    // snapshot is being lexed are marked once its result comes in.
+    QFutureWatcher<LexedBlocks> lexWatcher;
+    QSharedPointer<QAtomicInt> lexCancelled;
+    LexedBlocks lexed;
+    bool lexing = false;
+    bool editedSinceLexing = false;
+    QVector<QPair<int, int>> editedWhileLexing;
+    int lexedValidEnd = 0;
+    int knownBlockCount = 0;
+
+    // Blocks before this one end in the right state
+    int stateFrontier = 0;
+
+    // The blocks on screen, and the next ones to highlight above and below them
+    int firstVisible = 0;
+    int lastVisible = 0;
+    QTextBlock above;
+    QTextBlock below;
+    int aboveNumber = -1;
+    int belowNumber = 0;
+    QTimer sweepTimer;
+
+    // About half a frame, so the UI keeps up while formats are applied
+    static const int sliceMilliseconds = 8;
 };
 
-
-/* Used for multi-line comment formatting */
-enum BlockState
-{
-    NotInComment,
-    InComment
-};
-
-
-/* Used to build specific types of highlighters */
-
-Highlighter *cHighlighter(QTextDocument *doc);
-Highlighter *cppHighlighter(QTextDocument *doc);
-Highlighter *javaHighlighter(QTextDocument *doc);
-Highlighter *pythonHighlighter(QTextDocument *doc);
-
-
 #endif // HIGHLIGHTER_H
@@ -0,0 +1,194 @@
+#include "keywordtable.h"
+#include <QSet>
+#include <algorithm>
+#include <cstring>
+
+
+const quint32 KeywordTable::maxSeedsPerBucket;
+
+
+/* Creates an empty table.
+ */
+KeywordTable::KeywordTable()
+{
+}
+
+
+/* Builds the table for the given keywords. Duplicates and empty strings are ignored.
+ */
+KeywordTable::KeywordTable(const QStringList &keywords)
+{
+    QSet<QString> seen;
+    for(const QString &keyword : keywords)
+    {
+        if(!keyword.isEmpty() && !seen.contains(keyword))
+        {
+            seen.insert(keyword);
+            words.append(keyword);
+        }
+    }
+
+    if(words.isEmpty())
+    {
+        return;
+    }
+
+    // At most half the slots are used, with two keywords per bucket on average
+    int slotCount = 1;
+    while(slotCount < 2 * words.size())
+    {
+        slotCount <<= 1;
+    }
+
+    while(!place(slotCount, qMax(1, words.size() / 2)))
+    {
+        slotCount <<= 1;
+    }
+}
+
+
+/* Returns true if the given word is one of the keywords.
+ */
+bool KeywordTable::contains(const QChar *word, int length) const
+{
+    if(words.isEmpty())
+    {
+        return false;
+    }
+
+    quint32 bucket = hash(word, length, 0) % quint32(seeds.size());
+    int index = slots.at(int(hash(word, length, seeds.at(int(bucket))) & mask));
+
+    if(index < 0)
+    {
+        return false;
+    }
+
+    const QString &keyword = words.at(index);
+    return keyword.length() == length && std::memcmp(keyword.constData(), word, size_t(length) * sizeof(QChar)) == 0;
+}
+
+
+/* Looks for a seed for every bucket under which the bucket's keywords all land in slots
+ * of their own. Buckets are placed largest first, while there are still many free slots.
+ * Returns false if some bucket has no such seed among the first maxSeedsPerBucket.
+ */
+bool KeywordTable::place(int slotCount, int bucketCount)
+{
+    QVector<QVector<int>> buckets(bucketCount);
+    for(int i = 0; i < words.size(); i++)
+    {
+        const QString &word = words.at(i);
+        buckets[int(hash(word.constData(), word.length(), 0) % quint32(bucketCount))].append(i);
+    }
+
+    QVector<int> order(bucketCount);
+    for(int i = 0; i < bucketCount; i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](int a, int b) { return buckets.at(a).size() > buckets.at(b).size(); });
+
+    mask = quint32(slotCount - 1);
+    slots.fill(-1, slotCount);
+    seeds.fill(0, bucketCount);
+
+    QVector<int> taken;
+    for(int bucket : order)
+    {
+        const QVector<int> &members = buckets.at(bucket);
+        quint32 seed = 1;
+
+        for(; seed <= maxSeedsPerBucket; seed++)
+        {
+            taken.clear();
+
+            for(int index : members)
+            {
+                const QString &word = words.at(index);
+                int slot = int(hash(word.constData(), word.length(), seed) & mask);
+
+                if(slots.at(slot) >= 0 || taken.contains(slot))
+                {
+                    break;
+                }
+                taken.append(slot);
+            }
+
+            if(taken.size() == members.size())
+            {
+                break;
+            }
+        }
+
+        if(seed > maxSeedsPerBucket)
+        {
+            return false;
+        }
+
+        for(int i = 0; i < members.size(); i++)
+        {
+            slots[taken.at(i)] = members.at(i);
+        }
+        seeds[bucket] = seed;
+    }
+
+    return true;
+}
+
+
+/* Writes out a built table, seeds and all, so that it can be read back without searching
+ * for the seeds again.
+ */
+QDataStream &operator<<(QDataStream &stream, const KeywordTable &table)
+{
+    return stream << table.words << table.seeds << table.slots << table.mask;
+}
+
+
+/* Reads back a table written by operator<<. A table that doesn't hold together (as from
+ * a damaged file) sets the stream's status to ReadCorruptData and leaves an empty table.
+ */
+QDataStream &operator>>(QDataStream &stream, KeywordTable &table)
+{
+    KeywordTable read;
+    stream >> read.words >> read.seeds >> read.slots >> read.mask;
+
+    bool valid = stream.status() == QDataStream::Ok;
+
+    if(valid && !read.words.isEmpty())
+    {
+        valid = !read.seeds.isEmpty() && !read.slots.isEmpty() && read.slots.size() == int(read.mask) + 1 && (read.mask & (read.mask + 1)) == 0;
+
+        for(int i = 0; valid && i < read.slots.size(); i++)
+        {
+            valid = read.slots.at(i) >= -1 && read.slots.at(i) < read.words.size();
+        }
+    }
+
+    if(!valid)
+    {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        table = KeywordTable();
+        return stream;
+    }
+
+    table = read;
+    return stream;
+}
+
+
+/* FNV-1a over the word's UTF-16 code units, starting from a seed-dependent state.
+ */
+quint32 KeywordTable::hash(const QChar *characters, int length, quint32 seed)
+{
+    quint32 h = 2166136261u ^ (seed * 0x9E3779B9u);
+
+    for(int i = 0; i < length; i++)
+    {
+        h ^= characters[i].unicode();
+        h *= 16777619u;
+    }
+
+    return h ^ (h >> 16);
+}
@@ -0,0 +1,40 @@
+#ifndef KEYWORDTABLE_H
+#define KEYWORDTABLE_H
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QDataStream>
+
+
+/* A perfect hash table of a language's keywords: every keyword has a slot of its own,
+ * so looking up a word costs two hashes and at most one comparison, with no probing.
+ * Keywords are hashed into buckets, and each bucket gets a seed under which its
+ * keywords land in free slots (the "hash and displace" scheme). The seeds are searched
+ * for once, when the table is built.
+ */
+class KeywordTable
+{
+public:
+    KeywordTable();
+    KeywordTable(const QStringList &keywords);
+
+    bool contains(const QChar *word, int length) const;
+    inline bool contains(const QString &word) const { return contains(word.constData(), word.length()); }
+    inline int size() const { return words.size(); }
+
+    friend QDataStream &operator<<(QDataStream &stream, const KeywordTable &table);
+    friend QDataStream &operator>>(QDataStream &stream, KeywordTable &table);
+
+private:
+    bool place(int slotCount, int bucketCount);
+    static quint32 hash(const QChar *characters, int length, quint32 seed);
+
+    QVector<QString> words;
+    QVector<quint32> seeds;
+    QVector<int> slots;
+    quint32 mask = 0;
+
+    static const quint32 maxSeedsPerBucket = 1 << 16;
+};
+
+#endif // KEYWORDTABLE_H
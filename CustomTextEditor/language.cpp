@@ -1,19 +1,12 @@
 #include "language.h"
 
 
-QString ProgrammingLanguage::toString(Language language)
+QString ProgrammingLanguage::toString(const Language &language)
 {
-    switch (language)
+    if(language.isEmpty())
     {
-        case(Language::C):
-            return "Language: C";
-        case(Language::CPP):
-            return "Language: C++";
-        case(Language::Java):
-            return "Language: Java";
-        case(Language::Python):
-            return "Language: Python";
-        default:
-            return "Language not selected";
+        return "Language not selected";
     }
+
+    return "Language: " + language;
 }
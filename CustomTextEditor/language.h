@@ -4,17 +4,11 @@
 
 namespace ProgrammingLanguage
 {
-    // Four common programming languages
-    enum Language
-    {
-        None,
-        CPP,
-        C,
-        Python,
-        Java
-    };
+    // A language is known by the name its definition gives it (see Grammar); a document
+    // that isn't in any particular language has an empty one
+    typedef QString Language;
 
-    QString toString(Language language);
+    QString toString(const Language &language);
 }
 
 #endif // LANGUAGE_H
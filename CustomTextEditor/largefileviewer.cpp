@@ -0,0 +1,715 @@
+#include "largefileviewer.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <QByteArrayMatcher>
+#include <QMutexLocker>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+const qint64 LargeFileViewer::windowSize;
+
+
+namespace
+{
+    inline char asciiLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    // Bytes of multi-byte UTF-8 sequences count as word characters, since they're almost always letters
+    inline bool isWordByte(char c)
+    {
+        uchar byte = static_cast<uchar>(c);
+        return byte >= 0x80 || byte == '_' || (byte >= '0' && byte <= '9') || (asciiLower(c) >= 'a' && asciiLower(c) <= 'z');
+    }
+}
+
+
+/* Creates an empty viewer. Call open to show a file in it.
+ */
+LargeFileViewer::LargeFileViewer(QWidget *parent) : QAbstractScrollArea(parent), indexerCancelled(0)
+{
+    connect(&searchWatcher, SIGNAL(finished()), this, SLOT(on_searchFinished()));
+}
+
+
+/* Stops the background indexing and searching before the viewer goes away.
+ */
+LargeFileViewer::~LargeFileViewer()
+{
+    indexerCancelled.store(1);
+    indexer.waitForFinished();
+    cancelSearch();
+}
+
+
+/* Opens the file at the given path and starts indexing its lines in the background.
+ * Returns false and describes the problem in errorString if the file can't be read.
+ */
+bool LargeFileViewer::open(const QString &filePath, QString *errorString)
+{
+    this->filePath = filePath;
+    file.setFileName(filePath);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        *errorString = file.errorString();
+        return false;
+    }
+
+    fileSize = file.size();
+    lineCheckpoints.append(0);
+    indexer = QtConcurrent::run(this, &LargeFileViewer::buildLineIndex);
+    updateScrollBars();
+    return true;
+}
+
+
+/* Returns the name of the file shown in this viewer, without its directory.
+ */
+QString LargeFileViewer::getFileName() const
+{
+    return filePath.mid(filePath.lastIndexOf('/') + 1);
+}
+
+
+/* Returns the number of lines indexed so far. This is the file's line count once
+ * indexing has finished.
+ */
+int LargeFileViewer::getLineCount()
+{
+    QMutexLocker locker(&indexMutex);
+    return indexedLines;
+}
+
+
+/* Returns how much of the file has been indexed so far, as a percentage.
+ */
+int LargeFileViewer::getIndexProgress()
+{
+    QMutexLocker locker(&indexMutex);
+    return fileSize > 0 ? static_cast<int>(indexedBytes * 100 / fileSize) : 100;
+}
+
+
+/* Runs on a worker thread. Scans the file one mapped window at a time and records the
+ * offset of every Nth line, publishing what it has found after each window.
+ */
+void LargeFileViewer::buildLineIndex()
+{
+    QFile indexedFile(filePath);
+    if(!indexedFile.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    QVector<qint64> found;
+    int lines = 1;
+    int stride = checkpointStride;
+    qint64 offset = 0;
+
+    while(offset < fileSize && indexerCancelled.load() == 0 && lines < std::numeric_limits<int>::max())
+    {
+        qint64 length = qMin(windowSize, fileSize - offset);
+        uchar *window = indexedFile.map(offset, length);
+        QByteArray fallback;
+        const char *bytes;
+
+        if(window != nullptr)
+        {
+            bytes = reinterpret_cast<const char*>(window);
+        }
+        else
+        {
+            indexedFile.seek(offset);
+            fallback = indexedFile.read(length);
+            if(fallback.isEmpty())
+            {
+                break;
+            }
+            length = fallback.size();
+            bytes = fallback.constData();
+        }
+
+        const char *position = bytes;
+        const char *end = bytes + length;
+        while(lines < std::numeric_limits<int>::max())
+        {
+            const char *newline = static_cast<const char*>(memchr(position, '\n', static_cast<size_t>(end - position)));
+            if(newline == nullptr)
+            {
+                break;
+            }
+
+            position = newline + 1;
+
+            // The line that starts right after this newline
+            if(lines % stride == 0)
+            {
+                found.append(offset + (position - bytes));
+            }
+            lines++;
+        }
+
+        if(window != nullptr)
+        {
+            indexedFile.unmap(window);
+        }
+        offset += length;
+
+        QMutexLocker locker(&indexMutex);
+        lineCheckpoints += found;
+        indexedLines = lines;
+        indexedBytes = offset;
+
+        // Keep the index's size bounded by dropping every other checkpoint
+        while(lineCheckpoints.size() > maxCheckpoints)
+        {
+            QVector<qint64> halved;
+            halved.reserve(lineCheckpoints.size() / 2 + 1);
+            for(int i = 0; i < lineCheckpoints.size(); i += 2)
+            {
+                halved.append(lineCheckpoints.at(i));
+            }
+            lineCheckpoints.swap(halved);
+            checkpointStride *= 2;
+        }
+        stride = checkpointStride;
+        locker.unlock();
+
+        found.clear();
+        QMetaObject::invokeMethod(this, "on_indexProgress", Qt::QueuedConnection, Q_ARG(qint64, offset));
+    }
+}
+
+
+/* Called on the UI thread each time the worker thread has indexed another window of the file.
+ */
+void LargeFileViewer::on_indexProgress(qint64 bytesIndexed)
+{
+    emit(indexProgressChanged(fileSize > 0 ? static_cast<int>(bytesIndexed * 100 / fileSize) : 100));
+    updateScrollBars();
+    viewport()->update();
+}
+
+
+/* Returns a pointer to the file's contents at the given offset, mapping the window that
+ * holds it if necessary, and stores in available how many bytes can be read from there.
+ * Only the few most recently used windows stay mapped. Returns nullptr if mapping failed.
+ */
+const char *LargeFileViewer::bytesAt(qint64 offset, qint64 *available)
+{
+    for(int i = 0; i < mappedWindows.size(); i++)
+    {
+        MappedWindow window = mappedWindows.at(i);
+        if(offset >= window.start && offset < window.start + window.length)
+        {
+            mappedWindows.move(i, 0);
+            *available = window.start + window.length - offset;
+            return reinterpret_cast<const char*>(window.bytes) + (offset - window.start);
+        }
+    }
+
+    MappedWindow window;
+    window.start = offset - offset % windowSize;
+    window.length = qMin(windowSize, fileSize - window.start);
+    window.bytes = file.map(window.start, window.length);
+
+    if(window.bytes == nullptr)
+    {
+        return nullptr;
+    }
+
+    if(mappedWindows.size() == maxMappedWindows)
+    {
+        file.unmap(mappedWindows.last().bytes);
+        mappedWindows.removeLast();
+    }
+    mappedWindows.prepend(window);
+
+    *available = window.start + window.length - offset;
+    return reinterpret_cast<const char*>(window.bytes) + (offset - window.start);
+}
+
+
+/* Returns the line starting at the given offset, without its line break, and stores the
+ * offset of the following line in nextLineOffset. Very long lines are cut short.
+ */
+QByteArray LargeFileViewer::readLine(qint64 offset, qint64 *nextLineOffset)
+{
+    QByteArray line;
+    qint64 position = offset;
+    *nextLineOffset = fileSize;
+
+    while(position < fileSize)
+    {
+        qint64 available;
+        const char *bytes = bytesAt(position, &available);
+        if(bytes == nullptr)
+        {
+            break;
+        }
+
+        const char *newline = static_cast<const char*>(memchr(bytes, '\n', static_cast<size_t>(available)));
+        qint64 length = newline != nullptr ? newline - bytes : available;
+
+        if(line.size() < maxDisplayedLineBytes)
+        {
+            line.append(bytes, static_cast<int>(qMin<qint64>(length, maxDisplayedLineBytes - line.size())));
+        }
+
+        position += length;
+        if(newline != nullptr)
+        {
+            *nextLineOffset = position + 1;
+            break;
+        }
+    }
+
+    if(line.endsWith('\r'))
+    {
+        line.chop(1);
+    }
+    return line;
+}
+
+
+/* Returns the offset of the line that comes count lines after the one at the given offset.
+ */
+qint64 LargeFileViewer::skipLines(qint64 offset, int count)
+{
+    int skipped = 0;
+
+    while(skipped < count && offset < fileSize)
+    {
+        qint64 available;
+        const char *bytes = bytesAt(offset, &available);
+        if(bytes == nullptr)
+        {
+            return fileSize;
+        }
+
+        const char *position = bytes;
+        const char *end = bytes + available;
+        while(skipped < count)
+        {
+            const char *newline = static_cast<const char*>(memchr(position, '\n', static_cast<size_t>(end - position)));
+            if(newline == nullptr)
+            {
+                position = end;
+                break;
+            }
+            position = newline + 1;
+            skipped++;
+        }
+
+        offset += position - bytes;
+    }
+
+    return offset;
+}
+
+
+/* Returns the offset at which the given (zero-based) line starts, scanning forward from
+ * the nearest checkpoint before it.
+ */
+qint64 LargeFileViewer::offsetOfLine(int line)
+{
+    QMutexLocker locker(&indexMutex);
+    int checkpoint = qMin(line / checkpointStride, lineCheckpoints.size() - 1);
+    qint64 offset = lineCheckpoints.at(checkpoint);
+    int remaining = line - checkpoint * checkpointStride;
+    locker.unlock();
+
+    return skipLines(offset, remaining);
+}
+
+
+/* Returns the (zero-based) line that the given offset falls on.
+ */
+int LargeFileViewer::lineOfOffset(qint64 offset)
+{
+    QMutexLocker locker(&indexMutex);
+    int checkpoint = static_cast<int>(std::upper_bound(lineCheckpoints.constBegin(), lineCheckpoints.constEnd(), offset) - lineCheckpoints.constBegin()) - 1;
+    int line = checkpoint * checkpointStride;
+    qint64 position = lineCheckpoints.at(checkpoint);
+    locker.unlock();
+
+    while(position < offset)
+    {
+        qint64 available;
+        const char *bytes = bytesAt(position, &available);
+        if(bytes == nullptr)
+        {
+            break;
+        }
+
+        const char *scan = bytes;
+        const char *end = bytes + qMin(available, offset - position);
+        const char *newline;
+        while((newline = static_cast<const char*>(memchr(scan, '\n', static_cast<size_t>(end - scan)))) != nullptr)
+        {
+            scan = newline + 1;
+            line++;
+        }
+
+        position += end - bytes;
+    }
+
+    return line;
+}
+
+
+/* Converts a line's bytes into the text that gets painted for it.
+ */
+QString LargeFileViewer::toDisplayText(const QByteArray &bytes)
+{
+    return QString::fromUtf8(bytes).replace('\t', QLatin1String("    "));
+}
+
+
+/* Returns the width of the line number gutter on the left of the viewport.
+ */
+int LargeFileViewer::getGutterWidth()
+{
+    int numDigitsInLastLine = QString::number(qMax(getLineCount(), furthestKnownLine)).length();
+    return numDigitsInLastLine * fontMetrics().width(QLatin1Char('9')) + gutterPadding;
+}
+
+
+/* Sizes the scroll bars to the lines known so far and the widest line painted so far.
+ * The vertical scroll bar scrolls by lines, the horizontal one by pixels.
+ */
+void LargeFileViewer::updateScrollBars()
+{
+    QFontMetrics metrics = fontMetrics();
+    int visibleLines = qMax(1, viewport()->height() / metrics.height());
+    int lineCount = qMax(getLineCount(), furthestKnownLine);
+
+    verticalScrollBar()->setRange(0, qMax(0, lineCount - visibleLines));
+    verticalScrollBar()->setPageStep(visibleLines);
+    horizontalScrollBar()->setRange(0, qMax(0, getGutterWidth() + longestLineWidth - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(metrics.width(QLatin1Char(' ')) * 4);
+}
+
+
+/* Paints the visible lines, reading them straight from the mapped file.
+ */
+void LargeFileViewer::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    QFontMetrics metrics = fontMetrics();
+    int lineHeight = metrics.height();
+    int gutterWidth = getGutterWidth();
+    int textLeft = gutterWidth - horizontalScrollBar()->value();
+    QRect textArea(gutterWidth, 0, viewport()->width() - gutterWidth, viewport()->height());
+    int lineCount = getLineCount();
+    bool indexing = isIndexing();
+    int widestLine = longestLineWidth;
+
+    int line = verticalScrollBar()->value();
+    qint64 offset = offsetOfLine(line);
+
+    for(int top = 0; top <= event->rect().bottom(); top += lineHeight, line++)
+    {
+        // Until indexing is done, the file may have more lines than the index knows about
+        if(line >= lineCount && !(indexing && offset < fileSize))
+        {
+            break;
+        }
+
+        qint64 nextLineOffset;
+        QByteArray bytes = readLine(offset, &nextLineOffset);
+        QString text = toDisplayText(bytes);
+        widestLine = qMax(widestLine, metrics.width(text));
+
+        painter.setClipRect(textArea);
+
+        // Highlight the last search match if it's on this line
+        if(matchOffset >= offset && matchOffset - offset < bytes.size())
+        {
+            int matchStart = static_cast<int>(matchOffset - offset);
+            int x = metrics.width(toDisplayText(bytes.left(matchStart)));
+            int width = metrics.width(toDisplayText(bytes.mid(matchStart, matchLength)));
+            painter.fillRect(textLeft + x, top, width, lineHeight, QColor(Qt::yellow));
+        }
+
+        painter.setPen(Qt::black);
+        painter.drawText(textLeft, top + metrics.ascent(), text);
+
+        painter.setClipping(false);
+        painter.drawText(0, top, gutterWidth - gutterPadding / 2, lineHeight, Qt::AlignRight, QString::number(line + 1));
+
+        offset = nextLineOffset;
+    }
+
+    if(widestLine > longestLineWidth)
+    {
+        longestLineWidth = widestLine;
+        updateScrollBars();
+    }
+}
+
+
+/* Keeps the scroll bars in step with the viewport's size.
+ */
+void LargeFileViewer::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+
+/* Called when either scroll bar moves. Everything on screen depends on the scroll
+ * position, so the whole viewport is repainted.
+ */
+void LargeFileViewer::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    viewport()->update();
+}
+
+
+/* Called when the user clicks the Go button in the GotoDialog. Scrolls the given line to the top.
+ */
+void LargeFileViewer::goTo(int line)
+{
+    if(line < 1 || line > qMax(getLineCount(), furthestKnownLine))
+    {
+        emit(gotoResultReady(isIndexing() ? "That line hasn't been indexed yet." : "Invalid line number."));
+        return;
+    }
+
+    // The next search starts from here rather than from the last match
+    matchOffset = -1;
+    verticalScrollBar()->setValue(line - 1);
+    viewport()->update();
+}
+
+
+/* Called when the findDialog object emits its startFinding signal. Searches the file on a
+ * worker thread, starting just after the last match for the same query (or at the top of
+ * the screen) and wrapping around to the beginning. Case-insensitive matching only folds
+ * ASCII letters, and regular expressions aren't supported.
+ * @param query - the text the user wants to search for
+ * @param caseSensitive - flag denoting whether the search should heed the case of results
+ * @param wholeWords - flag denoting whether the search should look for whole word matches or partials
+ * @param regex - flag denoting whether the query is a regular expression
+ */
+void LargeFileViewer::find(QString query, bool caseSensitive, bool wholeWords, bool regex)
+{
+    if(query.isEmpty())
+    {
+        return;
+    }
+
+    if(regex)
+    {
+        emit(findResultReady("Regular expressions can't be used to search files opened in the viewer."));
+        return;
+    }
+
+    SearchQuery searchQuery;
+    searchQuery.needle = query.toUtf8();
+    searchQuery.caseSensitive = caseSensitive;
+    searchQuery.wholeWords = wholeWords;
+
+    if(!caseSensitive)
+    {
+        for(int i = 0; i < searchQuery.needle.size(); i++)
+        {
+            searchQuery.needle[i] = asciiLower(searchQuery.needle.at(i));
+        }
+    }
+
+    bool continuing = matchOffset >= 0 && searchQuery.needle == lastQuery.needle &&
+                      caseSensitive == lastQuery.caseSensitive && wholeWords == lastQuery.wholeWords;
+    qint64 from = continuing ? matchOffset + 1 : offsetOfLine(verticalScrollBar()->value());
+    lastQuery = searchQuery;
+
+    cancelSearch();
+    searchCancelled.reset(new QAtomicInt(0));
+    searchWatcher.setFuture(QtConcurrent::run(&LargeFileViewer::search, filePath, fileSize, searchQuery, from, searchCancelled));
+}
+
+
+/* Stops the search in progress, if there is one. Its result will be ignored.
+ */
+void LargeFileViewer::cancelSearch()
+{
+    if(searchCancelled)
+    {
+        searchCancelled->store(1);
+    }
+}
+
+
+/* Runs on a worker thread. Returns the offset of the first match at or after from,
+ * wrapping around to the start of the file, or -1 if there is none.
+ */
+qint64 LargeFileViewer::search(QString filePath, qint64 fileSize, SearchQuery query, qint64 from, QSharedPointer<QAtomicInt> cancelled)
+{
+    QFile searchedFile(filePath);
+    if(!searchedFile.open(QIODevice::ReadOnly))
+    {
+        return -1;
+    }
+
+    qint64 match = searchRange(searchedFile, query, from, fileSize, *cancelled);
+
+    if(match < 0 && from > 0)
+    {
+        match = searchRange(searchedFile, query, 0, qMin(fileSize, from + query.needle.size() - 1), *cancelled);
+    }
+
+    return match;
+}
+
+
+/* Returns the offset of the first match lying entirely within [from, to), or -1. The
+ * file is mapped one window at a time; each window overlaps the next by enough bytes
+ * to see matches straddling the boundary and the characters on either side of a match.
+ */
+qint64 LargeFileViewer::searchRange(QFile &file, const SearchQuery &query, qint64 from, qint64 to, const QAtomicInt &cancelled)
+{
+    const QByteArray &needle = query.needle;
+    const int needleLength = needle.size();
+    const qint64 fileSize = file.size();
+    QByteArrayMatcher matcher(needle);
+    qint64 position = from;
+
+    while(position + needleLength <= to && cancelled.load() == 0)
+    {
+        qint64 candidatesEnd = qMin(position + windowSize, to - needleLength + 1);
+        qint64 mapStart = qMax<qint64>(0, position - 1);
+        qint64 mapEnd = qMin(fileSize, candidatesEnd + needleLength);
+
+        uchar *window = file.map(mapStart, mapEnd - mapStart);
+        QByteArray fallback;
+        const char *bytes;
+
+        if(window != nullptr)
+        {
+            bytes = reinterpret_cast<const char*>(window);
+        }
+        else
+        {
+            file.seek(mapStart);
+            fallback = file.read(mapEnd - mapStart);
+            if(fallback.size() != mapEnd - mapStart)
+            {
+                return -1;
+            }
+            bytes = fallback.constData();
+        }
+
+        const int mapLength = static_cast<int>(mapEnd - mapStart);
+        const int limit = static_cast<int>(candidatesEnd - mapStart);
+        qint64 match = -1;
+
+        for(int i = static_cast<int>(position - mapStart); i < limit; i++)
+        {
+            int hit = -1;
+
+            if(query.caseSensitive)
+            {
+                hit = matcher.indexIn(bytes, limit - 1 + needleLength, i);
+            }
+            else
+            {
+                for(int j = i; j < limit && hit < 0; j++)
+                {
+                    int k = 0;
+                    while(k < needleLength && asciiLower(bytes[j + k]) == needle.at(k))
+                    {
+                        k++;
+                    }
+                    hit = (k == needleLength) ? j : -1;
+                }
+            }
+
+            if(hit < 0)
+            {
+                break;
+            }
+
+            bool startsWord = (hit == 0 && mapStart == 0) || !isWordByte(bytes[hit - 1]);
+            bool endsWord = (hit + needleLength == mapLength) || !isWordByte(bytes[hit + needleLength]);
+
+            if(!query.wholeWords || (startsWord && endsWord))
+            {
+                match = mapStart + hit;
+                break;
+            }
+
+            i = hit;
+        }
+
+        if(window != nullptr)
+        {
+            file.unmap(window);
+        }
+
+        if(match >= 0)
+        {
+            return match;
+        }
+
+        position = candidatesEnd;
+    }
+
+    return -1;
+}
+
+
+/* Called on the UI thread when a search finishes. Scrolls the match into view and
+ * highlights it, or tells the user that nothing was found.
+ */
+void LargeFileViewer::on_searchFinished()
+{
+    if(searchCancelled->load() != 0)
+    {
+        return;
+    }
+
+    qint64 match = searchWatcher.result();
+    if(match < 0)
+    {
+        matchOffset = -1;
+        viewport()->update();
+        emit(findResultReady("No results found."));
+        return;
+    }
+
+    matchOffset = match;
+    matchLength = lastQuery.needle.size();
+
+    // The match may lie beyond what the index has reached so far
+    int line = lineOfOffset(match);
+    furthestKnownLine = qMax(furthestKnownLine, line + 1);
+    updateScrollBars();
+
+    int visibleLines = qMax(1, viewport()->height() / fontMetrics().height());
+    verticalScrollBar()->setValue(qMax(0, line - visibleLines / 2));
+
+    // Scroll sideways if the match is off screen
+    qint64 lineOffset = offsetOfLine(line);
+    qint64 nextLineOffset;
+    QByteArray bytes = readLine(lineOffset, &nextLineOffset);
+    int x = fontMetrics().width(toDisplayText(bytes.left(static_cast<int>(qMin<qint64>(match - lineOffset, bytes.size())))));
+    int visibleWidth = viewport()->width() - getGutterWidth();
+
+    if(x < horizontalScrollBar()->value() || x > horizontalScrollBar()->value() + visibleWidth)
+    {
+        longestLineWidth = qMax(longestLineWidth, fontMetrics().width(toDisplayText(bytes)));
+        updateScrollBars();
+        horizontalScrollBar()->setValue(x - visibleWidth / 2);
+    }
+
+    viewport()->update();
+}
@@ -0,0 +1,115 @@
+#ifndef LARGEFILEVIEWER_H
+#define LARGEFILEVIEWER_H
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <QVector>
+#include <QList>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QByteArray>
+
+
+/* A read-only view of a file too large to load into a QTextDocument. The file stays
+ * on disk: the lines on screen are read from memory-mapped windows of the file as they
+ * are painted, and only a handful of windows are ever mapped at once. A worker thread
+ * builds a sparse index holding the offset of every Nth line, which is what makes
+ * scrolling, Go To and mapping search hits back to line numbers cheap. The index's
+ * stride doubles whenever it grows past a fixed number of entries, so memory use stays
+ * bounded no matter how large the file is.
+ */
+class LargeFileViewer : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    LargeFileViewer(QWidget *parent = nullptr);
+    ~LargeFileViewer() override;
+
+    bool open(const QString &filePath, QString *errorString);
+    QString getFileName() const;
+    inline QString getCurrentFilePath() const { return filePath; }
+    inline qint64 getFileSize() const { return fileSize; }
+    int getLineCount();
+    int getIndexProgress();
+    inline bool isIndexing() const { return indexer.isRunning(); }
+
+signals:
+    void findResultReady(QString message);
+    void gotoResultReady(QString message);
+    void indexProgressChanged(int percent);
+
+public slots:
+    void find(QString query, bool caseSensitive, bool wholeWords, bool regex);
+    void goTo(int line);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private slots:
+    void on_indexProgress(qint64 bytesIndexed);
+    void on_searchFinished();
+
+private:
+    struct MappedWindow
+    {
+        qint64 start;
+        qint64 length;
+        uchar *bytes;
+    };
+
+    struct SearchQuery
+    {
+        QByteArray needle;
+        bool caseSensitive = false;
+        bool wholeWords = false;
+    };
+
+    void buildLineIndex();
+    static qint64 search(QString filePath, qint64 fileSize, SearchQuery query, qint64 from, QSharedPointer<QAtomicInt> cancelled);
+    static qint64 searchRange(QFile &file, const SearchQuery &query, qint64 from, qint64 to, const QAtomicInt &cancelled);
+
+    const char *bytesAt(qint64 offset, qint64 *available);
+    QByteArray readLine(qint64 offset, qint64 *nextLineOffset);
+    qint64 skipLines(qint64 offset, int count);
+    qint64 offsetOfLine(int line);
+    int lineOfOffset(qint64 offset);
+    void updateScrollBars();
+    int getGutterWidth();
+    void cancelSearch();
+    static QString toDisplayText(const QByteArray &bytes);
+
+    QString filePath;
+    QFile file;
+    qint64 fileSize = 0;
+    QList<MappedWindow> mappedWindows;
+
+    // Offsets of lines 0, stride, 2 * stride, ... as far as the index has gotten
+    QMutex indexMutex;
+    QVector<qint64> lineCheckpoints;
+    int checkpointStride = 256;
+    int indexedLines = 1;
+    qint64 indexedBytes = 0;
+    QFuture<void> indexer;
+    QAtomicInt indexerCancelled;
+
+    QFutureWatcher<qint64> searchWatcher;
+    QSharedPointer<QAtomicInt> searchCancelled;
+    SearchQuery lastQuery;
+    qint64 matchOffset = -1;
+    int matchLength = 0;
+    int longestLineWidth = 0;
+    int furthestKnownLine = 0;
+
+    static const qint64 windowSize = 8 * 1024 * 1024;
+    static const int maxMappedWindows = 4;
+    static const int maxCheckpoints = 1 << 20;
+    static const int maxDisplayedLineBytes = 16 * 1024;
+    static const int gutterPadding = 20;
+};
+
+#endif // LARGEFILEVIEWER_H
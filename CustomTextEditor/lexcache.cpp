@@ -0,0 +1,84 @@
+#include "lexcache.h"
+#include <QHash>
+
+
+const int LexCache::maxCost;
+const int LexCache::maxEntryCost;
+
+
+uint qHash(const LexCache::Key &key, uint seed)
+{
+    return qHash(key.grammar, seed) ^ key.textHash ^ uint(key.incomingState);
+}
+
+
+LexCache::LexCache()
+{
+    entries.setMaxCost(maxCost);
+}
+
+
+/* Returns the cache shared by all highlighters.
+ */
+LexCache &LexCache::shared()
+{
+    static LexCache cache;
+    return cache;
+}
+
+
+/* Appends the runs of the tokens in a block to the given vector and returns the state the
+ * block ends in, like Lexer::tokenize. If a block with the same text was lexed with the
+ * same grammar and incoming state before (and is still remembered), its result is used
+ * instead of lexing it again.
+ * @param grammar - the grammar to lex with
+ * @param text - the text of the block
+ * @param length - the length of the block
+ * @param incomingState - the state the previous block ends in
+ * @param runs - receives the runs
+ * @param tokens - used to lex the block, if it has to be
+ */
+int LexCache::tokenize(const Grammar &grammar, const QChar *text, int length, int incomingState, QVector<Run> *runs, QVector<Lexer::Token> *tokens)
+{
+    const Key key = {&grammar, uint(qHashBits(text, sizeof(QChar) * size_t(length))), incomingState};
+    const Entry *cached = entries.object(key);
+
+    if(cached != nullptr && cached->text == QString::fromRawData(text, length))
+    {
+        hits++;
+        runs->append(cached->runs);
+        return cached->endState;
+    }
+
+    misses++;
+    const int endState = grammar.getLexer().tokenize(text, length, incomingState, tokens);
+    const int firstRun = runs->size();
+
+    for(const Lexer::Token &token : *tokens)
+    {
+        runs->append({token.start, (quint32(token.length) << 3) | quint32(token.type)});
+    }
+
+    const int runCount = runs->size() - firstRun;
+    const int cost = int(sizeof(Entry) + sizeof(QChar) * size_t(length) + sizeof(Run) * size_t(runCount));
+
+    if(cost <= maxEntryCost)
+    {
+        Entry *entry = new Entry;
+        entry->text = QString(text, length);
+        entry->runs = runs->mid(firstRun, runCount);
+        entry->endState = endState;
+        entries.insert(key, entry, cost);
+    }
+
+    return endState;
+}
+
+
+/* Returns how often lexing a block was skipped so far, and how full the cache is.
+ */
+LexCache::Statistics LexCache::statistics() const
+{
+    const Statistics statistics = {hits, hits + misses, entries.totalCost(), entries.maxCost()};
+    return statistics;
+}
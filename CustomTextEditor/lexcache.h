@@ -0,0 +1,76 @@
+#ifndef LEXCACHE_H
+#define LEXCACHE_H
+#include "grammar.h"
+#include <QCache>
+#include <QString>
+#include <QVector>
+
+
+/* Remembers how blocks were lexed, so that a block whose text and incoming state are the
+ * same as some block lexed earlier doesn't have to be lexed again. That's what happens
+ * when an edit is undone, or a block comment that was opened (restyling everything after
+ * it) is closed again: the blocks go back to text and states that were just lexed.
+ *
+ * Results are keyed by the block's text (by its hash, then compared in full), the state
+ * it was lexed with and the grammar it was lexed with. There's one cache, shared by the
+ * highlighters of every tab, and it's only used on the UI thread: worker threads lexing
+ * a whole snapshot would mostly fill it with blocks that are evicted before they're
+ * ever looked up again. It holds at most maxCost bytes of text and token runs, dropping
+ * the least recently used results first, and skips blocks too long to be worth keeping.
+ */
+class LexCache
+{
+public:
+
+    // A lexed token, packed: its type is in the low three bits and its length above them
+    struct Run
+    {
+        int start;
+        quint32 lengthAndType;
+    };
+
+    struct Statistics
+    {
+        quint64 hits;
+        quint64 lookups;
+        qint64 bytesUsed;
+        qint64 bytesAllowed;
+    };
+
+    static LexCache &shared();
+
+    int tokenize(const Grammar &grammar, const QChar *text, int length, int incomingState, QVector<Run> *runs, QVector<Lexer::Token> *tokens);
+    Statistics statistics() const;
+
+private:
+
+    LexCache();
+
+    // Grammars live as long as the program, so their addresses tell them apart
+    struct Key
+    {
+        const Grammar *grammar;
+        uint textHash;
+        int incomingState;
+
+        inline bool operator==(const Key &other) const { return grammar == other.grammar && textHash == other.textHash && incomingState == other.incomingState; }
+    };
+
+    struct Entry
+    {
+        QString text;
+        QVector<Run> runs;
+        int endState;
+    };
+
+    friend uint qHash(const Key &key, uint seed);
+
+    QCache<Key, Entry> entries;
+    quint64 hits = 0;
+    quint64 misses = 0;
+
+    static const int maxCost = 8 * 1024 * 1024;
+    static const int maxEntryCost = 16 * 1024;
+};
+
+#endif // LEXCACHE_H
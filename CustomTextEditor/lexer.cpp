@@ -0,0 +1,291 @@
+#include "lexer.h"
+#include <QVarLengthArray>
+
+
+/* Creates a lexer for the language with the given syntax.
+ */
+Lexer::Lexer(const Syntax &syntax) : syntax(syntax), keywords(keywordsOf(syntax))
+{
+    classifyCharacters();
+}
+
+
+/* Creates a lexer for the language with the given syntax, whose keyword table has
+ * already been built (and was, say, read back from a cache).
+ */
+Lexer::Lexer(const Syntax &syntax, const KeywordTable &keywords) : syntax(syntax), keywords(keywords)
+{
+    classifyCharacters();
+}
+
+
+/* Returns the keywords to build the table from: lowercased, if case doesn't matter.
+ */
+QStringList Lexer::keywordsOf(const Syntax &syntax)
+{
+    if(!syntax.caseInsensitiveKeywords)
+    {
+        return syntax.keywords;
+    }
+
+    QStringList keywords;
+    for(const QString &keyword : syntax.keywords)
+    {
+        keywords.append(keyword.toLower());
+    }
+    return keywords;
+}
+
+
+/* Works out, once, what each ASCII character can be part of under this syntax.
+ */
+void Lexer::classifyCharacters()
+{
+    for(int character = 0; character < 128; character++)
+    {
+        const bool letter = (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || character == '_';
+        const bool digit = character >= '0' && character <= '9';
+
+        characterClasses[character] = quint8((letter ? IdentifierStart | IdentifierPart : 0) | (digit ? IdentifierPart : 0));
+    }
+
+    const QString *extras[] = {&syntax.identifierStart, &syntax.identifierCharacters, &syntax.quotes, &syntax.digitSeparators};
+    const int classes[] = {IdentifierStart | IdentifierPart, IdentifierPart, QuoteCharacter, DigitSeparator};
+
+    for(int i = 0; i < 4; i++)
+    {
+        for(QChar character : *extras[i])
+        {
+            if(character.unicode() < 128)
+            {
+                characterClasses[character.unicode()] |= quint8(classes[i]);
+            }
+        }
+    }
+}
+
+
+/* Splits a line into tokens, replacing the contents of the given vector with them, in
+ * order. Text that isn't part of any token (whitespace, punctuation, numbers and plain
+ * identifiers) is left out. Returns the state the line ends in.
+ * @param text - the text of the line
+ * @param length - the length of the line
+ * @param state - the state the previous line ended in (a State, or -1 for the first line)
+ * @param tokens - receives the tokens
+ */
+int Lexer::tokenize(const QChar *text, int length, int state, QVector<Token> *tokens) const
+{
+    tokens->clear();
+    int i = 0;
+
+    // Finish the comment or string the previous line left open
+    if(state == InBlockComment || state == InTripleSingleQuote || state == InTripleDoubleQuote)
+    {
+        int end = -1;
+
+        if(state == InBlockComment)
+        {
+            end = indexOf(text, length, 0, syntax.blockCommentEnd);
+            end = end < 0 ? -1 : end + syntax.blockCommentEnd.length();
+        }
+        else
+        {
+            end = closingQuote(text, length, 0, QLatin1Char(state == InTripleSingleQuote ? '\'' : '"'), 3);
+        }
+
+        if(end < 0)
+        {
+            tokens->append({0, length, BlockComment});
+            return state;
+        }
+
+        tokens->append({0, end, BlockComment});
+        i = end;
+    }
+
+    // Once a quote turns out to have no match, neither does any later quote of its kind on
+    // this line; one bit for each ASCII character
+    quint64 unmatchedQuotes[2] = {0, 0};
+
+    while(i < length)
+    {
+        const ushort character = text[i].unicode();
+
+        if(is(character, IdentifierStart))
+        {
+            int end = i + 1;
+            while(end < length && is(text[end].unicode(), IdentifierPart))
+            {
+                end++;
+            }
+
+            if(end < length && text[end] == QLatin1Char('('))
+            {
+                tokens->append({i, end - i, FunctionName});
+            }
+            else if(syntax.capitalizedClassNames && ((character >= 'A' && character <= 'Z') || character == '_'))
+            {
+                tokens->append({i, end - i, ClassName});
+            }
+            else if(isKeyword(text + i, end - i))
+            {
+                tokens->append({i, end - i, Keyword});
+            }
+
+            i = end;
+            continue;
+        }
+
+        // Numbers, along with their suffixes and digit separators (1'000'000 in C++)
+        if(character >= '0' && character <= '9')
+        {
+            i++;
+            while(i < length && (is(text[i].unicode(), IdentifierPart) ||
+                                 (is(text[i].unicode(), DigitSeparator) && i + 1 < length && is(text[i + 1].unicode(), IdentifierPart))))
+            {
+                i++;
+            }
+            continue;
+        }
+
+        if(startsWith(text, length, i, syntax.lineComment))
+        {
+            tokens->append({i, length - i, InlineComment});
+            return Normal;
+        }
+
+        if(startsWith(text, length, i, syntax.blockCommentStart))
+        {
+            int end = indexOf(text, length, i + syntax.blockCommentStart.length(), syntax.blockCommentEnd);
+
+            if(end < 0)
+            {
+                tokens->append({i, length - i, BlockComment});
+                return InBlockComment;
+            }
+
+            end += syntax.blockCommentEnd.length();
+            tokens->append({i, end - i, BlockComment});
+            i = end;
+            continue;
+        }
+
+        if(is(character, QuoteCharacter))
+        {
+            const QChar quote = text[i];
+
+            if(syntax.tripleQuotedStrings && (character == '"' || character == '\'') && i + 2 < length && text[i + 1] == quote && text[i + 2] == quote)
+            {
+                int end = closingQuote(text, length, i + 3, quote, 3);
+
+                if(end < 0)
+                {
+                    tokens->append({i, length - i, BlockComment});
+                    return character == '\'' ? InTripleSingleQuote : InTripleDoubleQuote;
+                }
+
+                tokens->append({i, end - i, BlockComment});
+                i = end;
+                continue;
+            }
+
+            quint64 &unmatched = unmatchedQuotes[character >> 6];
+            const quint64 bit = quint64(1) << (character & 63);
+            int end = (unmatched & bit) != 0 ? -1 : closingQuote(text, length, i + 1, quote, 1);
+
+            if(end < 0)
+            {
+                unmatched |= bit;
+                i++;
+                continue;
+            }
+
+            tokens->append({i, end - i, Quote});
+            i = end;
+            continue;
+        }
+
+        i++;
+    }
+
+    return Normal;
+}
+
+
+/* Returns true if the given word is a keyword, ignoring case if the syntax says to.
+ */
+bool Lexer::isKeyword(const QChar *word, int length) const
+{
+    if(!syntax.caseInsensitiveKeywords)
+    {
+        return keywords.contains(word, length);
+    }
+
+    // Words are ASCII, so lowercasing them doesn't change their length
+    QVarLengthArray<QChar, 64> lowered(length);
+    for(int i = 0; i < length; i++)
+    {
+        lowered[i] = word[i].toLower();
+    }
+
+    return keywords.contains(lowered.constData(), length);
+}
+
+
+/* Returns the position just past the first run of count unescaped quotes at or after the
+ * given position, or -1 if there isn't one on the line.
+ */
+int Lexer::closingQuote(const QChar *text, int length, int from, QChar quote, int count)
+{
+    for(int i = from; i < length; i++)
+    {
+        if(text[i] == QLatin1Char('\\'))
+        {
+            i++;
+        }
+        else if(text[i] == quote && (count == 1 || (i + 2 < length && text[i + 1] == quote && text[i + 2] == quote)))
+        {
+            return i + count;
+        }
+    }
+
+    return -1;
+}
+
+
+/* Returns true if the given (non-empty) prefix appears at the given position.
+ */
+bool Lexer::startsWith(const QChar *text, int length, int position, const QString &prefix)
+{
+    if(prefix.isEmpty() || position + prefix.length() > length)
+    {
+        return false;
+    }
+
+    for(int i = 0; i < prefix.length(); i++)
+    {
+        if(text[position + i] != prefix.at(i))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* Returns the position of the first occurrence of the given (non-empty) text at or after
+ * the given position, or -1 if there isn't one.
+ */
+int Lexer::indexOf(const QChar *text, int length, int from, const QString &what)
+{
+    for(int i = from; i + what.length() <= length && !what.isEmpty(); i++)
+    {
+        if(startsWith(text, length, i, what))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
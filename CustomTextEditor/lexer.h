@@ -0,0 +1,103 @@
+#ifndef LEXER_H
+#define LEXER_H
+#include "keywordtable.h"
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+
+/* Splits a line of source code into the tokens a highlighter colors, in a single pass.
+ * Comments, strings and their escapes are followed by the lexer itself, so comment and
+ * string delimiters inside a string or comment don't count. Identifiers are ASCII words
+ * ([A-Za-z0-9_]+ starting with a letter or underscore, plus whatever characters the
+ * syntax adds), classified in this order of precedence: a word right before an opening
+ * parenthesis is a function; one starting with an uppercase letter or underscore is a
+ * class (in languages where capitalized names are classes); one in the keyword table is
+ * a keyword. Words starting with a digit are numbers, along with the syntax's digit
+ * separators, and are left alone.
+ *
+ * A quote with no matching quote later on its line isn't a string. Block comments (and
+ * Python's triple-quoted strings, which are colored like them) can span lines: the state
+ * a line ends in is passed on to the next one.
+ */
+class Lexer
+{
+public:
+
+    // What a language looks like to the lexer; empty delimiters are never matched
+    struct Syntax
+    {
+        QStringList keywords;
+        bool caseInsensitiveKeywords = false;
+        QString lineComment;
+        QString blockCommentStart;
+        QString blockCommentEnd;
+        QString quotes = "\"'";                // each one starts (and ends) a single-line string
+        bool tripleQuotedStrings = false;       // Python's multi-line strings
+        QString digitSeparators;                // allowed between the digits of a number
+        QString identifierStart;                // besides letters and underscores
+        QString identifierCharacters;           // besides those and digits, within a word
+        bool capitalizedClassNames = true;
+    };
+
+    enum TokenType
+    {
+        Keyword,
+        ClassName,
+        FunctionName,
+        Quote,
+        InlineComment,
+        BlockComment
+    };
+
+    struct Token
+    {
+        int start;
+        int length;
+        TokenType type;
+    };
+
+    // The state a line ends in
+    enum State
+    {
+        Normal = 0,
+        InBlockComment = 1,
+        InTripleSingleQuote = 2,
+        InTripleDoubleQuote = 3
+    };
+
+    Lexer(const Syntax &syntax);
+    Lexer(const Syntax &syntax, const KeywordTable &keywords);
+
+    inline const Syntax &getSyntax() const { return syntax; }
+    inline const KeywordTable &getKeywords() const { return keywords; }
+
+    int tokenize(const QChar *text, int length, int state, QVector<Token> *tokens) const;
+    inline int tokenize(const QString &text, int state, QVector<Token> *tokens) const { return tokenize(text.constData(), text.length(), state, tokens); }
+
+private:
+
+    // What an ASCII character can be part of, as bit flags
+    enum CharacterClass
+    {
+        IdentifierStart = 1,
+        IdentifierPart = 2,
+        QuoteCharacter = 4,
+        DigitSeparator = 8
+    };
+
+    void classifyCharacters();
+    inline bool is(ushort character, int characterClass) const { return character < 128 && (characterClasses[character] & characterClass) != 0; }
+    bool isKeyword(const QChar *word, int length) const;
+    static QStringList keywordsOf(const Syntax &syntax);
+
+    static int closingQuote(const QChar *text, int length, int from, QChar quote, int count);
+    static bool startsWith(const QChar *text, int length, int position, const QString &prefix);
+    static int indexOf(const QChar *text, int length, int from, const QString &what);
+
+    Syntax syntax;
+    KeywordTable keywords;
+    quint8 characterClasses[128];
+};
+
+#endif // LEXER_H
@@ -0,0 +1,153 @@
+#include "linediff.h"
+#include <QHash>
+
+
+/* Returns the hunks that turn oldLines into newLines, in order. Lines the two have in
+ * common at the start and end are skipped right away; the rest is diffed with Myers'
+ * algorithm, comparing line hashes before comparing the lines themselves. If the two
+ * differ by more than maxEdits lines, the changed middle is returned as a single hunk
+ * rather than spending quadratic time and memory on a minimal diff.
+ * @param oldLines - the lines currently in the document
+ * @param newLines - the lines the document should end up with
+ * @param maxEdits - the most inserted plus deleted lines to look for a minimal diff with
+ */
+QVector<LineDiff::Hunk> LineDiff::compute(const QVector<QStringRef> &oldLines, const QVector<QStringRef> &newLines, int maxEdits)
+{
+    QVector<Hunk> hunks;
+    int oldSize = oldLines.size();
+    int newSize = newLines.size();
+
+    int prefix = 0;
+    while(prefix < oldSize && prefix < newSize && oldLines.at(prefix) == newLines.at(prefix))
+    {
+        prefix++;
+    }
+
+    int suffix = 0;
+    while(suffix < oldSize - prefix && suffix < newSize - prefix &&
+          oldLines.at(oldSize - 1 - suffix) == newLines.at(newSize - 1 - suffix))
+    {
+        suffix++;
+    }
+
+    // Sizes of the middle parts that still need to be diffed
+    const int n = oldSize - prefix - suffix;
+    const int m = newSize - prefix - suffix;
+
+    if(n == 0 && m == 0)
+    {
+        return hunks;
+    }
+
+    QVector<uint> oldHashes(n);
+    QVector<uint> newHashes(m);
+    for(int i = 0; i < n; i++)
+    {
+        oldHashes[i] = qHash(oldLines.at(prefix + i));
+    }
+    for(int j = 0; j < m; j++)
+    {
+        newHashes[j] = qHash(newLines.at(prefix + j));
+    }
+
+    // Forward pass: v[k] is the furthest x reached on diagonal k = x - y
+    const int offset = n + m + 1;
+    QVector<int> v(2 * offset + 1, 0);
+    QVector<QVector<int>> trace;
+    int editCount = -1;
+
+    for(int d = 0; d <= qMin(n + m, maxEdits) && editCount < 0; d++)
+    {
+        for(int k = -d; k <= d; k += 2)
+        {
+            int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1] : v[offset + k - 1] + 1;
+            int y = x - k;
+
+            while(x < n && y < m && oldHashes.at(x) == newHashes.at(y) && oldLines.at(prefix + x) == newLines.at(prefix + y))
+            {
+                x++;
+                y++;
+            }
+
+            v[offset + k] = x;
+            if(x >= n && y >= m)
+            {
+                editCount = d;
+                break;
+            }
+        }
+
+        // Only diagonals -d..d matter at this step
+        trace.append(v.mid(offset - d, 2 * d + 1));
+    }
+
+    if(editCount < 0)
+    {
+        hunks.append({prefix, n, prefix, m});
+        return hunks;
+    }
+
+    // Backtrack through the trace, marking every deleted and inserted line
+    QVector<bool> oldChanged(n, false);
+    QVector<bool> newChanged(m, false);
+    int x = n;
+    int y = m;
+
+    for(int d = editCount; d > 0; d--)
+    {
+        const QVector<int> &previous = trace.at(d - 1);
+        int k = x - y;
+        bool inserted = (k == -d || (k != d && previous.at(k - 1 + d - 1) < previous.at(k + 1 + d - 1)));
+        int previousK = inserted ? k + 1 : k - 1;
+        int previousX = previous.at(previousK + d - 1);
+        int previousY = previousX - previousK;
+
+        // Walk back along the snake of equal lines that followed the edit
+        int snakeStartX = inserted ? previousX : previousX + 1;
+        while(x > snakeStartX)
+        {
+            x--;
+            y--;
+        }
+
+        if(inserted)
+        {
+            newChanged[previousY] = true;
+        }
+        else
+        {
+            oldChanged[previousX] = true;
+        }
+
+        x = previousX;
+        y = previousY;
+    }
+
+    // Unchanged lines pair up in order, so runs of changed lines between them form the hunks
+    int i = 0;
+    int j = 0;
+    while(i < n || j < m)
+    {
+        if(i < n && j < m && !oldChanged.at(i) && !newChanged.at(j))
+        {
+            i++;
+            j++;
+            continue;
+        }
+
+        Hunk hunk = {prefix + i, 0, prefix + j, 0};
+        while(i < n && oldChanged.at(i))
+        {
+            i++;
+            hunk.oldCount++;
+        }
+        while(j < m && newChanged.at(j))
+        {
+            j++;
+            hunk.newCount++;
+        }
+        hunks.append(hunk);
+    }
+
+    return hunks;
+}
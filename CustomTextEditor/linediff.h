@@ -0,0 +1,24 @@
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+#include <QVector>
+#include <QStringRef>
+
+
+/* Line-based diffing, used to bring a document in line with a changed file by
+ * replacing only the lines that actually differ.
+ */
+namespace LineDiff
+{
+    // Replace oldCount lines starting at oldStart with newCount lines starting at newStart
+    struct Hunk
+    {
+        int oldStart;
+        int oldCount;
+        int newStart;
+        int newCount;
+    };
+
+    QVector<Hunk> compute(const QVector<QStringRef> &oldLines, const QVector<QStringRef> &newLines, int maxEdits = 1000);
+}
+
+#endif // LINEDIFF_H
@@ -0,0 +1,234 @@
+#include "literalsearcher.h"
+#include <QtAlgorithms>
+
+#if defined(Q_PROCESSOR_X86) && (defined(Q_CC_GNU) || defined(Q_CC_CLANG))
+#   include <immintrin.h>
+#   define LITERALSEARCHER_SSE2
+#   define LITERALSEARCHER_AVX2
+#   define LITERALSEARCHER_TARGET(features) __attribute__((target(features)))
+#elif defined(Q_CC_MSVC) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#   include <emmintrin.h>
+#   define LITERALSEARCHER_SSE2
+#   define LITERALSEARCHER_TARGET(features)
+#endif
+
+
+namespace
+{
+    /* The needle, and the bits to OR into each haystack character before comparing it
+     * with the needle character at the same offset (0x20 for letters when folding case).
+     */
+    struct Needle
+    {
+        const ushort *characters;
+        const ushort *foldMasks;
+        int length;
+    };
+
+
+    /* Compares the needle with the text at the given candidate position. */
+    inline bool matchesAt(const ushort *candidate, const Needle &needle)
+    {
+        for(int i = 0; i < needle.length; i++)
+        {
+            if((candidate[i] | needle.foldMasks[i]) != needle.characters[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    /* Checks every remaining candidate position one at a time. Used for the tail that
+     * doesn't fill a whole vector, and on CPUs without SSE2.
+     */
+    int indexScalar(const ushort *text, int length, int from, const Needle &needle)
+    {
+        const ushort first = needle.characters[0];
+        const ushort firstMask = needle.foldMasks[0];
+
+        for(int i = from; i + needle.length <= length; i++)
+        {
+            if((text[i] | firstMask) == first && matchesAt(text + i, needle))
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+
+#ifdef LITERALSEARCHER_SSE2
+    /* Checks 8 candidate positions at a time for as long as the needle's last character
+     * still fits in the text. Returns the first match, or -1 after setting from to the
+     * first position it didn't get to.
+     */
+    LITERALSEARCHER_TARGET("sse2")
+    int indexSse2(const ushort *text, int length, int &from, const Needle &needle)
+    {
+        const int lastOffset = needle.length - 1;
+        const __m128i first = _mm_set1_epi16(static_cast<short>(needle.characters[0]));
+        const __m128i firstMask = _mm_set1_epi16(static_cast<short>(needle.foldMasks[0]));
+        const __m128i last = _mm_set1_epi16(static_cast<short>(needle.characters[lastOffset]));
+        const __m128i lastMask = _mm_set1_epi16(static_cast<short>(needle.foldMasks[lastOffset]));
+
+        int i = from;
+        for(; i + lastOffset + 8 <= length; i += 8)
+        {
+            __m128i starts = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i)), firstMask);
+            __m128i ends = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + lastOffset)), lastMask);
+            __m128i candidates = _mm_and_si128(_mm_cmpeq_epi16(starts, first), _mm_cmpeq_epi16(ends, last));
+
+            // Two bits per character
+            quint32 bits = static_cast<quint32>(_mm_movemask_epi8(candidates));
+            while(bits != 0)
+            {
+                int bit = qCountTrailingZeroBits(bits);
+                if(matchesAt(text + i + bit / 2, needle))
+                {
+                    return i + bit / 2;
+                }
+                bits &= ~(3u << bit);
+            }
+        }
+
+        from = i;
+        return -1;
+    }
+#endif
+
+
+#ifdef LITERALSEARCHER_AVX2
+    LITERALSEARCHER_TARGET("avx2")
+    int indexAvx2(const ushort *text, int length, int &from, const Needle &needle)
+    {
+        const int lastOffset = needle.length - 1;
+        const __m256i first = _mm256_set1_epi16(static_cast<short>(needle.characters[0]));
+        const __m256i firstMask = _mm256_set1_epi16(static_cast<short>(needle.foldMasks[0]));
+        const __m256i last = _mm256_set1_epi16(static_cast<short>(needle.characters[lastOffset]));
+        const __m256i lastMask = _mm256_set1_epi16(static_cast<short>(needle.foldMasks[lastOffset]));
+
+        int i = from;
+        for(; i + lastOffset + 16 <= length; i += 16)
+        {
+            __m256i starts = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i)), firstMask);
+            __m256i ends = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i + lastOffset)), lastMask);
+            __m256i candidates = _mm256_and_si256(_mm256_cmpeq_epi16(starts, first), _mm256_cmpeq_epi16(ends, last));
+
+            quint32 bits = static_cast<quint32>(_mm256_movemask_epi8(candidates));
+            while(bits != 0)
+            {
+                int bit = qCountTrailingZeroBits(bits);
+                if(matchesAt(text + i + bit / 2, needle))
+                {
+                    return i + bit / 2;
+                }
+                bits &= ~(3u << bit);
+            }
+        }
+
+        from = i;
+        return -1;
+    }
+#endif
+
+
+    enum class Kernel
+    {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+
+    /* Picks the widest kernel the current CPU supports. */
+    Kernel detectKernel()
+    {
+#if defined(LITERALSEARCHER_AVX2)
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+        {
+            return Kernel::Avx2;
+        }
+        if(__builtin_cpu_supports("sse2"))
+        {
+            return Kernel::Sse2;
+        }
+        return Kernel::Scalar;
+#elif defined(LITERALSEARCHER_SSE2)
+        return Kernel::Sse2;
+#else
+        return Kernel::Scalar;
+#endif
+    }
+}
+
+
+/* Prepares to search for the given needle.
+ * @param needle - the text to search for
+ * @param sensitivity - whether the search should heed the case of results
+ */
+LiteralSearcher::LiteralSearcher(const QString &needle, Qt::CaseSensitivity sensitivity)
+    : needle(needle), foldMasks(needle.length(), 0)
+{
+    if(sensitivity == Qt::CaseSensitive)
+    {
+        return;
+    }
+
+    for(int i = 0; i < needle.length(); i++)
+    {
+        ushort character = needle.at(i).unicode();
+
+        if(character >= 0x80)
+        {
+            unicodeFolding = true;
+            return;
+        }
+
+        ushort lowercase = character | 0x20;
+        if(lowercase >= 'a' && lowercase <= 'z')
+        {
+            this->needle[i] = QChar(lowercase);
+            foldMasks[i] = 0x20;
+        }
+    }
+}
+
+
+/* Returns the index of the first occurrence of the needle in the given text at or after
+ * the given index, or -1 if there is none.
+ * @param text - the first UTF-16 code unit to search
+ * @param length - the number of code units to search
+ * @param from - the index to start searching at
+ */
+int LiteralSearcher::indexIn(const ushort *text, int length, int from) const
+{
+    if(needle.isEmpty() || from < 0 || from + needle.length() > length)
+    {
+        return -1;
+    }
+
+    if(unicodeFolding)
+    {
+        return QString::fromRawData(reinterpret_cast<const QChar*>(text), length).indexOf(needle, from, Qt::CaseInsensitive);
+    }
+
+    static const Kernel kernel = detectKernel();
+    const Needle prepared = {needle.utf16(), foldMasks.constData(), needle.length()};
+    int match = -1;
+
+    switch(kernel)
+    {
+#ifdef LITERALSEARCHER_AVX2
+        case(Kernel::Avx2): match = indexAvx2(text, length, from, prepared); break;
+#endif
+#ifdef LITERALSEARCHER_SSE2
+        case(Kernel::Sse2): match = indexSse2(text, length, from, prepared); break;
+#endif
+        default: break;
+    }
+
+    return match >= 0 ? match : indexScalar(text, length, from, prepared);
+}
@@ -0,0 +1,31 @@
+#ifndef LITERALSEARCHER_H
+#define LITERALSEARCHER_H
+#include <QString>
+#include <QVector>
+
+
+/* Finds literal text in flat UTF-16 buffers. With SSE2 or AVX2, 8 or 16 candidate
+ * positions are checked at a time by comparing the characters where the needle's first
+ * and last characters would go, and only the positions where both agree are compared
+ * in full; without them, a scalar loop does the same one position at a time.
+ *
+ * Case-insensitive search folds ASCII letters as part of those comparisons (by OR-ing
+ * in the lowercase bit wherever the needle has a letter). A needle containing anything
+ * outside ASCII needs full Unicode case folding, so it's left to QString::indexOf.
+ */
+class LiteralSearcher
+{
+public:
+    LiteralSearcher() {}
+    LiteralSearcher(const QString &needle, Qt::CaseSensitivity sensitivity);
+
+    int indexIn(const ushort *text, int length, int from) const;
+    inline int indexIn(const QString &text, int from) const { return indexIn(text.utf16(), text.length(), from); }
+
+private:
+    QString needle;
+    QVector<ushort> foldMasks;
+    bool unicodeFolding = false;
+};
+
+#endif // LITERALSEARCHER_H
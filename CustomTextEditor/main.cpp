@@ -4,6 +4,9 @@
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
+    QApplication::setOrganizationName("Scribe");
+    QApplication::setApplicationName("Scribe");
+
     MainWindow window;
     QApplication::setStyle("fusion");
 
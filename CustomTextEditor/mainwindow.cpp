@@ -6,10 +6,16 @@
 #include <QtPrintSupport/QPrintDialog>  // printing
 #include <QFileDialog>                  // file open/save dialogs
 #include <QFile>                        // file descriptors, IO
-#include <QTextStream>                  // file IO
 #include <QDateTime>                    // current time
 #include <QApplication>                 // quit
 #include <QShortcut>
+#include <QSettings>
+#include <QInputDialog>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QDir>
+#include <QScrollBar>
+#include <QTimer>
 
 
 /* Sets up the main application window and all of its children/widgets.
@@ -20,23 +26,42 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
 
     mapMenuLanguageOptionToLanguageType();
 
+    // Shown once the window is up, should any language definitions be broken
+    if(!Grammar::loadErrors().isEmpty())
+    {
+        QTimer::singleShot(0, this, SLOT(reportLanguageLoadErrors()));
+    }
+
     // Used to ensure that only one language can ever be checked at a time
     languageGroup = new QActionGroup(this);
     languageGroup->setExclusive(true);
-    languageGroup->addAction(ui->actionC_Lang);
-    languageGroup->addAction(ui->actionCPP_Lang);
-    languageGroup->addAction(ui->actionJava_Lang);
-    languageGroup->addAction(ui->actionPython_Lang);
+    for(QAction *languageAction : ui->menuLanguage->actions())
+    {
+        languageGroup->addAction(languageAction);
+    }
     connect(languageGroup, SIGNAL(triggered(QAction*)), this, SLOT(on_languageSelected(QAction*)));
 
     // Set up the find dialog
     findDialog = new FindDialog();
     findDialog->setParent(this, Qt::Tool | Qt::MSWindowsFixedSizeDialogHint);
 
+    // Set up the watch list dialog
+    watchListDialog = new WatchListDialog();
+    watchListDialog->setParent(this, Qt::Tool);
+
     // Set up the goto dialog
     gotoDialog = new GotoDialog();
     gotoDialog->setParent(this, Qt::Tool | Qt::MSWindowsFixedSizeDialogHint);
 
+    // Set up the Find in Files panel, docked below the editor until it's asked for
+    findInFilesPanel = new FindInFilesPanel();
+    findInFilesDock = new QDockWidget(tr("Find in Files"), this);
+    findInFilesDock->setObjectName("findInFilesDock");
+    findInFilesDock->setWidget(findInFilesPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, findInFilesDock);
+    findInFilesDock->hide();
+    connect(findInFilesPanel, SIGNAL(resultActivated(QString, int)), this, SLOT(openFileAtLine(QString, int)));
+
     // Set up the tabbed editor
     tabbedEditor = ui->tabWidget;
     tabbedEditor->setTabsClosable(true);
@@ -58,30 +83,48 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     QObject::connect(tabCloseShortcut, SIGNAL(activated()), this, SLOT(closeTabShortcut()));
 
     mapFileExtensionsToLanguages();
+
+    // Notices when another program changes a file that's open in a tab
+    fileWatcher = new QFileSystemWatcher(this);
+    connect(fileWatcher, SIGNAL(fileChanged(QString)), this, SLOT(on_fileChangedOnDisk(QString)));
+    connect(&rewatchTimer, SIGNAL(timeout()), this, SLOT(on_rewatchTimeout()));
 }
 
 
-/* Maps each menu language option (from the Format dropdown) to its corresponding
- * Language type, for convenience.
+/* Adds an option to the Format > Language menu for each language with a definition (see
+ * Grammar), and maps each option to its corresponding language, for convenience.
  */
 void MainWindow::mapMenuLanguageOptionToLanguageType()
 {
-    menuActionToLanguageMap[ui->actionC_Lang] = Language::C;
-    menuActionToLanguageMap[ui->actionCPP_Lang] = Language::CPP;
-    menuActionToLanguageMap[ui->actionJava_Lang] = Language::Java;
-    menuActionToLanguageMap[ui->actionPython_Lang] = Language::Python;
+    for(const Language &language : Grammar::languages())
+    {
+        QAction *languageAction = ui->menuLanguage->addAction(language);
+        languageAction->setCheckable(true);
+        menuActionToLanguageMap[languageAction] = language;
+    }
+}
+
+
+/* Tells the user which language definitions couldn't be loaded, and why.
+ */
+void MainWindow::reportLanguageLoadErrors()
+{
+    QMessageBox::warning(this, "Warning", tr("Some language definitions couldn't be loaded and were skipped:\n\n") +
+                         Grammar::loadErrors().join("\n"));
 }
 
 
-/* Maps known file extensions to the languages the editor supports.
+/* Maps the file extensions each language's definition lists to that language.
  */
 void MainWindow::mapFileExtensionsToLanguages()
 {
-    extensionToLanguageMap.insert("cpp", Language::CPP);
-    extensionToLanguageMap.insert("h", Language::CPP);
-    extensionToLanguageMap.insert("c", Language::C);
-    extensionToLanguageMap.insert("java", Language::Java);
-    extensionToLanguageMap.insert("py", Language::Python);
+    for(const Language &language : Grammar::languages())
+    {
+        for(const QString &extension : Grammar::of(language)->getExtensions())
+        {
+            extensionToLanguageMap.insert(extension, language);
+        }
+    }
 }
 
 
@@ -96,6 +139,10 @@ MainWindow::~MainWindow()
     delete charCountLabel;
     delete columnCountLabel;
     delete columnLabel;
+    delete undoLabel;
+    delete undoMemoryLabel;
+    delete loadProgressBar;
+    delete cancelLoadButton;
     delete languageGroup;
     delete ui;
 }
@@ -111,49 +158,23 @@ void MainWindow::on_languageSelected(QAction* languageAction)
 }
 
 
-/* Given a Language enum, this function checks the corresponding radio option from the Format > Language
+/* Given a Language, this function checks the corresponding radio option from the Format > Language
  * menu. Used by on_currentTab_changed to reflect the current tab's selected language.
  */
 void MainWindow::triggerCorrespondingMenuLanguageOption(Language lang)
 {
-    switch(lang)
-    {
-        case(Language::C):
-            if(!ui->actionC_Lang->isChecked())
-            {
-                ui->actionC_Lang->trigger();
-            }
-            break;
-
-        case(Language::CPP):
-            if(!ui->actionCPP_Lang->isChecked())
-            {
-                ui->actionCPP_Lang->trigger();
-            }
-            break;
-
-        case(Language::Java):
-            if(!ui->actionJava_Lang->isChecked())
-            {
-                ui->actionJava_Lang->trigger();
-            }
-            break;
-
-        case(Language::Python):
-            if(!ui->actionPython_Lang->isChecked())
-            {
-                ui->actionPython_Lang->trigger();
-            }
-            break;
+    QAction *languageAction = menuActionToLanguageMap.key(lang, nullptr);
 
-        default: return;
+    if(languageAction != nullptr && !languageAction->isChecked())
+    {
+        languageAction->trigger();
     }
 }
 
 
 /* Uses the extension of a file to determine what language, if any, it should be
  * mapped to. If the extension does not match one of the supported languages, or if
- * the file does not have an extension, then the language is set to Language::None.
+ * the file does not have an extension, then no language is set.
  */
 void MainWindow::setLanguageFromExtension()
 {
@@ -162,7 +183,7 @@ void MainWindow::setLanguageFromExtension()
 
     if(indexOfDot == -1)
     {
-        selectProgrammingLanguage(Language::None);
+        selectProgrammingLanguage(Language());
         return;
     }
 
@@ -172,7 +193,7 @@ void MainWindow::setLanguageFromExtension()
 
     if(!extensionSupported)
     {
-        selectProgrammingLanguage(Language::None);
+        selectProgrammingLanguage(Language());
         return;
     }
 
@@ -201,15 +222,27 @@ void MainWindow::selectProgrammingLanguage(Language language)
  */
 void MainWindow::disconnectEditorDependentSignals()
 {
-    disconnect(findDialog, SIGNAL(startFinding(QString, bool, bool)), editor, SLOT(find(QString, bool, bool)));
-    disconnect(findDialog, SIGNAL(startReplacing(QString, QString, bool, bool)), editor, SLOT(replace(QString, QString, bool, bool)));
-    disconnect(findDialog, SIGNAL(startReplacingAll(QString, QString, bool, bool)), editor, SLOT(replaceAll(QString, QString, bool, bool)));
+    disconnect(findDialog, SIGNAL(startFinding(QString, bool, bool, bool)), editor, SLOT(find(QString, bool, bool, bool)));
+    disconnect(findDialog, SIGNAL(startFindingPrevious(QString, bool, bool, bool)), editor, SLOT(findPrevious(QString, bool, bool, bool)));
+    disconnect(findDialog, SIGNAL(queryChanged(QString, bool, bool, bool)), editor, SLOT(findIncrementally(QString, bool, bool, bool)));
+    disconnect(findDialog, SIGNAL(finished(int)), editor, SLOT(clearSearchHighlights()));
+    disconnect(findDialog, SIGNAL(startReplacing(QString, QString, bool, bool, bool)), editor, SLOT(replace(QString, QString, bool, bool, bool)));
+    disconnect(findDialog, SIGNAL(startReplacingAll(QString, QString, bool, bool, bool)), editor, SLOT(replaceAll(QString, QString, bool, bool, bool)));
+    disconnect(watchListDialog, SIGNAL(startWatching(QStringList, bool)), editor, SLOT(setWatchList(QStringList, bool)));
+    disconnect(watchListDialog, SIGNAL(findWatched(int)), editor, SLOT(findWatched(int)));
     disconnect(gotoDialog, SIGNAL(gotoLine(int)), editor, SLOT(goTo(int)));
     disconnect(editor, SIGNAL(findResultReady(QString)), findDialog, SLOT(onFindResultReady(QString)));
+    disconnect(editor, SIGNAL(matchCountReady(int, int)), findDialog, SLOT(onMatchCountReady(int, int)));
+    disconnect(editor, SIGNAL(watchListCountsReady(QStringList, QVector<int>)), watchListDialog, SLOT(onWatchListCountsReady(QStringList, QVector<int>)));
     disconnect(editor, SIGNAL(gotoResultReady(QString)), gotoDialog, SLOT(onGotoResultReady(QString)));
     disconnect(editor, SIGNAL(undoAvailable(bool)), this, SLOT(toggleUndo(bool)));
     disconnect(editor, SIGNAL(redoAvailable(bool)), this, SLOT(toggleRedo(bool)));
+    disconnect(editor, SIGNAL(undoMemoryChanged(qint64, qint64)), this, SLOT(updateUndoMemory(qint64, qint64)));
     disconnect(editor, SIGNAL(copyAvailable(bool)), this, SLOT(toggleCopyAndCut(bool)));
+    disconnect(editor, SIGNAL(columnCountChanged(int)), this, SLOT(updateColumnCount(int)));
+    disconnect(editor, SIGNAL(windowNeedsToBeUpdated(DocumentMetrics)), this, SLOT(updateWordAndCharCount(DocumentMetrics)));
+    disconnect(editor, SIGNAL(windowNeedsToBeUpdated(DocumentMetrics)), this, SLOT(updateTabAndWindowTitle()));
+    disconnect(editor, SIGNAL(modificationChanged(bool)), this, SLOT(updateTabAndWindowTitle()));
 }
 
 
@@ -222,18 +255,75 @@ void MainWindow::reconnectEditorDependentSignals()
     connect(editor, SIGNAL(columnCountChanged(int)), this, SLOT(updateColumnCount(int)));
     connect(editor, SIGNAL(windowNeedsToBeUpdated(DocumentMetrics)), this, SLOT(updateWordAndCharCount(DocumentMetrics)));
     connect(editor, SIGNAL(windowNeedsToBeUpdated(DocumentMetrics)), this, SLOT(updateTabAndWindowTitle()));
+    connect(editor, SIGNAL(modificationChanged(bool)), this, SLOT(updateTabAndWindowTitle()));
     connect(editor, SIGNAL(findResultReady(QString)), findDialog, SLOT(onFindResultReady(QString)));
+    connect(editor, SIGNAL(matchCountReady(int, int)), findDialog, SLOT(onMatchCountReady(int, int)));
+    connect(editor, SIGNAL(watchListCountsReady(QStringList, QVector<int>)), watchListDialog, SLOT(onWatchListCountsReady(QStringList, QVector<int>)));
     connect(editor, SIGNAL(gotoResultReady(QString)), gotoDialog, SLOT(onGotoResultReady(QString)));
     connect(editor, SIGNAL(undoAvailable(bool)), this, SLOT(toggleUndo(bool)));
     connect(editor, SIGNAL(redoAvailable(bool)), this, SLOT(toggleRedo(bool)));
+    connect(editor, SIGNAL(undoMemoryChanged(qint64, qint64)), this, SLOT(updateUndoMemory(qint64, qint64)));
     connect(editor, SIGNAL(copyAvailable(bool)), this, SLOT(toggleCopyAndCut(bool)));
 
     // Reconnect find/goto signals and slots to the current editor
-    connect(findDialog, SIGNAL(startFinding(QString, bool, bool)), editor, SLOT(find(QString, bool, bool)));
-    connect(findDialog, SIGNAL(startReplacing(QString, QString, bool, bool)), editor, SLOT(replace(QString, QString, bool, bool)));
-    connect(findDialog, SIGNAL(startReplacingAll(QString, QString, bool, bool)), editor, SLOT(replaceAll(QString, QString, bool, bool)));
+    connect(findDialog, SIGNAL(startFinding(QString, bool, bool, bool)), editor, SLOT(find(QString, bool, bool, bool)));
+    connect(findDialog, SIGNAL(startFindingPrevious(QString, bool, bool, bool)), editor, SLOT(findPrevious(QString, bool, bool, bool)));
+    connect(findDialog, SIGNAL(queryChanged(QString, bool, bool, bool)), editor, SLOT(findIncrementally(QString, bool, bool, bool)));
+    connect(findDialog, SIGNAL(finished(int)), editor, SLOT(clearSearchHighlights()));
+    connect(findDialog, SIGNAL(startReplacing(QString, QString, bool, bool, bool)), editor, SLOT(replace(QString, QString, bool, bool, bool)));
+    connect(findDialog, SIGNAL(startReplacingAll(QString, QString, bool, bool, bool)), editor, SLOT(replaceAll(QString, QString, bool, bool, bool)));
+    connect(watchListDialog, SIGNAL(startWatching(QStringList, bool)), editor, SLOT(setWatchList(QStringList, bool)));
+    connect(watchListDialog, SIGNAL(findWatched(int)), editor, SLOT(findWatched(int)));
     connect(gotoDialog, SIGNAL(gotoLine(int)), editor, SLOT(goTo(int)));
 
+    // The count belonged to the previous tab's search
+    findDialog->clearMatchCount();
+    watchListDialog->onWatchListCountsReady(editor->getWatchList()->getPatterns(), editor->getWatchList()->getCounts());
+}
+
+
+/* Disconnects all signals that depend on the cached viewer tab. Counterpart of
+ * disconnectEditorDependentSignals for tabs showing a LargeFileViewer.
+ */
+void MainWindow::disconnectViewerDependentSignals()
+{
+    disconnect(findDialog, SIGNAL(startFinding(QString, bool, bool, bool)), viewer, SLOT(find(QString, bool, bool, bool)));
+    disconnect(gotoDialog, SIGNAL(gotoLine(int)), viewer, SLOT(goTo(int)));
+    disconnect(viewer, SIGNAL(findResultReady(QString)), findDialog, SLOT(onFindResultReady(QString)));
+    disconnect(viewer, SIGNAL(gotoResultReady(QString)), gotoDialog, SLOT(onGotoResultReady(QString)));
+}
+
+
+/* Connects all signals and slots that depend on the cached viewer tab. A viewer is
+ * read-only, so only finding and going to a line apply to it.
+ */
+void MainWindow::reconnectViewerDependentSignals()
+{
+    connect(viewer, SIGNAL(findResultReady(QString)), findDialog, SLOT(onFindResultReady(QString)));
+    connect(viewer, SIGNAL(gotoResultReady(QString)), gotoDialog, SLOT(onGotoResultReady(QString)));
+    connect(findDialog, SIGNAL(startFinding(QString, bool, bool, bool)), viewer, SLOT(find(QString, bool, bool, bool)));
+    connect(gotoDialog, SIGNAL(gotoLine(int)), viewer, SLOT(goTo(int)));
+    findDialog->clearMatchCount();
+    watchListDialog->onWatchListCountsReady(QStringList(), QVector<int>());
+}
+
+
+/* Enables or disables the actions that only make sense for an editable document.
+ * Undo, Redo, Cut and Copy are toggled separately, by the editor's own signals.
+ */
+void MainWindow::toggleEditingActions(bool enabled)
+{
+    ui->actionSave->setEnabled(enabled);
+    ui->actionSave_As->setEnabled(enabled);
+    ui->actionPrint->setEnabled(enabled);
+    ui->actionPaste->setEnabled(enabled);
+    ui->actionReplace->setEnabled(enabled);
+    ui->actionSelect_All->setEnabled(enabled);
+    ui->actionTime_Date->setEnabled(enabled);
+    ui->actionFont->setEnabled(enabled);
+    ui->actionFollow_File->setEnabled(enabled);
+    ui->actionWatch_List->setEnabled(enabled);
+    languageGroup->setEnabled(enabled);
 }
 
 
@@ -255,15 +345,51 @@ void MainWindow::on_currentTab_changed(int index)
         // Disconnect for previous active editor
         disconnectEditorDependentSignals();
     }
+    else if(viewer != nullptr)
+    {
+        disconnectViewerDependentSignals();
+    }
 
-    // Set the internal editor to the currently tabbed one
+    // Set the internal editor (or viewer, for huge files) to the currently tabbed one
     editor = qobject_cast<Editor*>(tabbedEditor->widget(index));
+    viewer = qobject_cast<LargeFileViewer*>(tabbedEditor->widget(index));
+
+    if(viewer != nullptr)
+    {
+        viewer->setFocus(Qt::FocusReason::TabFocusReason);
+        toggleEditingActions(false);
+        toggleUndo(false);
+        toggleRedo(false);
+        toggleCopyAndCut(false);
+        ui->actionFollow_File->setChecked(false);
+
+        if(languageGroup->checkedAction())
+        {
+            languageGroup->checkedAction()->setChecked(false);
+        }
+        languageLabel->setText(toString(Language()));
+
+        reconnectViewerDependentSignals();
+
+        // Words and chars would take a pass over the whole file, so they aren't counted for viewers
+        wordCountLabel->setText(tr("-   "));
+        charCountLabel->setText(tr("-   "));
+        columnCountLabel->setText(tr("-   "));
+        undoMemoryLabel->setText(tr("-   "));
+        undoMemoryLabel->setToolTip(QString());
+        updateTabAndWindowTitle();
+        showLoadProgress();
+        return;
+    }
+
     editor->setFocus(Qt::FocusReason::TabFocusReason);
+    toggleEditingActions(true);
+    ui->actionFollow_File->setChecked(editor->isFollowing());
 
     Language tabLanguage = editor->getProgrammingLanguage();
 
     // If this tab had a programming language set, trigger the corresponding option
-    if(tabLanguage != Language::None)
+    if(!tabLanguage.isEmpty())
     {
         triggerCorrespondingMenuLanguageOption(tabLanguage);
     }
@@ -291,6 +417,8 @@ void MainWindow::on_currentTab_changed(int index)
     updateWordAndCharCount(metrics);
     updateTabAndWindowTitle();
     updateColumnCount(metrics.currentColumn);
+    updateUndoMemory(editor->getUndoHistory()->memoryUsage(), editor->getUndoHistory()->spilledBytes());
+    showLoadProgress();
 }
 
 
@@ -306,13 +434,29 @@ void MainWindow::initializeStatusBarLabels()
     charCountLabel = new QLabel();
     columnLabel = new QLabel("Column: ");
     columnCountLabel = new QLabel();
+    undoLabel = new QLabel(tr("Undo: "));
+    undoMemoryLabel = new QLabel();
+    loadProgressBar = new QProgressBar();
+    cancelLoadButton = new QPushButton(tr("Cancel"));
     ui->statusBar->addWidget(languageLabel);
+    languageLabel->installEventFilter(this);
     ui->statusBar->addPermanentWidget(wordLabel);
     ui->statusBar->addPermanentWidget(wordCountLabel);
     ui->statusBar->addPermanentWidget(charLabel);
     ui->statusBar->addPermanentWidget(charCountLabel);
     ui->statusBar->addPermanentWidget(columnLabel);
     ui->statusBar->addPermanentWidget(columnCountLabel);
+    ui->statusBar->addPermanentWidget(undoLabel);
+    ui->statusBar->addPermanentWidget(undoMemoryLabel);
+
+    // Only shown while the current tab is still streaming in a large file
+    loadProgressBar->setRange(0, 100);
+    loadProgressBar->setMaximumWidth(150);
+    ui->statusBar->addPermanentWidget(loadProgressBar);
+    ui->statusBar->addPermanentWidget(cancelLoadButton);
+    loadProgressBar->hide();
+    cancelLoadButton->hide();
+    connect(cancelLoadButton, SIGNAL(clicked()), this, SLOT(on_cancelLoadButton_clicked()));
 }
 
 
@@ -330,6 +474,20 @@ void MainWindow::launchFindDialog()
 }
 
 
+/* Launches the Watch List dialog box if it isn't already visible and sets its focus.
+ */
+void MainWindow::launchWatchListDialog()
+{
+    if(watchListDialog->isHidden())
+    {
+        watchListDialog->show();
+        watchListDialog->activateWindow();
+        watchListDialog->raise();
+        watchListDialog->setFocus();
+    }
+}
+
+
 /* Launches the Go To dialog box if it isn't already visible and sets its focus.
  */
 void MainWindow::launchGotoDialog()
@@ -349,9 +507,23 @@ void MainWindow::launchGotoDialog()
  */
 void MainWindow::updateTabAndWindowTitle()
 {
+    if(viewer != nullptr)
+    {
+        tabbedEditor->setTabText(tabbedEditor->currentIndex(), viewer->getFileName());
+        setWindowTitle(viewer->getFileName() + " [Read-only]");
+        return;
+    }
+
     QString fileName = editor->getFileName();
     bool editorUnsaved = editor->isUnsaved();
 
+    if(editor->isSaving())
+    {
+        tabbedEditor->setTabText(tabbedEditor->currentIndex(), fileName + " (Saving...)");
+        setWindowTitle(fileName + " [Saving...]");
+        return;
+    }
+
     tabbedEditor->setTabText(tabbedEditor->currentIndex(), fileName + (editorUnsaved ? " *" : ""));
     setWindowTitle(fileName + (editorUnsaved ? " [Unsaved]" : ""));
 }
@@ -370,6 +542,32 @@ void MainWindow::updateWordAndCharCount(DocumentMetrics metrics)
 }
 
 
+/* Shows how much memory the current tab's undo history takes up. The tooltip adds the
+ * compressed copy of the text the history keeps (see UndoHistory), which isn't budgeted.
+ * @param inMemory - the bytes of undo history held in memory
+ * @param onDisk - the bytes of undo history spilled to disk
+ */
+void MainWindow::updateUndoMemory(qint64 inMemory, qint64 onDisk)
+{
+    QString text = Utility::toMegabytes(inMemory);
+
+    if(onDisk > 0)
+    {
+        text += tr(" (+") + Utility::toMegabytes(onDisk) + tr(" on disk)");
+    }
+    undoMemoryLabel->setText(text + tr("   "));
+
+    if(editor != nullptr)
+    {
+        const UndoHistory *undoHistory = editor->getUndoHistory();
+        undoMemoryLabel->setToolTip(tr("In memory: ") + Utility::toMegabytes(inMemory) +
+                                    tr(" of ") + Utility::toMegabytes(undoHistory->getMemoryBudget()) +
+                                    tr("\nSpilled to disk: ") + Utility::toMegabytes(onDisk) +
+                                    tr("\nCompressed copy of the text: ") + Utility::toMegabytes(undoHistory->textCopyBytes()));
+    }
+}
+
+
 /* Launches a dialog box asking the user if they would like to save the current file.
  * If the user selects "No" or closes the dialog window, the file will not be saved.
  * Otherwise, if they select "Yes," the file will be saved.
@@ -394,16 +592,30 @@ void MainWindow::on_actionNew_triggered()
 
 
 /* Called when the user selects the Save or Save As option from the menu or toolbar
- * (or uses Ctrl+S). On success, saves the contents of the text editor to the disk using
+ * (or uses Ctrl+S). Starts saving the contents of the text editor to the disk using
  * the file name provided by the user. If the current document was never saved, or if the
  * user chose Save As, the program prompts the user to specify a name and directory for the file.
- * Returns true if the file was saved and false otherwise.
+ * The file is written in the background (see FileSaver), and on_saveFinished reports the outcome.
+ * Returns true if saving started and false otherwise.
  */
 bool MainWindow::on_actionSave_or_actionSaveAs_triggered()
 {
     bool saveAs = sender() == ui->actionSave_As;
     QString currentFilePath = editor->getCurrentFilePath();
 
+    // Saving now would only write out the part of the file that has loaded so far
+    if(editor->isLoading())
+    {
+        ui->statusBar->showMessage(tr("Please wait for the file to finish loading"), 2000);
+        return false;
+    }
+
+    if(editor->isSaving())
+    {
+        ui->statusBar->showMessage(tr("Please wait for the file to finish saving"), 2000);
+        return false;
+    }
+
     // If user hit Save As or user hit Save but current document was never saved to disk
     if(saveAs || currentFilePath.isEmpty())
     {
@@ -421,27 +633,240 @@ bool MainWindow::on_actionSave_or_actionSaveAs_triggered()
         editor->setCurrentFilePath(filePath);
     }
 
-    // Attempt to create a file descriptor with the given path
-    QFile file(editor->getCurrentFilePath());
-    if (!file.open(QIODevice::WriteOnly | QFile::Text))
+    // Snapshot the text here; the document itself can't be read from another thread
+    FileSaver *saver = new FileSaver(editor->getCurrentFilePath(), editor);
+    connect(saver, SIGNAL(finished(bool)), this, SLOT(on_saveFinished(bool)));
+    editor->setSaver(saver);
+    saver->start(editor->toPlainText(), editor->document()->revision());
+
+    ui->statusBar->showMessage(tr("Saving..."));
+    updateTabAndWindowTitle();
+    setLanguageFromExtension();
+
+    return true;
+}
+
+
+/* Called when a tab's file has been written to disk, or failed to be. The tab is only
+ * marked as saved if it hasn't been edited since its text was snapshotted for saving.
+ */
+void MainWindow::on_saveFinished(bool succeeded)
+{
+    FileSaver *saver = qobject_cast<FileSaver*>(sender());
+    Editor *savedEditor = qobject_cast<Editor*>(saver->parent());
+    savedEditor->setSaver(nullptr);
+
+    if(succeeded && savedEditor->document()->revision() == saver->getRevision())
     {
-        QMessageBox::warning(this, "Warning", "Cannot save file: " + file.errorString());
-        return false;
+        savedEditor->setModifiedState(false);
     }
 
-    ui->statusBar->showMessage("Document saved", 2000);
+    // Our own write isn't an outside change that needs reloading
+    if(succeeded)
+    {
+        watchFile(saver->getFilePath());
+    }
 
-    // Save the contents of the editor to the disk and close the file descriptor
-    QTextStream out(&file);
-    QString editorContents = editor->toPlainText();
-    out << editorContents;
-    file.close();
+    // What was just written isn't growth of the followed file
+    if(succeeded && savedEditor->isFollowing())
+    {
+        if(savedEditor->getFollower()->getFilePath() == saver->getFilePath())
+        {
+            savedEditor->getFollower()->skipToEnd();
+        }
+        else
+        {
+            // Saved under a new name (Save As), so the old file is no longer this tab's
+            delete savedEditor->getFollower();
+            savedEditor->setFollower(nullptr);
 
-    editor->setModifiedState(false);
-    updateTabAndWindowTitle();
-    setLanguageFromExtension();
+            if(savedEditor == editor)
+            {
+                ui->actionFollow_File->setChecked(false);
+            }
+        }
+    }
 
-    return true;
+    if(savedEditor == editor)
+    {
+        updateTabAndWindowTitle();
+    }
+    else
+    {
+        tabbedEditor->setTabText(tabbedEditor->indexOf(savedEditor), savedEditor->getFileName() + (savedEditor->isUnsaved() ? " *" : ""));
+    }
+
+    if(succeeded)
+    {
+        ui->statusBar->showMessage(tr("Document saved (") + Utility::toMegabytes(saver->getBytesWritten()) +
+                                   tr(" in ") + QString::number(saver->getElapsedMilliseconds()) + tr(" ms)"), 2000);
+    }
+    else
+    {
+        ui->statusBar->clearMessage();
+        QMessageBox::warning(this, "Warning", "Cannot save file: " + saver->getErrorString());
+    }
+
+    saver->deleteLater();
+}
+
+
+/* Blocks until the given editor's save in progress, if any, has finished. Events keep
+ * being processed in the meantime, so the window still repaints.
+ */
+void MainWindow::waitForSave(Editor *savingEditor)
+{
+    if(!savingEditor->isSaving())
+    {
+        return;
+    }
+
+    QEventLoop loop;
+    connect(savingEditor->getSaver(), SIGNAL(finished(bool)), &loop, SLOT(quit()));
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+}
+
+
+/* Starts (or keeps) watching the file at the given path for changes made by other
+ * programs, remembering its current state as the one the tabs showing it are in sync with.
+ */
+void MainWindow::watchFile(const QString &filePath)
+{
+    QFileInfo fileInfo(filePath);
+    knownDiskStates.insert(filePath, qMakePair(fileInfo.lastModified(), fileInfo.size()));
+
+    if(!fileWatcher->files().contains(filePath))
+    {
+        fileWatcher->addPath(filePath);
+    }
+}
+
+
+/* Stops watching the file at the given path, unless another tab still has it open.
+ */
+void MainWindow::unwatchFile(const QString &filePath)
+{
+    for(int i = 0; i < tabbedEditor->count(); i++)
+    {
+        Editor *tab = qobject_cast<Editor*>(tabbedEditor->widget(i));
+        if(tab != nullptr && tab->getCurrentFilePath() == filePath)
+        {
+            return;
+        }
+    }
+
+    fileWatcher->removePath(filePath);
+    knownDiskStates.remove(filePath);
+    missingFiles.remove(filePath);
+}
+
+
+/* Called while some watched files are missing. Each one that's back is treated as
+ * changed, which watches it again; until they're all back, they're checked less and
+ * less often, down to once every maxRewatchInterval.
+ */
+void MainWindow::on_rewatchTimeout()
+{
+    const QSet<QString> checked = missingFiles;
+    for(const QString &filePath : checked)
+    {
+        if(QFileInfo::exists(filePath))
+        {
+            missingFiles.remove(filePath);
+            on_fileChangedOnDisk(filePath);
+        }
+    }
+
+    if(missingFiles.isEmpty())
+    {
+        rewatchTimer.stop();
+    }
+    else if(rewatchTimer.interval() < maxRewatchInterval)
+    {
+        rewatchTimer.setInterval(qMin(rewatchTimer.interval() * 2, int(maxRewatchInterval)));
+    }
+}
+
+
+/* Called when a watched file changes on disk. Every tab showing the file is brought up
+ * to date by replacing just the lines that changed, as one undoable edit (see
+ * FileLoader::reload). Tabs with unsaved changes ask first.
+ */
+void MainWindow::on_fileChangedOnDisk(const QString &filePath)
+{
+    QFileInfo fileInfo(filePath);
+
+    // A deleted file has nothing to reload, but the watcher has let go of it, and it may be
+    // about to come back (some writers delete the old file before creating the new one)
+    if(!fileInfo.exists())
+    {
+        if(knownDiskStates.contains(filePath))
+        {
+            missingFiles.insert(filePath);
+            rewatchTimer.start(rewatchInterval);
+        }
+        return;
+    }
+
+    // Files that get replaced rather than rewritten (as many tools do) drop out of the watch
+    if(!fileWatcher->files().contains(filePath))
+    {
+        fileWatcher->addPath(filePath);
+    }
+
+    QPair<QDateTime, qint64> diskState = qMakePair(fileInfo.lastModified(), fileInfo.size());
+    if(knownDiskStates.value(filePath) == diskState)
+    {
+        return;
+    }
+    knownDiskStates.insert(filePath, diskState);
+
+    for(int i = 0; i < tabbedEditor->count(); i++)
+    {
+        Editor *tab = qobject_cast<Editor*>(tabbedEditor->widget(i));
+        if(tab == nullptr || tab->getCurrentFilePath() != filePath)
+        {
+            continue;
+        }
+
+        // Followed tabs take care of themselves, and loading or saving tabs are busy with the file already
+        if(tab->isFollowing() || tab->isLoading() || tab->isSaving())
+        {
+            continue;
+        }
+
+        if(tab->isUnsaved())
+        {
+            QString prompt = tab->getFileName() + tr(" has changed on disk. Do you want to reload it? Your unsaved changes can be undone afterwards.");
+            if(Utility::promptYesOrNo(this, tr("File changed"), prompt) != QMessageBox::Yes)
+            {
+                continue;
+            }
+        }
+
+        QString errorString;
+        int hunkCount = 0;
+        int scrollPosition = tab->verticalScrollBar()->value();
+
+        if(!FileLoader::reload(filePath, tab->document(), &errorString, &hunkCount))
+        {
+            QMessageBox::warning(this, "Warning", "Cannot reload file: " + errorString);
+            continue;
+        }
+
+        tab->verticalScrollBar()->setValue(scrollPosition);
+        tab->setModifiedState(false);
+
+        if(tab == editor)
+        {
+            updateTabAndWindowTitle();
+        }
+        else
+        {
+            tabbedEditor->setTabText(i, tab->getFileName());
+        }
+        ui->statusBar->showMessage(tr("Reloaded ") + tab->getFileName() + tr(" (") + QString::number(hunkCount) + tr(" changes)"), 5000);
+    }
 }
 
 
@@ -453,8 +878,6 @@ bool MainWindow::on_actionSave_or_actionSaveAs_triggered()
  */
 void MainWindow::on_actionOpen_triggered()
 {
-    bool openInCurrentTab = editor->isUntitled() && !editor->isUnsaved();
-
     // Ask the user to specify the name of the file
     QString filePath = QFileDialog::getOpenFileName(this, tr("Open"));
 
@@ -464,29 +887,353 @@ void MainWindow::on_actionOpen_triggered()
         return;
     }
 
-    // Attempt to create a file descriptor for the file at the given path
+    openFile(filePath);
+}
+
+
+/* Opens the file at the given path in a new tab (or in the current one, if it's empty and
+ * untitled). Returns false, after warning the user, if the file couldn't be opened.
+ */
+bool MainWindow::openFile(const QString &filePath)
+{
+    bool openInCurrentTab = editor != nullptr && editor->isUntitled() && !editor->isUnsaved();
+
+    // Make sure the file can be read before giving it a tab
     QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QFile::Text))
+    if (!file.open(QIODevice::ReadOnly))
     {
-        QMessageBox::warning(this, "Warning", "Cannot save file: " + file.errorString());
-        return;
+        QMessageBox::warning(this, "Warning", "Cannot open file: " + file.errorString());
+        return false;
+    }
+    file.close();
+
+    // Huge files aren't loaded at all; they're shown straight from the disk
+    if(file.size() >= qint64(getLargeFileThresholdMB()) * 1024 * 1024)
+    {
+        return openInViewer(filePath, openInCurrentTab);
     }
 
-    // Read the file contents into the editor and close the file descriptor
-    QTextStream in(&file);
-    QString documentContents = in.readAll();
+    bool streamFile = file.size() >= StreamingLoader::streamingThreshold;
 
     if(!openInCurrentTab)
     {
         tabbedEditor->add(new Editor());
     }
-    editor->setCurrentFilePath(filePath);
-    editor->setPlainText(documentContents);
-    file.close();
 
+    QString errorString;
+
+    // Large files: show the first screen right away and stream in the rest
+    if(streamFile)
+    {
+        StreamingLoader *loader = new StreamingLoader(filePath, editor->document(), editor);
+        if(!loader->start(&errorString))
+        {
+            delete loader;
+            QMessageBox::warning(this, "Warning", "Cannot open file: " + errorString);
+            return false;
+        }
+
+        connect(loader, SIGNAL(progressChanged(int)), this, SLOT(updateLoadProgress(int)));
+        connect(loader, SIGNAL(finished(bool)), this, SLOT(on_loadFinished(bool)));
+        editor->setLoader(loader);
+        editor->setReadOnly(true);
+        showLoadProgress();
+    }
+    // Everything else: map the file and decode it straight into the editor's document
+    else
+    {
+        FileLoader::Statistics statistics;
+        if(!FileLoader::load(filePath, editor->document(), &errorString, &statistics))
+        {
+            QMessageBox::warning(this, "Warning", "Cannot open file: " + errorString);
+            return false;
+        }
+        reportOpenStatistics(statistics);
+    }
+
+    editor->setCurrentFilePath(filePath);
+    editor->moveCursor(QTextCursor::Start);
     editor->setModifiedState(false);
     updateTabAndWindowTitle();
     setLanguageFromExtension();
+    watchFile(filePath);
+    return true;
+}
+
+
+/* Opens the file at the given path in a new read-only LargeFileViewer tab. If
+ * replaceCurrentTab is set, the current (empty, untitled) tab makes way for it.
+ * Returns false, after warning the user, if the file couldn't be opened.
+ */
+bool MainWindow::openInViewer(const QString &filePath, bool replaceCurrentTab)
+{
+    QString errorString;
+    LargeFileViewer *newViewer = new LargeFileViewer();
+
+    if(!newViewer->open(filePath, &errorString))
+    {
+        delete newViewer;
+        QMessageBox::warning(this, "Warning", "Cannot open file: " + errorString);
+        return false;
+    }
+
+    Editor *emptyEditor = replaceCurrentTab ? editor : nullptr;
+
+    connect(newViewer, SIGNAL(indexProgressChanged(int)), this, SLOT(updateIndexProgress(int)));
+    tabbedEditor->add(newViewer);
+
+    if(emptyEditor != nullptr)
+    {
+        tabbedEditor->removeTab(tabbedEditor->indexOf(emptyEditor));
+        emptyEditor->deleteLater();
+    }
+
+    ui->statusBar->showMessage(tr("Opened ") + Utility::toMegabytes(newViewer->getFileSize()) + tr(" read-only"), 5000);
+    return true;
+}
+
+
+/* Shows the given file, opening it first if no tab has it open yet, and jumps to the given
+ * line. Called when the user picks one of the Find in Files results.
+ * @param filePath - the path of the file to show
+ * @param line - the one-based number of the line to jump to
+ */
+void MainWindow::openFileAtLine(QString filePath, int line)
+{
+    QFileInfo fileInfo(filePath);
+    int tabIndex = -1;
+
+    for(int i = 0; i < tabbedEditor->count() && tabIndex < 0; i++)
+    {
+        Editor *tabEditor = qobject_cast<Editor*>(tabbedEditor->widget(i));
+        LargeFileViewer *tabViewer = qobject_cast<LargeFileViewer*>(tabbedEditor->widget(i));
+        QString tabFilePath = tabEditor != nullptr ? tabEditor->getCurrentFilePath() :
+                              tabViewer != nullptr ? tabViewer->getCurrentFilePath() : QString();
+
+        if(!tabFilePath.isEmpty() && QFileInfo(tabFilePath) == fileInfo)
+        {
+            tabIndex = i;
+        }
+    }
+
+    if(tabIndex >= 0)
+    {
+        tabbedEditor->setCurrentIndex(tabIndex);
+    }
+    else if(!openFile(filePath))
+    {
+        return;
+    }
+
+    if(viewer != nullptr)
+    {
+        viewer->goTo(line);
+        viewer->setFocus();
+        return;
+    }
+
+    // A file that's still streaming in may not have the line yet; jump once it's loaded
+    if(editor->isLoading() && line > editor->blockCount())
+    {
+        pendingGotoEditor = editor;
+        pendingGotoLine = line;
+        return;
+    }
+
+    editor->goTo(line);
+    editor->setFocus();
+}
+
+
+/* Returns the size, in megabytes, from which files are opened in a read-only
+ * LargeFileViewer instead of an Editor.
+ */
+int MainWindow::getLargeFileThresholdMB() const
+{
+    QSettings settings;
+    return settings.value("largeFileThresholdMB", defaultLargeFileThresholdMB).toInt();
+}
+
+
+/* Called when the user selects the Large File Threshold option from the View menu.
+ * Lets the user choose the size from which files are opened read-only.
+ */
+void MainWindow::on_actionLarge_File_Threshold_triggered()
+{
+    bool userChoseThreshold;
+    int megabytes = QInputDialog::getInt(this, tr("Large File Threshold"),
+                                         tr("Open files of at least this many MB read-only:"),
+                                         getLargeFileThresholdMB(), 1, 1024 * 1024, 1, &userChoseThreshold);
+
+    if(userChoseThreshold)
+    {
+        QSettings settings;
+        settings.setValue("largeFileThresholdMB", megabytes);
+    }
+}
+
+
+/* Called when the user selects the Undo Memory Budget option from the View menu. Lets the
+ * user choose how much memory each tab's undo history may take up before its oldest
+ * entries are spilled to disk, and applies the choice to the tabs already open.
+ */
+void MainWindow::on_actionUndo_Memory_Budget_triggered()
+{
+    bool userChoseBudget;
+    int megabytes = QInputDialog::getInt(this, tr("Undo Memory Budget"),
+                                         tr("MB of undo history to keep in memory per tab:"),
+                                         UndoHistory::configuredMemoryBudgetMB(), 1, 1024 * 1024, 1, &userChoseBudget);
+
+    if(!userChoseBudget)
+    {
+        return;
+    }
+
+    QSettings settings;
+    settings.setValue("undoMemoryBudgetMB", megabytes);
+
+    for(int i = 0; i < tabbedEditor->count(); i++)
+    {
+        Editor *tab = qobject_cast<Editor*>(tabbedEditor->widget(i));
+
+        if(tab != nullptr)
+        {
+            tab->getUndoHistory()->setMemoryBudget(qint64(megabytes) * 1024 * 1024);
+        }
+    }
+}
+
+
+/* Called when a tab finishes streaming in a large file, or when the user cancels that.
+ * Makes the tab editable again. A cancelled tab only holds part of its file, so it is
+ * detached from that file to make sure saving it can't truncate the original.
+ */
+void MainWindow::on_loadFinished(bool cancelled)
+{
+    StreamingLoader *loader = qobject_cast<StreamingLoader*>(sender());
+    Editor *loadedEditor = qobject_cast<Editor*>(loader->parent());
+
+    loadedEditor->setLoader(nullptr);
+    loadedEditor->setReadOnly(false);
+
+    if(loadedEditor == pendingGotoEditor)
+    {
+        if(!cancelled)
+        {
+            loadedEditor->goTo(pendingGotoLine);
+        }
+        pendingGotoEditor = nullptr;
+    }
+
+    if(cancelled)
+    {
+        loadedEditor->clearCurrentFilePath();
+        loadedEditor->setModifiedState(true);
+    }
+
+    if(loadedEditor == editor)
+    {
+        showLoadProgress();
+        updateTabAndWindowTitle();
+
+        if(cancelled)
+        {
+            ui->statusBar->showMessage(tr("Loading cancelled after ") + Utility::toMegabytes(loader->getStatistics().bytesRead), 5000);
+        }
+        else
+        {
+            reportOpenStatistics(loader->getStatistics());
+        }
+    }
+
+    loader->deleteLater();
+}
+
+
+/* Called when the user clicks the status bar's Cancel button while a file is loading.
+ */
+void MainWindow::on_cancelLoadButton_clicked()
+{
+    if(editor != nullptr && editor->isLoading())
+    {
+        editor->getLoader()->cancel();
+    }
+}
+
+
+/* Updates the status bar's progress bar, as long as the progress reported
+ * belongs to the file loading in the current tab.
+ */
+void MainWindow::updateLoadProgress(int percent)
+{
+    if(editor != nullptr && sender() == editor->getLoader())
+    {
+        loadProgressBar->setValue(percent);
+    }
+}
+
+
+/* Updates the status bar's progress bar while the current tab's viewer is indexing
+ * the lines of its file.
+ */
+void MainWindow::updateIndexProgress(int percent)
+{
+    if(sender() != viewer)
+    {
+        return;
+    }
+
+    loadProgressBar->setValue(percent);
+    loadProgressBar->setVisible(percent < 100);
+
+    if(percent == 100)
+    {
+        ui->statusBar->showMessage(tr("Indexed ") + QString::number(viewer->getLineCount()) + tr(" lines"), 5000);
+    }
+}
+
+
+/* Shows or hides the status bar's loading progress to match the current tab.
+ */
+void MainWindow::showLoadProgress()
+{
+    // Indexing a viewer's file can't be cancelled, since the viewer needs the whole index
+    if(viewer != nullptr)
+    {
+        int progress = viewer->getIndexProgress();
+        loadProgressBar->setVisible(progress < 100);
+        loadProgressBar->setValue(progress);
+        cancelLoadButton->hide();
+        return;
+    }
+
+    bool loading = editor->isLoading();
+    loadProgressBar->setVisible(loading);
+    cancelLoadButton->setVisible(loading);
+
+    if(loading)
+    {
+        loadProgressBar->setValue(editor->getLoader()->getProgress());
+    }
+}
+
+
+/* Shows how long the last file took to open and how much memory opening it took (at
+ * its peak, where that can be measured), so that the cost of opening large files can be
+ * verified.
+ */
+void MainWindow::reportOpenStatistics(const FileLoader::Statistics &statistics)
+{
+    QString message = tr("Opened ") + Utility::toMegabytes(statistics.bytesRead) +
+                      tr(" in ") + QString::number(statistics.elapsedMilliseconds) + tr(" ms");
+
+    if(statistics.memoryMeasured())
+    {
+        message += (statistics.peakMeasured ? tr(", peak memory +") : tr(", memory +")) +
+                   Utility::toMegabytes(qMax<qint64>(0, statistics.peakResidentBytes - statistics.residentBytesBefore));
+    }
+
+    ui->statusBar->showMessage(message, 5000);
 }
 
 
@@ -513,8 +1260,9 @@ void MainWindow::on_actionPrint_triggered()
  */
 bool MainWindow::closeTab(int index)
 {
-    Editor *currentTab = editor;
-    Editor *tabToClose = qobject_cast<Editor*>(tabbedEditor->widget(index));
+    QWidget *currentTab = tabbedEditor->currentWidget();
+    QWidget *tabToClose = tabbedEditor->widget(index);
+    Editor *editorToClose = qobject_cast<Editor*>(tabToClose);
     bool closingCurrentTab = (tabToClose == currentTab);
 
     // Allow the user to see what tab they're closing if it's not the current one
@@ -523,16 +1271,29 @@ bool MainWindow::closeTab(int index)
         tabbedEditor->setCurrentWidget(tabToClose);
     }
 
+    // A save that's already under way decides whether anything is left unsaved
+    if(editorToClose != nullptr)
+    {
+        waitForSave(editorToClose);
+    }
+
     // Don't close a tab immediately if it has unsaved contents
-    if(tabToClose->isUnsaved())
+    if(editorToClose != nullptr && editorToClose->isUnsaved())
     {
         QMessageBox::StandardButton selection = askUserToSave();
 
         if(selection == QMessageBox::StandardButton::Yes)
         {
-            bool fileSaved = on_actionSave_or_actionSaveAs_triggered();
+            bool saveStarted = on_actionSave_or_actionSaveAs_triggered();
 
-            if(!fileSaved)
+            if(!saveStarted)
+            {
+                return false;
+            }
+
+            // Only close the tab once its file is safely on disk
+            waitForSave(editorToClose);
+            if(editorToClose->isUnsaved())
             {
                 return false;
             }
@@ -544,8 +1305,41 @@ bool MainWindow::closeTab(int index)
         }
     }
 
+    // Stop streaming in a file that nobody will see
+    if(editorToClose != nullptr && editorToClose->isLoading())
+    {
+        editorToClose->getLoader()->cancel();
+    }
+
+    // Same goes for following one
+    if(editorToClose != nullptr && editorToClose->isFollowing())
+    {
+        delete editorToClose->getFollower();
+        editorToClose->setFollower(nullptr);
+    }
+
+    QString closedFilePath = editorToClose != nullptr ? editorToClose->getCurrentFilePath() : QString();
+
+    // Nothing refers to the tab once it's closed, so it goes (along with its document, undo history and highlighter)
+    if(tabToClose == viewer)
+    {
+        disconnectViewerDependentSignals();
+        viewer = nullptr;
+    }
+    else if(tabToClose == editor)
+    {
+        disconnectEditorDependentSignals();
+        editor = nullptr;
+    }
+    tabToClose->deleteLater();
+
     tabbedEditor->removeTab(index);
 
+    if(!closedFilePath.isEmpty())
+    {
+        unwatchFile(closedFilePath);
+    }
+
     // If we closed the last tab, make a new one
     if(tabbedEditor->count() == 0)
     {
@@ -578,7 +1372,8 @@ void MainWindow::on_actionExit_triggered()
 
         // The only time this will happen after a tab close is
         // if the last one is closed and a new tab is automatically created
-        if(tabbedEditor->count() == 1 && !qobject_cast<Editor*>(tabbedEditor->currentWidget())->isUnsaved())
+        Editor *lastTab = qobject_cast<Editor*>(tabbedEditor->currentWidget());
+        if(tabbedEditor->count() == 1 && lastTab != nullptr && !lastTab->isUnsaved())
         {
             break;
         }
@@ -674,6 +1469,34 @@ void MainWindow::on_actionFind_triggered()
 }
 
 
+/* Called when the user selects the Watch List option from the menu (or uses Ctrl+Shift+L).
+ * Launches a dialog for searching for a list of patterns at once.
+ */
+void MainWindow::on_actionWatch_List_triggered()
+{
+    launchWatchListDialog();
+}
+
+
+/* Called when the user selects the Find in Files option from the menu (or uses Ctrl+Shift+F).
+ * Shows the Find in Files panel, pointed at the current file's directory the first time.
+ */
+void MainWindow::on_actionFind_in_Files_triggered()
+{
+    if(!findInFilesPanel->hasDirectory())
+    {
+        QString currentFilePath = editor != nullptr ? editor->getCurrentFilePath() :
+                                  viewer != nullptr ? viewer->getCurrentFilePath() : QString();
+
+        findInFilesPanel->setDirectory(currentFilePath.isEmpty() ? QDir::currentPath() : QFileInfo(currentFilePath).absolutePath());
+    }
+
+    findInFilesDock->show();
+    findInFilesDock->raise();
+    findInFilesPanel->setFocus();
+}
+
+
 /* Called when the user explicitly selects the Go To option from the menu (or uses Ctrl+G).
  * Launches a Go To dialog that prompts the user to enter a line number they wish to jump to.
  */
@@ -716,7 +1539,10 @@ void MainWindow::on_actionAuto_Indent_triggered()
     for(int i = 0; i < tabbedEditor->count(); i++)
     {
         Editor *tab = qobject_cast<Editor*>(tabbedEditor->widget(i));
-        tab->toggleAutoIndent(ui->actionAuto_Indent->isChecked());
+        if(tab != nullptr)
+        {
+            tab->toggleAutoIndent(ui->actionAuto_Indent->isChecked());
+        }
     }
 }
 
@@ -729,11 +1555,47 @@ void MainWindow::on_actionWord_Wrap_triggered()
     for(int i = 0; i < tabbedEditor->count(); i++)
     {
         Editor *tab = qobject_cast<Editor*>(tabbedEditor->widget(i));
-        tab->toggleWrapMode(ui->actionWord_Wrap->isChecked());
+        if(tab != nullptr)
+        {
+            tab->toggleWrapMode(ui->actionWord_Wrap->isChecked());
+        }
     }
 }
 
 
+/* Called when the user toggles the Follow File option from the View menu. While it's on,
+ * anything appended to the current tab's file on disk is added to the end of the tab.
+ */
+void MainWindow::on_actionFollow_File_triggered()
+{
+    if(!ui->actionFollow_File->isChecked())
+    {
+        delete editor->getFollower();
+        editor->setFollower(nullptr);
+        ui->statusBar->showMessage(tr("Stopped following ") + editor->getFileName(), 2000);
+        return;
+    }
+
+    if(editor->isUntitled())
+    {
+        ui->actionFollow_File->setChecked(false);
+        ui->statusBar->showMessage(tr("Save the document before following it"), 2000);
+        return;
+    }
+
+    // Following before the whole file is in would skip whatever hasn't loaded yet
+    if(editor->isLoading())
+    {
+        ui->actionFollow_File->setChecked(false);
+        ui->statusBar->showMessage(tr("Please wait for the file to finish loading"), 2000);
+        return;
+    }
+
+    editor->setFollower(new FileFollower(editor->getCurrentFilePath(), editor));
+    ui->statusBar->showMessage(tr("Following ") + editor->getFileName(), 2000);
+}
+
+
 /* Toggles the visibility of the status bar.
  */
 void MainWindow::on_actionStatus_Bar_triggered()
@@ -753,3 +1615,22 @@ void MainWindow::closeEvent(QCloseEvent *event)
     on_actionExit_triggered();
 }
 
+
+/* Fills in the language label's tooltip just before it's shown, with how much lexing the
+ * highlighters' shared cache has saved so far (see LexCache).
+ */
+bool MainWindow::eventFilter(QObject *obj, QEvent *event)
+{
+    if(obj == languageLabel && event->type() == QEvent::ToolTip)
+    {
+        const LexCache::Statistics statistics = LexCache::shared().statistics();
+        const double hitRate = statistics.lookups == 0 ? 0.0 : 100.0 * double(statistics.hits) / double(statistics.lookups);
+
+        languageLabel->setToolTip(tr("Highlighting cache: ") + QString::number(statistics.hits) + tr(" of ") +
+                                  QString::number(statistics.lookups) + tr(" lines reused (") + QString::number(hitRate, 'f', 1) + tr("%)") +
+                                  tr("\nCache size: ") + Utility::toMegabytes(statistics.bytesUsed) +
+                                  tr(" of ") + Utility::toMegabytes(statistics.bytesAllowed));
+    }
+
+    return QMainWindow::eventFilter(obj, event);
+}
@@ -4,14 +4,31 @@
 #include "documentmetrics.h"
 #include "editor.h"
 #include "finddialog.h"
+#include "watchlistdialog.h"
 #include "gotodialog.h"
 #include "tabbededitor.h"
 #include "language.h"
+#include "fileloader.h"
+#include "streamingloader.h"
+#include "largefileviewer.h"
+#include "filesaver.h"
+#include "filefollower.h"
+#include "findinfilespanel.h"
 #include <highlighter.h>
 #include <QMainWindow>
 #include <QCloseEvent>                  // closeEvent
 #include <QLabel>                       // GUI labels
 #include <QActionGroup>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QDockWidget>
+#include <QPointer>
+#include <QFileSystemWatcher>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QTimer>
 #include <QtDebug>
 
 
@@ -31,24 +48,45 @@ public:
     ~MainWindow() override;
     void initializeStatusBarLabels();
     void launchFindDialog();
+    void launchWatchListDialog();
     void launchGotoDialog();
     void closeEvent(QCloseEvent *event) override;
+    bool eventFilter(QObject *obj, QEvent *event) override;
 
 private:
     void reconnectEditorDependentSignals();
     void disconnectEditorDependentSignals();
+    void reconnectViewerDependentSignals();
+    void disconnectViewerDependentSignals();
+    void toggleEditingActions(bool enabled);
     QMessageBox::StandardButton askUserToSave();
     void selectProgrammingLanguage(Language language);
     void triggerCorrespondingMenuLanguageOption(Language lang);
     void mapMenuLanguageOptionToLanguageType();
     void mapFileExtensionsToLanguages();
     void setLanguageFromExtension();
+    void reportOpenStatistics(const FileLoader::Statistics &statistics);
+    void showLoadProgress();
+    bool openFile(const QString &filePath);
+    bool openInViewer(const QString &filePath, bool replaceCurrentTab);
+    int getLargeFileThresholdMB() const;
+    void waitForSave(Editor *savingEditor);
+    void watchFile(const QString &filePath);
+    void unwatchFile(const QString &filePath);
 
     Ui::MainWindow *ui;
     TabbedEditor *tabbedEditor;
     Editor *editor = nullptr;
+    LargeFileViewer *viewer = nullptr;
     FindDialog *findDialog;
+    WatchListDialog *watchListDialog;
     GotoDialog *gotoDialog;
+    FindInFilesPanel *findInFilesPanel;
+    QDockWidget *findInFilesDock;
+
+    // An editor still streaming in a file, and the line to jump to once it's done
+    QPointer<Editor> pendingGotoEditor;
+    int pendingGotoLine = 0;
     QActionGroup *languageGroup;
     QMap<QAction*, Language> menuActionToLanguageMap;
     QMap<QString, Language> extensionToLanguageMap;
@@ -59,30 +97,59 @@ private:
     QLabel *charCountLabel;
     QLabel *columnLabel;
     QLabel *columnCountLabel;
+    QLabel *undoLabel;
+    QLabel *undoMemoryLabel;
+    QProgressBar *loadProgressBar;
+    QPushButton *cancelLoadButton;
+
+    // Files open in editor tabs, and their last known modification time and size
+    QFileSystemWatcher *fileWatcher;
+    QHash<QString, QPair<QDateTime, qint64>> knownDiskStates;
+
+    // Watched files that were missing when they changed (replaced by a writer that
+    // deletes before it creates, say), checked until they're back
+    QSet<QString> missingFiles;
+    QTimer rewatchTimer;
+    static const int rewatchInterval = 100;
+    static const int maxRewatchInterval = 1000;
+
+    static const int defaultLargeFileThresholdMB = 512;
 
 public slots:
     inline void updateColumnCount(int col) { columnCountLabel->setText(QString::number(col) + tr("   ")); }
     void updateTabAndWindowTitle();
     void updateWordAndCharCount(DocumentMetrics metrics);
+    void updateUndoMemory(qint64 inMemory, qint64 onDisk);
     void toggleUndo(bool undoAvailable);
     void toggleRedo(bool redoAvailable);
     void toggleCopyAndCut(bool copyCutAvailable);
+    void updateLoadProgress(int percent);
+    void updateIndexProgress(int percent);
     bool closeTab(int index);
     void closeTabShortcut() { closeTab(tabbedEditor->currentIndex()); }
+    void openFileAtLine(QString filePath, int line);
     inline void informUser(QString title, QString message) { QMessageBox::information(findDialog, title, message); }
 
 private slots:
+    void reportLanguageLoadErrors();
     void on_currentTab_changed(int index);
     void on_languageSelected(QAction* languageAction);
     void on_actionNew_triggered();
     bool on_actionSave_or_actionSaveAs_triggered();
+    void on_saveFinished(bool succeeded);
+    void on_fileChangedOnDisk(const QString &filePath);
+    void on_rewatchTimeout();
     void on_actionOpen_triggered();
+    void on_loadFinished(bool cancelled);
+    void on_cancelLoadButton_clicked();
     void on_actionExit_triggered();
     void on_actionUndo_triggered();
     void on_actionCut_triggered();
     void on_actionCopy_triggered();
     void on_actionPaste_triggered();
     void on_actionFind_triggered();
+    void on_actionFind_in_Files_triggered();
+    void on_actionWatch_List_triggered();
     void on_actionGo_To_triggered();
     void on_actionSelect_All_triggered();
     void on_actionRedo_triggered();
@@ -92,6 +159,9 @@ private slots:
     void on_actionFont_triggered();
     void on_actionAuto_Indent_triggered();
     void on_actionWord_Wrap_triggered();
+    void on_actionLarge_File_Threshold_triggered();
+    void on_actionUndo_Memory_Budget_triggered();
+    void on_actionFollow_File_triggered();
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,304 @@
+#include "matchindex.h"
+#include <QTextBlock>
+#include <QtConcurrent>
+#include <algorithm>
+
+
+/* Creates an empty index for the given document. Nothing is indexed until setPattern is called.
+ */
+MatchIndex::MatchIndex(QTextDocument *document, QObject *parent) : QObject(parent), document(document)
+{
+    connect(document, SIGNAL(contentsChange(int, int, int)), this, SLOT(on_contentsChange(int, int, int)));
+    connect(&scanWatcher, SIGNAL(finished()), this, SLOT(on_scanFinished()));
+}
+
+
+/* Stops a scan in progress, and waits for it before the index goes away.
+ */
+MatchIndex::~MatchIndex()
+{
+    cancelScan();
+    scanWatcher.waitForFinished();
+}
+
+
+/* Starts indexing the given pattern, unless it's the one already being indexed.
+ * Returns true if the pattern changed.
+ */
+bool MatchIndex::setPattern(const SearchPattern &pattern)
+{
+    if(pattern == this->pattern)
+    {
+        return false;
+    }
+
+    // The old matches are up to date only once the index is ready
+    bool narrowing = ready && this->pattern.narrowsTo(pattern);
+
+    cancelScan();
+    this->pattern = pattern;
+    candidates = narrowing ? matches : QVector<Match>();
+    matches.clear();
+    ready = false;
+
+    if(pattern.isEmpty() || !pattern.isValid())
+    {
+        return true;
+    }
+
+    if(!narrowing)
+    {
+        startScan();
+    }
+    else if(candidates.isEmpty())
+    {
+        // Nothing matched before, so nothing can match now
+        ready = true;
+    }
+    else
+    {
+        startRefining();
+    }
+
+    return true;
+}
+
+
+/* Scans a snapshot of the whole document on a worker thread.
+ */
+void MatchIndex::startScan()
+{
+    cancelScan();
+    scanCancelled = QSharedPointer<QAtomicInt>::create(0);
+    scannedEdits = edits;
+    scanWatcher.setFuture(QtConcurrent::run(&MatchIndex::scan, pattern, currentText(), scanCancelled));
+}
+
+
+/* Checks only the candidates (the matches of a pattern that narrows to this one) in a
+ * snapshot of the document, on a worker thread.
+ */
+void MatchIndex::startRefining()
+{
+    cancelScan();
+    scanCancelled = QSharedPointer<QAtomicInt>::create(0);
+    scannedEdits = edits;
+    scanWatcher.setFuture(QtConcurrent::run(&MatchIndex::refine, pattern, currentText(), candidates, scanCancelled));
+}
+
+
+/* Returns the snapshot of the document's text, taking it again if the document has
+ * changed since. Scans get a shallow copy of it, so it's never copied for one.
+ */
+const QString &MatchIndex::currentText()
+{
+    if(snapshotEdits != edits)
+    {
+        snapshot = SearchPattern::searchableText(document);
+        snapshotEdits = edits;
+    }
+    return snapshot;
+}
+
+
+/* Lets go of the snapshot of the text, once no more queries are expected for a while
+ * (the Find dialog was closed, say), so it doesn't sit in memory alongside the document.
+ */
+void MatchIndex::releaseSnapshot()
+{
+    snapshot = QString();
+    snapshotEdits = -1;
+}
+
+
+/* Tells the scan in progress, if any, to stop. Its (partial) result is never used, since
+ * the watcher moves on to the next scan, or to none.
+ */
+void MatchIndex::cancelScan()
+{
+    if(scanCancelled)
+    {
+        scanCancelled->store(1);
+    }
+}
+
+
+QVector<MatchIndex::Match> MatchIndex::scan(SearchPattern pattern, QString text, QSharedPointer<QAtomicInt> cancelled)
+{
+    return pattern.findAll(text, 0, cancelled.data());
+}
+
+
+QVector<MatchIndex::Match> MatchIndex::refine(SearchPattern pattern, QString text, QVector<Match> candidates, QSharedPointer<QAtomicInt> cancelled)
+{
+    return pattern.refine(text, candidates, cancelled.data());
+}
+
+
+/* Called when the worker thread is done scanning. If the document was edited in the
+ * meantime, the snapshot is out of date and the document is scanned again. A scan that
+ * was cancelled (because the pattern was cleared) is ignored.
+ */
+void MatchIndex::on_scanFinished()
+{
+    if(scanCancelled->load() != 0)
+    {
+        return;
+    }
+
+    if(edits != scannedEdits)
+    {
+        candidates.clear();
+        startScan();
+        return;
+    }
+
+    matches = scanWatcher.result();
+    candidates.clear();
+    ready = true;
+    emit(updated());
+}
+
+
+/* Called whenever the document changes. Drops the matches in the blocks that were
+ * touched, shifts the ones after them, and rescans just those blocks (or the whole
+ * document, for a regular expression).
+ * @param position - where the change happened
+ * @param charsRemoved - the number of characters removed there
+ * @param charsAdded - the number of characters added there
+ */
+void MatchIndex::on_contentsChange(int position, int charsRemoved, int charsAdded)
+{
+    edits++;
+    snapshot = QString();
+    candidates.clear();
+
+    // Without a finished scan there's nothing to update; a scan in progress starts over once it's done
+    if(!ready)
+    {
+        return;
+    }
+
+    if(pattern.isRegex())
+    {
+        matches.clear();
+        ready = false;
+        startScan();
+        emit(updated());
+        return;
+    }
+
+    QTextBlock firstBlock = document->findBlock(position);
+    QTextBlock lastBlock = document->findBlock(position + charsAdded);
+    if(!firstBlock.isValid())
+    {
+        firstBlock = document->lastBlock();
+    }
+    if(!lastBlock.isValid())
+    {
+        lastBlock = document->lastBlock();
+    }
+
+    const int start = firstBlock.position();
+    const int delta = charsAdded - charsRemoved;
+    const int oldEnd = lastBlock.position() + lastBlock.length() - delta;
+
+    const int firstIndex = static_cast<int>(firstMatchAtOrAfter(matches, start) - matches.constBegin());
+    int lastIndex = firstIndex;
+    while(lastIndex < matches.size() && matches.at(lastIndex).position < oldEnd)
+    {
+        lastIndex++;
+    }
+    matches.remove(firstIndex, lastIndex - firstIndex);
+
+    for(int i = firstIndex; i < matches.size(); i++)
+    {
+        matches[i].position += delta;
+    }
+
+    QString text;
+    for(QTextBlock block = firstBlock; block.isValid(); block = block.next())
+    {
+        text += block.text();
+        if(block == lastBlock)
+        {
+            break;
+        }
+        text += QLatin1Char('\n');
+    }
+
+    QVector<Match> found = pattern.findAll(text, start);
+    matches.insert(firstIndex, found.size(), Match());
+    std::copy(found.constBegin(), found.constEnd(), matches.begin() + firstIndex);
+
+    emit(updated());
+}
+
+
+/* Returns the first match that starts at or after the given position, or one with a
+ * position of -1 if there is none.
+ */
+MatchIndex::Match MatchIndex::nextMatch(int position) const
+{
+    QVector<Match>::const_iterator match = firstMatchAtOrAfter(matches, position);
+    return match == matches.constEnd() ? Match{-1, 0} : *match;
+}
+
+
+/* Returns the last match that starts before the given position, or one with a position
+ * of -1 if there is none.
+ */
+MatchIndex::Match MatchIndex::previousMatch(int position) const
+{
+    QVector<Match>::const_iterator match = firstMatchAtOrAfter(matches, position);
+    return match == matches.constBegin() ? Match{-1, 0} : *(match - 1);
+}
+
+
+/* While the old matches of a narrowed pattern are being refined, returns the first of
+ * them at or after the given position that the new pattern matches at, checking no more
+ * than maxCandidatesChecked. Returns one with a position of -1 if none of those match,
+ * or if there's nothing being refined; the index is then updated once it's ready.
+ */
+MatchIndex::Match MatchIndex::nextCandidate(int position)
+{
+    if(candidates.isEmpty())
+    {
+        return Match{-1, 0};
+    }
+
+    // Start one early, since refine drops a match that overlaps the one before it
+    const int first = qMax(0, static_cast<int>(firstMatchAtOrAfter(candidates, position) - candidates.constBegin()) - 1);
+    const QVector<Match> checked = candidates.mid(first, maxCandidatesChecked);
+
+    for(const Match &match : pattern.refine(currentText(), checked))
+    {
+        if(match.position >= position)
+        {
+            return match;
+        }
+    }
+    return Match{-1, 0};
+}
+
+
+/* Returns the one-based number of the given match, or 0 if it isn't one of the matches.
+ */
+int MatchIndex::ordinalOf(const Match &match) const
+{
+    QVector<Match>::const_iterator found = firstMatchAtOrAfter(matches, match.position);
+    if(found == matches.constEnd() || found->position != match.position || found->length != match.length)
+    {
+        return 0;
+    }
+    return static_cast<int>(found - matches.constBegin()) + 1;
+}
+
+
+/* Binary searches the given matches for the first one that starts at or after the given position.
+ */
+QVector<MatchIndex::Match>::const_iterator MatchIndex::firstMatchAtOrAfter(const QVector<Match> &matches, int position)
+{
+    return std::lower_bound(matches.constBegin(), matches.constEnd(), position,
+                            [](const Match &match, int position) { return match.position < position; });
+}
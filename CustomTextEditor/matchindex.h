@@ -0,0 +1,86 @@
+#ifndef MATCHINDEX_H
+#define MATCHINDEX_H
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QTextDocument>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include "searchpattern.h"
+
+
+/* Keeps the sorted positions of every match of one search pattern in a document. The
+ * document is scanned once on a worker thread when the pattern changes. After that,
+ * each edit only rescans the blocks it touched and shifts the matches after them;
+ * literal matches never span blocks. A regular expression may match across lines, so
+ * for one, each edit starts a new scan in the background instead.
+ *
+ * When the user types one more character of a literal query, the new matches can only
+ * be where the old ones were, so just those positions are checked. Until that's done,
+ * nextCandidate checks a few of them on the spot. A scan that's still running when the
+ * pattern changes again is told to stop.
+ *
+ * Scans share one snapshot of the text, taken again only once the document has changed,
+ * so typing a query doesn't copy the document for every keystroke.
+ */
+class MatchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    MatchIndex(QTextDocument *document, QObject *parent = nullptr);
+    ~MatchIndex() override;
+
+    typedef SearchPattern::Match Match;
+
+    bool setPattern(const SearchPattern &pattern);
+    inline bool isReady() const { return ready; }
+    inline int count() const { return matches.size(); }
+
+    Match nextMatch(int position) const;
+    Match previousMatch(int position) const;
+    Match nextCandidate(int position);
+    int ordinalOf(const Match &match) const;
+    void releaseSnapshot();
+
+signals:
+    void updated();
+
+private slots:
+    void on_contentsChange(int position, int charsRemoved, int charsAdded);
+    void on_scanFinished();
+
+private:
+    void startScan();
+    void startRefining();
+    void cancelScan();
+    const QString &currentText();
+
+    static QVector<Match> scan(SearchPattern pattern, QString text, QSharedPointer<QAtomicInt> cancelled);
+    static QVector<Match> refine(SearchPattern pattern, QString text, QVector<Match> candidates, QSharedPointer<QAtomicInt> cancelled);
+    static QVector<Match>::const_iterator firstMatchAtOrAfter(const QVector<Match> &matches, int position);
+
+    QTextDocument *document;
+    SearchPattern pattern;
+
+    QVector<Match> matches;
+    bool ready = false;
+    QFutureWatcher<QVector<Match>> scanWatcher;
+
+    // The old matches being refined, if any; dropped once the document changes
+    QVector<Match> candidates;
+    static const int maxCandidatesChecked = 4096;
+
+    // Edits are counted here rather than read from QTextDocument::revision, which isn't
+    // maintained while undo is disabled (see UndoHistory)
+    int edits = 0;
+    int scannedEdits = -1;
+    QString snapshot;
+    int snapshotEdits = -1;
+
+    // Set to stop the scan in progress; each scan gets its own, which it keeps alive
+    QSharedPointer<QAtomicInt> scanCancelled;
+};
+
+#endif // MATCHINDEX_H
@@ -0,0 +1,296 @@
+#include "metricstracker.h"
+#include "textcounter.h"
+#include <QtConcurrent>
+
+
+/* Detaches a block's data from its tracker's totals when Qt deletes the block.
+ */
+TextBlockData::~TextBlockData()
+{
+    if(tracker != nullptr)
+    {
+        tracker->discount(this);
+    }
+}
+
+
+/* Initializes this MetricsTracker and starts listening for edits to the given document.
+ * @param document - the document whose metrics should be tracked
+ */
+MetricsTracker::MetricsTracker(QTextDocument *document, QObject *parent) : QObject(parent)
+{
+    this->document = document;
+    pendingRange = QTextCursor(document);
+
+    debounceTimer.setSingleShot(true);
+    debounceTimer.setInterval(debounceInterval);
+
+    connect(document, SIGNAL(contentsChange(int,int,int)), this, SLOT(on_contentsChange(int,int,int)));
+    connect(&debounceTimer, SIGNAL(timeout()), this, SLOT(on_debounceTimeout()));
+    connect(&snapshotWatcher, SIGNAL(finished()), this, SLOT(on_snapshotCounted()));
+    recountAll();
+}
+
+
+/* Detaches all block data so that blocks outliving this tracker don't call back into it.
+ */
+MetricsTracker::~MetricsTracker()
+{
+    cancelSnapshotCount();
+
+    for(QTextBlock block = document->begin(); block.isValid(); block = block.next())
+    {
+        TextBlockData *data = TextBlockData::of(block);
+
+        if(data != nullptr)
+        {
+            data->tracker = nullptr;
+        }
+    }
+}
+
+
+/* Schedules every block in the document to be counted again from scratch.
+ */
+void MetricsTracker::recountAll()
+{
+    markPending(document->begin(), document->lastBlock());
+    debounceTimer.start();
+}
+
+
+/* Recounts a single block on the spot, replacing whatever it previously contributed to the totals.
+ */
+void MetricsTracker::countBlock(QTextBlock block)
+{
+    TextBlockData *data = TextBlockData::of(block);
+
+    if(data == nullptr)
+    {
+        data = new TextBlockData(this);
+        block.setUserData(data);
+    }
+
+    setCounts(data, block.length() - 1, TextCounter::count(block.text()).wordCount);
+}
+
+
+/* Replaces a block's cached counts and adds them to the document totals.
+ */
+void MetricsTracker::setCounts(TextBlockData *data, int chars, int words)
+{
+    discount(data);
+    data->charCount = chars;
+    data->wordCount = words;
+    data->counted = true;
+    charCount += chars;
+    wordCount += words;
+}
+
+
+/* Subtracts a block's cached counts from the document totals, if it was ever counted.
+ */
+void MetricsTracker::discount(const TextBlockData *data)
+{
+    if(data->counted)
+    {
+        charCount -= data->charCount;
+        wordCount -= data->wordCount;
+    }
+}
+
+
+/* Takes the blocks between first and last (inclusive) out of the totals and adds
+ * them to the range that will be counted in the background once edits settle down.
+ */
+void MetricsTracker::markPending(QTextBlock first, QTextBlock last)
+{
+    int start = first.position();
+    int end = last.position() + last.length() - 1;
+
+    for(QTextBlock block = first; block.isValid(); block = block.next())
+    {
+        TextBlockData *data = TextBlockData::of(block);
+
+        if(data == nullptr)
+        {
+            block.setUserData(new TextBlockData(this));
+        }
+        else
+        {
+            discount(data);
+            data->counted = false;
+        }
+
+        if(block == last)
+        {
+            break;
+        }
+    }
+
+    if(hasPendingBlocks)
+    {
+        start = qMin(start, pendingRange.selectionStart());
+        end = qMax(end, pendingRange.selectionEnd());
+    }
+
+    pendingRange.setPosition(start);
+    pendingRange.setPosition(end, QTextCursor::KeepAnchor);
+    hasPendingBlocks = true;
+}
+
+
+/* Tells the worker thread (if any) to abandon its snapshot because the document moved on.
+ */
+void MetricsTracker::cancelSnapshotCount()
+{
+    if(!snapshotCancelled.isNull())
+    {
+        snapshotCancelled->store(1);
+        snapshotCancelled.clear();
+    }
+}
+
+
+/* Runs on a worker thread. Counts each block of a snapshot, where blocks are separated
+ * by QChar::ParagraphSeparator as in QTextCursor::selectedText. Returns an empty vector
+ * if the count was cancelled along the way.
+ */
+QVector<MetricsTracker::BlockCounts> MetricsTracker::countSnapshot(QString text, QSharedPointer<QAtomicInt> cancelled)
+{
+    QVector<BlockCounts> counts;
+    const ushort *characters = text.utf16();
+    int start = 0;
+
+    while(true)
+    {
+        if(cancelled->load() != 0)
+        {
+            return QVector<BlockCounts>();
+        }
+
+        int end = text.indexOf(QChar::ParagraphSeparator, start);
+        if(end == -1)
+        {
+            end = text.length();
+        }
+
+        BlockCounts blockCounts;
+        blockCounts.charCount = end - start;
+        blockCounts.wordCount = TextCounter::count(characters + start, end - start).wordCount;
+        counts.append(blockCounts);
+
+        if(end == text.length())
+        {
+            return counts;
+        }
+
+        start = end + 1;
+    }
+}
+
+
+/* Called whenever the document's contents change. Blocks that were removed have already
+ * discounted themselves, so only the blocks now covering the edited range need recounting.
+ * Any snapshot still being counted in the background is stale at this point.
+ */
+void MetricsTracker::on_contentsChange(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved);
+
+    cancelSnapshotCount();
+
+    QTextBlock block = document->findBlock(position);
+    QTextBlock lastBlock = document->findBlock(position + charsAdded);
+
+    if(!lastBlock.isValid())
+    {
+        lastBlock = document->lastBlock();
+    }
+
+    if(charsAdded > synchronousCharLimit)
+    {
+        markPending(block, lastBlock);
+    }
+    else
+    {
+        while(block.isValid())
+        {
+            countBlock(block);
+
+            if(block == lastBlock)
+            {
+                break;
+            }
+
+            block = block.next();
+        }
+    }
+
+    debounceTimer.start();
+}
+
+
+/* Called once edits have settled down. Reports the totals if they are complete; otherwise,
+ * hands a snapshot of the pending blocks to a worker thread and reports when it's done.
+ */
+void MetricsTracker::on_debounceTimeout()
+{
+    if(!hasPendingBlocks)
+    {
+        emit(metricsChanged());
+        return;
+    }
+
+    QTextBlock first = document->findBlock(pendingRange.selectionStart());
+    QTextBlock last = document->findBlock(pendingRange.selectionEnd());
+
+    if(!last.isValid())
+    {
+        last = document->lastBlock();
+    }
+
+    // A single copy of the pending text; it's split back into blocks on the worker thread
+    QTextCursor snapshotRange(document);
+    snapshotRange.setPosition(first.position());
+    snapshotRange.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+
+    snapshotFirstBlock = first.blockNumber();
+    snapshotRevision = document->revision();
+    snapshotCancelled = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+    snapshotWatcher.setFuture(QtConcurrent::run(&MetricsTracker::countSnapshot, snapshotRange.selectedText(), snapshotCancelled));
+}
+
+
+/* Called on the UI thread when a worker finishes counting a snapshot. Applies the counts
+ * unless the document was edited in the meantime, in which case a newer count is already
+ * scheduled and this result is simply dropped.
+ */
+void MetricsTracker::on_snapshotCounted()
+{
+    QVector<BlockCounts> counts = snapshotWatcher.result();
+
+    if(counts.isEmpty() || document->revision() != snapshotRevision)
+    {
+        return;
+    }
+
+    QTextBlock block = document->findBlockByNumber(snapshotFirstBlock);
+
+    for(int i = 0; i < counts.size() && block.isValid(); i++, block = block.next())
+    {
+        TextBlockData *data = TextBlockData::of(block);
+
+        if(data == nullptr)
+        {
+            data = new TextBlockData(this);
+            block.setUserData(data);
+        }
+
+        setCounts(data, counts[i].charCount, counts[i].wordCount);
+    }
+
+    snapshotCancelled.clear();
+    hasPendingBlocks = false;
+    emit(metricsChanged());
+}
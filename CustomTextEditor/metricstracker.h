@@ -0,0 +1,80 @@
+#ifndef METRICSTRACKER_H
+#define METRICSTRACKER_H
+#include "textblockdata.h"
+#include <QObject>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QString>
+#include <QVector>
+
+
+/* Keeps a document's character and word counts up to date incrementally. Each block
+ * caches its own counts in its TextBlockData, so an edit only rescans the blocks it
+ * touched. Since a newline always ends a word, no word can span two blocks and the
+ * document totals are simply the sums of the per-block counts.
+ *
+ * Small edits are counted on the spot. Large ones (opening a file, big pastes) mark
+ * their blocks as pending, and those blocks are counted on a worker thread from a
+ * snapshot of their text. Either way, metricsChanged is debounced so that a burst of
+ * edits is reported once, and only after every pending block has been counted.
+ */
+class MetricsTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    MetricsTracker(QTextDocument *document, QObject *parent = nullptr);
+    ~MetricsTracker() override;
+
+    inline int getCharCount() const { return charCount; }
+    inline int getWordCount() const { return wordCount; }
+    void recountAll();
+
+signals:
+    void metricsChanged();
+
+private slots:
+    void on_contentsChange(int position, int charsRemoved, int charsAdded);
+    void on_debounceTimeout();
+    void on_snapshotCounted();
+
+private:
+    friend class TextBlockData;
+
+    struct BlockCounts
+    {
+        int charCount;
+        int wordCount;
+    };
+
+    static QVector<BlockCounts> countSnapshot(QString text, QSharedPointer<QAtomicInt> cancelled);
+
+    void countBlock(QTextBlock block);
+    void setCounts(TextBlockData *data, int chars, int words);
+    void discount(const TextBlockData *data);
+    void markPending(QTextBlock first, QTextBlock last);
+    void cancelSnapshotCount();
+
+    QTextDocument *document;
+    int charCount = 0;
+    int wordCount = 0;
+
+    // The blocks spanned by this cursor's selection still need to be counted
+    QTextCursor pendingRange;
+    bool hasPendingBlocks = false;
+
+    QTimer debounceTimer;
+    QFutureWatcher<QVector<BlockCounts>> snapshotWatcher;
+    QSharedPointer<QAtomicInt> snapshotCancelled;
+    int snapshotFirstBlock = 0;
+    int snapshotRevision = -1;
+
+    static const int synchronousCharLimit = 1 << 16;
+    static const int debounceInterval = 100;
+};
+
+#endif // METRICSTRACKER_H
@@ -0,0 +1,205 @@
+#include "multipatternsearcher.h"
+#include <algorithm>
+
+
+/* Builds the automaton for the given patterns. Empty patterns never match; a pattern
+ * that appears twice only has its first copy matched.
+ * @param patterns - the literal patterns to search for
+ * @param sensitivity - whether the search should heed the case of results
+ */
+MultiPatternSearcher::MultiPatternSearcher(const QStringList &patterns, Qt::CaseSensitivity sensitivity)
+    : sensitivity(sensitivity), asciiClasses(128, 0)
+{
+    for(const QString &pattern : patterns)
+    {
+        for(QChar character : pattern)
+        {
+            if(classOf(character.unicode()) == 0)
+            {
+                addClass(fold(character.unicode()));
+            }
+        }
+    }
+
+    // Build the trie of the patterns, starting from the root (state 0)
+    transitions.fill(-1, classCount);
+    patternEndingAt.append(-1);
+
+    for(int i = 0; i < patterns.size(); i++)
+    {
+        const QString &pattern = patterns.at(i);
+        patternLengths.append(pattern.length());
+
+        if(pattern.isEmpty())
+        {
+            continue;
+        }
+
+        int state = 0;
+        for(QChar character : pattern)
+        {
+            int index = state * classCount + classOf(character.unicode());
+            if(transitions.at(index) < 0)
+            {
+                transitions[index] = patternEndingAt.size();
+                transitions += QVector<int>(classCount, -1);
+                patternEndingAt.append(-1);
+            }
+            state = transitions.at(index);
+        }
+
+        if(patternEndingAt.at(state) < 0)
+        {
+            patternEndingAt[state] = i;
+        }
+    }
+
+    // Fill in the missing transitions and the output links breadth-first, so that every state's
+    // failure state (which is shallower) is complete by the time the state itself is visited
+    const int stateCount = patternEndingAt.size();
+    QVector<int> failureLinks(stateCount, 0);
+    QVector<int> queue;
+    queue.reserve(stateCount);
+    outputLinks.fill(0, stateCount);
+
+    for(int c = 0; c < classCount; c++)
+    {
+        if(transitions.at(c) < 0)
+        {
+            transitions[c] = 0;
+        }
+        else
+        {
+            queue.append(transitions.at(c));
+        }
+    }
+
+    for(int i = 0; i < queue.size(); i++)
+    {
+        const int state = queue.at(i);
+        const int failure = failureLinks.at(state);
+
+        for(int c = 0; c < classCount; c++)
+        {
+            const int index = state * classCount + c;
+            const int next = transitions.at(index);
+            const int fallback = transitions.at(failure * classCount + c);
+
+            if(next < 0)
+            {
+                transitions[index] = fallback;
+                continue;
+            }
+
+            failureLinks[next] = fallback;
+            outputLinks[next] = patternEndingAt.at(fallback) >= 0 ? fallback : outputLinks.at(fallback);
+            queue.append(next);
+        }
+    }
+}
+
+
+/* Returns every occurrence of every pattern in the given text, ordered by position.
+ * Occurrences of different patterns may overlap; like a search for each pattern on its
+ * own, an occurrence that overlaps an earlier one of the same pattern is skipped. Safe
+ * to call from any thread.
+ * @param text - the text to search
+ * @param cancelled - if given, a flag another thread may set to stop the search early
+ */
+QVector<MultiPatternSearcher::Match> MultiPatternSearcher::findAll(const QString &text, const QAtomicInt *cancelled) const
+{
+    QVector<Match> matches;
+
+    if(patternEndingAt.size() <= 1)
+    {
+        return matches;
+    }
+
+    QVector<int> previousEnds(patternLengths.size(), 0);
+    const ushort *characters = text.utf16();
+    const int *table = transitions.constData();
+    const int length = text.length();
+    int state = 0;
+
+    for(int i = 0; i < length; i++)
+    {
+        if((i & 0xFFFF) == 0 && cancelled != nullptr && cancelled->load() != 0)
+        {
+            break;
+        }
+
+        state = table[state * classCount + classOf(characters[i])];
+
+        int output = patternEndingAt.at(state) >= 0 ? state : outputLinks.at(state);
+        for(; output != 0; output = outputLinks.at(output))
+        {
+            const int pattern = patternEndingAt.at(output);
+            const int position = i + 1 - patternLengths.at(pattern);
+
+            if(position >= previousEnds.at(pattern))
+            {
+                matches.append({position, patternLengths.at(pattern), pattern});
+                previousEnds[pattern] = i + 1;
+            }
+        }
+    }
+
+    // Occurrences were found by where they end
+    std::stable_sort(matches.begin(), matches.end(), [](const Match &a, const Match &b) { return a.position < b.position; });
+    return matches;
+}
+
+
+/* Returns the given UTF-16 code unit as the automaton sees it: unchanged for a case
+ * sensitive search, case-folded otherwise.
+ */
+ushort MultiPatternSearcher::fold(ushort character) const
+{
+    if(sensitivity == Qt::CaseSensitive)
+    {
+        return character;
+    }
+    if(character < 0x80)
+    {
+        return (character >= 'A' && character <= 'Z') ? character | 0x20 : character;
+    }
+    return QChar(character).toCaseFolded().unicode();
+}
+
+
+/* Returns the class of the given character, or 0 if no pattern contains it.
+ */
+int MultiPatternSearcher::classOf(ushort character) const
+{
+    if(character >= 0x80)
+    {
+        character = fold(character);
+        if(character >= 0x80)
+        {
+            return otherClasses.value(character, 0);
+        }
+    }
+    return asciiClasses.at(character);
+}
+
+
+/* Gives the given (folded) character a class of its own, along with its uppercase form
+ * for an ASCII letter in a case-insensitive search. Returns the new class.
+ */
+int MultiPatternSearcher::addClass(ushort character)
+{
+    const int newClass = classCount++;
+
+    if(character >= 0x80)
+    {
+        otherClasses.insert(character, newClass);
+        return newClass;
+    }
+
+    asciiClasses[character] = newClass;
+    if(sensitivity == Qt::CaseInsensitive && character >= 'a' && character <= 'z')
+    {
+        asciiClasses[character & ~0x20] = newClass;
+    }
+    return newClass;
+}
@@ -0,0 +1,55 @@
+#ifndef MULTIPATTERNSEARCHER_H
+#define MULTIPATTERNSEARCHER_H
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QAtomicInt>
+
+
+/* Finds any number of literal patterns in one pass over a text, with an Aho-Corasick
+ * automaton. Every character that appears in some pattern gets a class of its own, and
+ * all other characters share class 0; the automaton is then built as a complete table
+ * of transitions (one row of classes per state), so each character of the text costs
+ * one class lookup and one table lookup however many patterns there are.
+ *
+ * Case-insensitive searches fold both the patterns and the text, one UTF-16 code unit
+ * at a time.
+ */
+class MultiPatternSearcher
+{
+public:
+    struct Match
+    {
+        int position;
+        int length;
+        int pattern;
+    };
+
+    MultiPatternSearcher(const QStringList &patterns, Qt::CaseSensitivity sensitivity);
+
+    QVector<Match> findAll(const QString &text, const QAtomicInt *cancelled = nullptr) const;
+    inline int patternCount() const { return patternLengths.size(); }
+
+private:
+    ushort fold(ushort character) const;
+    int classOf(ushort character) const;
+    int addClass(ushort character);
+
+    Qt::CaseSensitivity sensitivity;
+    QVector<int> patternLengths;
+
+    // Character classes: a table for ASCII, and a hash for everything else
+    QVector<int> asciiClasses;
+    QHash<ushort, int> otherClasses;
+    int classCount = 1;
+
+    // Row-major: the state reached from state s on class c is transitions[s * classCount + c]
+    QVector<int> transitions;
+
+    // The pattern that ends at each state (or -1), and the nearest state down the failure links at which one does (or 0)
+    QVector<int> patternEndingAt;
+    QVector<int> outputLinks;
+};
+
+#endif // MULTIPATTERNSEARCHER_H
@@ -0,0 +1,827 @@
+#include "piecetable.h"
+#include "fileloader.h"
+#include "textcounter.h"
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+
+namespace
+{
+    inline char asciiLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    // Bytes of multi-byte UTF-8 sequences count as word characters, since they're almost always letters
+    inline bool isWordByte(char c)
+    {
+        uchar byte = static_cast<uchar>(c);
+        return byte >= 0x80 || byte == '_' || (byte >= '0' && byte <= '9') || (asciiLower(c) >= 'a' && asciiLower(c) <= 'z');
+    }
+
+    inline bool isContinuationByte(char c)
+    {
+        return (static_cast<uchar>(c) & 0xC0) == 0x80;
+    }
+
+    // The QChars a byte of valid UTF-8 adds: none for continuation bytes and carriage
+    // returns, two (a surrogate pair) for the lead byte of a four-byte sequence
+    inline int utf16Units(char c)
+    {
+        uchar byte = static_cast<uchar>(c);
+        if(isContinuationByte(c) || byte == '\r')
+        {
+            return 0;
+        }
+        return byte >= 0xF0 ? 2 : 1;
+    }
+
+    qint64 utf16Length(const char *data, qint64 length)
+    {
+        qint64 units = 0;
+        for(qint64 i = 0; i < length; i++)
+        {
+            units += utf16Units(data[i]);
+        }
+        return units;
+    }
+}
+
+
+/* Creates an empty piece table. Call open to load a file into it, or insert text directly.
+ */
+PieceTable::PieceTable()
+{
+    buffers[originalBuffer].index(0);
+    buffers[addedBuffer].index(0);
+}
+
+
+/* Unmaps the original file.
+ */
+PieceTable::~PieceTable()
+{
+    close();
+}
+
+
+/* Releases the original file and everything that was added, leaving the table empty.
+ */
+void PieceTable::close()
+{
+    if(mappedFile != nullptr)
+    {
+        file.unmap(mappedFile);
+        mappedFile = nullptr;
+    }
+    file.close();
+
+    originalCopy.clear();
+    added.clear();
+    buffers[originalBuffer] = Buffer();
+    buffers[addedBuffer] = Buffer();
+    buffers[originalBuffer].index(0);
+    buffers[addedBuffer].index(0);
+    pieces.clear();
+    totalSize = 0;
+    prefixSumsDirty = true;
+}
+
+
+/* Replaces the table's contents with the file at the given path, which is mapped rather
+ * than read. Files that can't be mapped (e.g., ones larger than a 32-bit build's address
+ * space allows) are read into memory instead. Returns false and describes the problem in
+ * errorString if the file can't be opened.
+ */
+bool PieceTable::open(const QString &filePath, QString *errorString)
+{
+    close();
+    file.setFileName(filePath);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        *errorString = file.errorString();
+        return false;
+    }
+
+    Buffer &original = buffers[originalBuffer];
+    original.size = file.size();
+
+    if(original.size > 0)
+    {
+        mappedFile = file.map(0, original.size);
+
+        if(mappedFile != nullptr)
+        {
+            original.data = reinterpret_cast<const char*>(mappedFile);
+        }
+        else
+        {
+            originalCopy = file.readAll();
+            original.data = originalCopy.constData();
+            original.size = originalCopy.size();
+        }
+    }
+    original.index(0);
+
+    qint64 start = (original.size >= 3 && memcmp(original.data, "\xEF\xBB\xBF", 3) == 0) ? 3 : 0;
+    if(original.size > start)
+    {
+        pieces.append(makePiece(originalBuffer, start, original.size - start));
+    }
+
+    totalSize = original.size - start;
+    prefixSumsDirty = true;
+    return true;
+}
+
+
+/* Indexes the line breaks from the given offset to the end of the buffer, and the
+ * characters in every whole stride of bytes not yet counted. Used once for the original
+ * buffer and after each append to the added buffer.
+ */
+void PieceTable::Buffer::index(qint64 from)
+{
+    if(lineCheckpoints.isEmpty())
+    {
+        lineCheckpoints.append(0);
+        characterCheckpoints.append(0);
+    }
+
+    const char *position = data + from;
+    const char *end = data + size;
+    const char *newline;
+
+    while(position < end && (newline = static_cast<const char*>(memchr(position, '\n', static_cast<size_t>(end - position)))) != nullptr)
+    {
+        position = newline + 1;
+        newlineCount++;
+
+        if(newlineCount % lineCheckpointStride == 0)
+        {
+            lineCheckpoints.append(position - data);
+        }
+    }
+
+    qint64 characters = characterCheckpoints.last();
+    for(qint64 offset = qint64(characterCheckpoints.size() - 1) * characterCheckpointStride; offset + characterCheckpointStride <= size; offset += characterCheckpointStride)
+    {
+        characters += utf16Length(data + offset, characterCheckpointStride);
+        characterCheckpoints.append(characters);
+    }
+}
+
+
+/* Returns the number of line breaks in this buffer before the given offset.
+ */
+qint64 PieceTable::Buffer::newlinesBefore(qint64 offset) const
+{
+    int checkpoint = static_cast<int>(std::upper_bound(lineCheckpoints.constBegin(), lineCheckpoints.constEnd(), offset) - lineCheckpoints.constBegin()) - 1;
+    qint64 count = qint64(checkpoint) * lineCheckpointStride;
+
+    const char *position = data + lineCheckpoints.at(checkpoint);
+    const char *end = data + offset;
+    const char *newline;
+
+    while(position < end && (newline = static_cast<const char*>(memchr(position, '\n', static_cast<size_t>(end - position)))) != nullptr)
+    {
+        position = newline + 1;
+        count++;
+    }
+
+    return count;
+}
+
+
+/* Returns the offset just after the given (one-based) line break in this buffer, or
+ * the start of the buffer for zero.
+ */
+qint64 PieceTable::Buffer::offsetAfterNewline(qint64 newline) const
+{
+    int checkpoint = static_cast<int>(qMin<qint64>(newline / lineCheckpointStride, lineCheckpoints.size() - 1));
+    qint64 remaining = newline - qint64(checkpoint) * lineCheckpointStride;
+
+    const char *position = data + lineCheckpoints.at(checkpoint);
+    const char *end = data + size;
+
+    while(remaining > 0 && position < end)
+    {
+        const char *found = static_cast<const char*>(memchr(position, '\n', static_cast<size_t>(end - position)));
+        if(found == nullptr)
+        {
+            return size;
+        }
+        position = found + 1;
+        remaining--;
+    }
+
+    return position - data;
+}
+
+
+/* Returns the number of QChars in this buffer before the given offset.
+ */
+qint64 PieceTable::Buffer::charactersBefore(qint64 offset) const
+{
+    int checkpoint = static_cast<int>(qMin<qint64>(offset / characterCheckpointStride, characterCheckpoints.size() - 1));
+    qint64 checkpointOffset = qint64(checkpoint) * characterCheckpointStride;
+    return characterCheckpoints.at(checkpoint) + utf16Length(data + checkpointOffset, offset - checkpointOffset);
+}
+
+
+/* Returns the first offset in this buffer with the given number of QChars before it,
+ * moved past the rest of the code point it lands in. Carriage returns right before it
+ * are not skipped, so that the offset of a line break is that of its "\r\n".
+ */
+qint64 PieceTable::Buffer::offsetOfCharacter(qint64 character) const
+{
+    int checkpoint = qMax(0, static_cast<int>(std::lower_bound(characterCheckpoints.constBegin(), characterCheckpoints.constEnd(), character) - characterCheckpoints.constBegin()) - 1);
+    qint64 offset = qint64(checkpoint) * characterCheckpointStride;
+    qint64 count = characterCheckpoints.at(checkpoint);
+
+    while(count < character && offset < size)
+    {
+        count += utf16Units(data[offset++]);
+    }
+
+    while(offset < size && isContinuationByte(data[offset]))
+    {
+        offset++;
+    }
+
+    return offset;
+}
+
+
+/* Returns a piece spanning the given range of the given buffer.
+ */
+PieceTable::Piece PieceTable::makePiece(int buffer, qint64 start, qint64 length) const
+{
+    const Buffer &source = buffers[buffer];
+    Piece piece = {buffer, start, length, source.newlinesBefore(start + length) - source.newlinesBefore(start),
+                   source.charactersBefore(start + length) - source.charactersBefore(start)};
+    return piece;
+}
+
+
+/* Rebuilds the start offset and line of each piece if the table was edited since.
+ */
+void PieceTable::updatePrefixSums() const
+{
+    if(!prefixSumsDirty)
+    {
+        return;
+    }
+
+    pieceStarts.resize(pieces.size());
+    pieceLineStarts.resize(pieces.size());
+    pieceCharacterStarts.resize(pieces.size());
+    qint64 offset = 0;
+    qint64 newlines = 0;
+    qint64 characters = 0;
+
+    for(int i = 0; i < pieces.size(); i++)
+    {
+        pieceStarts[i] = offset;
+        pieceLineStarts[i] = newlines;
+        pieceCharacterStarts[i] = characters;
+        offset += pieces.at(i).length;
+        newlines += pieces.at(i).newlines;
+        characters += pieces.at(i).characters;
+    }
+
+    prefixSumsDirty = false;
+}
+
+
+/* Returns the index of the piece holding the given position, or of the last piece if
+ * the position is the end of the document. Returns -1 if the table is empty.
+ */
+int PieceTable::pieceAt(qint64 position) const
+{
+    updatePrefixSums();
+    int piece = static_cast<int>(std::upper_bound(pieceStarts.constBegin(), pieceStarts.constEnd(), position) - pieceStarts.constBegin()) - 1;
+    return qMin(piece, pieces.size() - 1);
+}
+
+
+/* Inserts the given text at the given position. Typing (inserting right after the
+ * previous insertion) grows the last piece instead of adding a new one. Does nothing if
+ * the position is inside a multi-byte sequence.
+ */
+void PieceTable::insert(qint64 position, const QString &text)
+{
+    if(text.isEmpty() || position < 0 || position > totalSize || !isCodePointBoundary(position))
+    {
+        return;
+    }
+
+    QByteArray utf8 = text.toUtf8();
+    qint64 addedStart = added.size();
+    added.append(utf8);
+
+    Buffer &buffer = buffers[addedBuffer];
+    buffer.data = added.constData();
+    buffer.size = added.size();
+    buffer.index(addedStart);
+
+    int piece = pieceAt(position);
+    int previous = (piece >= 0 && position == pieceStarts.at(piece)) ? piece - 1 : piece;
+
+    if(previous >= 0 && pieceStarts.at(previous) + pieces.at(previous).length == position &&
+       pieces.at(previous).buffer == addedBuffer && pieces.at(previous).start + pieces.at(previous).length == addedStart)
+    {
+        Piece &grown = pieces[previous];
+        grown = makePiece(addedBuffer, grown.start, grown.length + utf8.size());
+    }
+    else
+    {
+        Piece inserted = makePiece(addedBuffer, addedStart, utf8.size());
+
+        if(piece < 0 || position == totalSize)
+        {
+            pieces.append(inserted);
+        }
+        else if(position == pieceStarts.at(piece))
+        {
+            pieces.insert(piece, inserted);
+        }
+        else
+        {
+            // Split the piece around the insertion
+            Piece split = pieces.at(piece);
+            qint64 offset = position - pieceStarts.at(piece);
+            pieces[piece] = makePiece(split.buffer, split.start, offset);
+            pieces.insert(piece + 1, inserted);
+            pieces.insert(piece + 2, makePiece(split.buffer, split.start + offset, split.length - offset));
+        }
+    }
+
+    totalSize += utf8.size();
+    prefixSumsDirty = true;
+}
+
+
+/* Removes the given number of bytes starting at the given position. Pieces that are
+ * only partly removed are trimmed; pieces in between are dropped. Does nothing if
+ * either end of the range is inside a multi-byte sequence.
+ */
+void PieceTable::remove(qint64 position, qint64 length)
+{
+    length = qMin(length, totalSize - position);
+    if(length <= 0 || position < 0 || !isCodePointBoundary(position) || !isCodePointBoundary(position + length))
+    {
+        return;
+    }
+
+    int first = pieceAt(position);
+    int last = first;
+    qint64 end = position + length;
+
+    while(last < pieces.size() && pieceStarts.at(last) < end)
+    {
+        last++;
+    }
+
+    // What's left of the first and last pieces
+    QVector<Piece> remaining;
+    for(int i = first; i < last; i++)
+    {
+        const Piece &piece = pieces.at(i);
+        qint64 pieceStart = pieceStarts.at(i);
+        qint64 pieceEnd = pieceStart + piece.length;
+
+        if(pieceStart < position)
+        {
+            remaining.append(makePiece(piece.buffer, piece.start, position - pieceStart));
+        }
+        if(pieceEnd > end)
+        {
+            remaining.append(makePiece(piece.buffer, piece.start + (end - pieceStart), pieceEnd - end));
+        }
+    }
+
+    pieces.remove(first, last - first);
+    for(int i = 0; i < remaining.size(); i++)
+    {
+        pieces.insert(first + i, remaining.at(i));
+    }
+
+    totalSize -= length;
+    prefixSumsDirty = true;
+}
+
+
+/* Returns the byte at the given position.
+ */
+char PieceTable::byteAt(qint64 position) const
+{
+    int piece = pieceAt(position);
+    const Piece &holder = pieces.at(piece);
+    return buffers[holder.buffer].data[holder.start + position - pieceStarts.at(piece)];
+}
+
+
+/* Returns a copy of the bytes in the given range.
+ */
+QByteArray PieceTable::bytes(qint64 position, qint64 length) const
+{
+    QByteArray result;
+    length = qMin(length, totalSize - position);
+    if(length <= 0)
+    {
+        return result;
+    }
+
+    for(int i = pieceAt(position); i < pieces.size() && result.size() < length; i++)
+    {
+        const Piece &piece = pieces.at(i);
+        qint64 offset = qMax<qint64>(0, position - pieceStarts.at(i));
+        qint64 count = qMin(piece.length - offset, length - result.size());
+        result.append(buffers[piece.buffer].data + piece.start + offset, static_cast<int>(count));
+    }
+
+    return result;
+}
+
+
+/* Returns the text in the given range, which should start and end on character boundaries.
+ */
+QString PieceTable::text(qint64 position, qint64 length) const
+{
+    return QString::fromUtf8(bytes(position, length)).remove(QLatin1Char('\r'));
+}
+
+
+/* Returns the number of lines in the document.
+ */
+int PieceTable::lineCount() const
+{
+    if(pieces.isEmpty())
+    {
+        return 1;
+    }
+
+    updatePrefixSums();
+    return static_cast<int>(pieceLineStarts.last() + pieces.last().newlines + 1);
+}
+
+
+/* Returns the position at which the given (zero-based) line starts.
+ */
+qint64 PieceTable::lineStart(int line) const
+{
+    if(line <= 0 || pieces.isEmpty())
+    {
+        return 0;
+    }
+    if(line >= lineCount())
+    {
+        return totalSize;
+    }
+
+    // The piece holding the line break that ends the line before
+    int piece = static_cast<int>(std::lower_bound(pieceLineStarts.constBegin(), pieceLineStarts.constEnd(), qint64(line)) - pieceLineStarts.constBegin()) - 1;
+    const Piece &holder = pieces.at(piece);
+    const Buffer &buffer = buffers[holder.buffer];
+
+    qint64 newline = buffer.newlinesBefore(holder.start) + (line - pieceLineStarts.at(piece));
+    return pieceStarts.at(piece) + buffer.offsetAfterNewline(newline) - holder.start;
+}
+
+
+/* Returns the (zero-based) line the given position is on.
+ */
+int PieceTable::lineOf(qint64 position) const
+{
+    int piece = pieceAt(position);
+    if(piece < 0)
+    {
+        return 0;
+    }
+
+    const Piece &holder = pieces.at(piece);
+    const Buffer &buffer = buffers[holder.buffer];
+    qint64 offset = qMin(position - pieceStarts.at(piece), holder.length);
+    return static_cast<int>(pieceLineStarts.at(piece) + buffer.newlinesBefore(holder.start + offset) - buffer.newlinesBefore(holder.start));
+}
+
+
+/* Returns the position of the first match at or after the given one, or -1 if there
+ * is none. Each piece is searched in place; only the few bytes around the seams between
+ * pieces are copied, to find matches that straddle them. Case-insensitive matching only
+ * folds ASCII letters.
+ * @param query - the text to search for
+ * @param from - the position to start searching at
+ * @param caseSensitive - flag denoting whether the search should heed the case of results
+ * @param wholeWords - flag denoting whether the search should look for whole word matches or partials
+ */
+qint64 PieceTable::find(const QString &query, qint64 from, bool caseSensitive, bool wholeWords) const
+{
+    QByteArray needle = query.toUtf8();
+    const qint64 needleLength = needle.size();
+
+    if(needle.isEmpty() || from < 0 || from + needleLength > totalSize)
+    {
+        return -1;
+    }
+
+    if(!caseSensitive)
+    {
+        for(int i = 0; i < needle.size(); i++)
+        {
+            needle[i] = asciiLower(needle.at(i));
+        }
+    }
+
+    for(int i = pieceAt(from); i < pieces.size(); i++)
+    {
+        const Piece &piece = pieces.at(i);
+        const char *data = buffers[piece.buffer].data + piece.start;
+        qint64 pieceStart = pieceStarts.at(i);
+        qint64 localFrom = qMax<qint64>(0, from - pieceStart);
+
+        // Matches that lie within this piece
+        qint64 hit = localFrom;
+        while((hit = indexIn(data, piece.length, hit, needle, caseSensitive)) >= 0)
+        {
+            if(!wholeWords || isWholeWord(pieceStart + hit, needleLength))
+            {
+                return pieceStart + hit;
+            }
+            hit++;
+        }
+
+        // Matches that start in this piece and run on into the next ones
+        qint64 seamStart = qMax(localFrom, piece.length - needleLength + 1);
+        if(seamStart < piece.length && pieceStart + piece.length < totalSize)
+        {
+            QByteArray seam = bytes(pieceStart + seamStart, piece.length - seamStart + needleLength - 1);
+            hit = 0;
+
+            while((hit = indexIn(seam.constData(), seam.size(), hit, needle, caseSensitive)) >= 0 && seamStart + hit < piece.length)
+            {
+                if(!wholeWords || isWholeWord(pieceStart + seamStart + hit, needleLength))
+                {
+                    return pieceStart + seamStart + hit;
+                }
+                hit++;
+            }
+        }
+    }
+
+    return -1;
+}
+
+
+/* Returns the offset of the first occurrence of needle in haystack at or after from,
+ * or -1. For case-insensitive searches, needle must already be in lowercase.
+ */
+qint64 PieceTable::indexIn(const char *haystack, qint64 length, qint64 from, const QByteArray &needle, bool caseSensitive)
+{
+    const qint64 needleLength = needle.size();
+    const char first = needle.at(0);
+
+    for(qint64 position = from; position + needleLength <= length; position++)
+    {
+        if(caseSensitive)
+        {
+            const char *candidate = static_cast<const char*>(memchr(haystack + position, first, static_cast<size_t>(length - needleLength + 1 - position)));
+            if(candidate == nullptr)
+            {
+                return -1;
+            }
+
+            position = candidate - haystack;
+            if(memcmp(candidate, needle.constData(), static_cast<size_t>(needleLength)) == 0)
+            {
+                return position;
+            }
+        }
+        else
+        {
+            qint64 matched = 0;
+            while(matched < needleLength && asciiLower(haystack[position + matched]) == needle.at(static_cast<int>(matched)))
+            {
+                matched++;
+            }
+
+            if(matched == needleLength)
+            {
+                return position;
+            }
+        }
+    }
+
+    return -1;
+}
+
+
+/* Returns true if the given range is neither preceded nor followed by a word character.
+ */
+bool PieceTable::isWholeWord(qint64 position, qint64 length) const
+{
+    bool startsWord = position == 0 || !isWordByte(byteAt(position - 1));
+    bool endsWord = position + length == totalSize || !isWordByte(byteAt(position + length));
+    return startsWord && endsWord;
+}
+
+
+/* Returns true unless the given position is between the bytes of a multi-byte sequence.
+ */
+bool PieceTable::isCodePointBoundary(qint64 position) const
+{
+    return position <= 0 || position >= totalSize || !isContinuationByte(byteAt(position));
+}
+
+
+/* Counts the document's characters, words and lines with TextCounter. The text is decoded
+ * a chunk at a time and each chunk is cut at its last line break, since no word can
+ * span a line break and the counts of the pieces can simply be added up.
+ */
+DocumentMetrics PieceTable::metrics() const
+{
+    DocumentMetrics metrics;
+    TextChunkDecoder decoder;
+    QString pending;
+    qint64 newlines = 0;
+
+    for(int i = 0; i <= pieces.size(); i++)
+    {
+        bool done = (i == pieces.size());
+
+        if(!done)
+        {
+            const Piece &piece = pieces.at(i);
+            for(qint64 offset = 0; offset < piece.length; offset += metricsChunkSize)
+            {
+                int length = static_cast<int>(qMin<qint64>(metricsChunkSize, piece.length - offset));
+                pending += decoder.decode(buffers[piece.buffer].data + piece.start + offset, length);
+            }
+        }
+
+        int cut = done ? pending.size() : pending.lastIndexOf(QLatin1Char('\n')) + 1;
+        if(cut > 0 && (done || pending.size() >= metricsChunkSize))
+        {
+            DocumentMetrics counts = TextCounter::count(reinterpret_cast<const ushort*>(pending.constData()), cut);
+            metrics.charCount += counts.charCount;
+            metrics.wordCount += counts.wordCount;
+            newlines += counts.lineCount - 1;
+            pending.remove(0, cut);
+        }
+    }
+
+    metrics.lineCount = static_cast<int>(newlines + 1);
+    return metrics;
+}
+
+
+/* Returns the number of QChars in the document.
+ */
+qint64 PieceTable::characterCount() const
+{
+    if(pieces.isEmpty())
+    {
+        return 0;
+    }
+
+    updatePrefixSums();
+    return pieceCharacterStarts.last() + pieces.last().characters;
+}
+
+
+/* Returns the QChar position of the given byte position.
+ */
+qint64 PieceTable::characterPosition(qint64 position) const
+{
+    int piece = pieceAt(position);
+    if(piece < 0)
+    {
+        return 0;
+    }
+
+    const Piece &holder = pieces.at(piece);
+    const Buffer &buffer = buffers[holder.buffer];
+    qint64 offset = qBound<qint64>(0, position - pieceStarts.at(piece), holder.length);
+    return pieceCharacterStarts.at(piece) + buffer.charactersBefore(holder.start + offset) - buffer.charactersBefore(holder.start);
+}
+
+
+/* Returns the byte position of the given QChar position. A position between the two
+ * halves of a surrogate pair is moved past the pair.
+ */
+qint64 PieceTable::bytePosition(qint64 characterPosition) const
+{
+    if(characterPosition <= 0 || pieces.isEmpty())
+    {
+        return 0;
+    }
+    if(characterPosition >= characterCount())
+    {
+        return totalSize;
+    }
+
+    // The last piece starting before the character, so that the end of one piece comes before a "\r" starting the next
+    int piece = static_cast<int>(std::lower_bound(pieceCharacterStarts.constBegin(), pieceCharacterStarts.constEnd(), characterPosition) - pieceCharacterStarts.constBegin()) - 1;
+    const Piece &holder = pieces.at(piece);
+    const Buffer &buffer = buffers[holder.buffer];
+
+    qint64 character = buffer.charactersBefore(holder.start) + qMin(characterPosition - pieceCharacterStarts.at(piece), holder.characters);
+    return pieceStarts.at(piece) + qMin(buffer.offsetOfCharacter(character) - holder.start, holder.length);
+}
+
+
+/* Inserts the given text at the given QChar position.
+ */
+void PieceTable::insertCharacters(qint64 characterPosition, const QString &text)
+{
+    insert(bytePosition(characterPosition), text);
+}
+
+
+/* Removes the given number of QChars starting at the given QChar position.
+ */
+void PieceTable::removeCharacters(qint64 characterPosition, qint64 count)
+{
+    qint64 start = bytePosition(characterPosition);
+    remove(start, bytePosition(characterPosition + count) - start);
+}
+
+
+/* Returns the QChar at the given QChar position, or a null QChar past the end.
+ */
+QChar PieceTable::characterAt(qint64 characterPosition) const
+{
+    QString character = characters(characterPosition, 1);
+    return character.isEmpty() ? QChar() : character.at(0);
+}
+
+
+/* Returns the given number of QChars starting at the given QChar position.
+ */
+QString PieceTable::characters(qint64 characterPosition, qint64 count) const
+{
+    qint64 start = bytePosition(characterPosition);
+    return text(start, bytePosition(characterPosition + count) - start);
+}
+
+
+/* Like find, but with QChar positions.
+ */
+qint64 PieceTable::findCharacters(const QString &query, qint64 fromCharacter, bool caseSensitive, bool wholeWords) const
+{
+    qint64 match = find(query, bytePosition(fromCharacter), caseSensitive, wholeWords);
+    return match < 0 ? -1 : characterPosition(match);
+}
+
+
+/* Writes the document to the given device, piece by piece. Returns false if a write fails.
+ */
+bool PieceTable::write(QIODevice *device) const
+{
+    for(int i = 0; i < pieces.size(); i++)
+    {
+        const Piece &piece = pieces.at(i);
+        if(device->write(buffers[piece.buffer].data + piece.start, piece.length) != piece.length)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* Saves the document to the given path, replacing the file atomically. Note that
+ * Windows won't replace the file this table was opened from while it's mapped.
+ * Returns false and describes the problem in errorString if saving failed.
+ */
+bool PieceTable::save(const QString &filePath, QString *errorString) const
+{
+    QSaveFile saveFile(filePath);
+
+    if(!saveFile.open(QIODevice::WriteOnly) || !write(&saveFile) || !saveFile.commit())
+    {
+        *errorString = saveFile.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+
+/* Returns roughly how much heap memory the table uses on top of the mapped file: the
+ * added text, the pieces and the line indexes. Meant for comparing backends.
+ */
+qint64 PieceTable::heapBytes() const
+{
+    qint64 total = originalCopy.capacity() + added.capacity();
+    total += pieces.capacity() * qint64(sizeof(Piece));
+    total += (pieceStarts.capacity() + pieceLineStarts.capacity() + pieceCharacterStarts.capacity()) * qint64(sizeof(qint64));
+    for(const Buffer &buffer : buffers)
+    {
+        total += (buffer.lineCheckpoints.capacity() + buffer.characterCheckpoints.capacity()) * qint64(sizeof(qint64));
+    }
+    return total;
+}
@@ -0,0 +1,124 @@
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+#include "documentmetrics.h"
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QFile>
+#include <QIODevice>
+
+
+/* A piece table: a text storage engine for very large documents that doesn't copy the
+ * file it was opened from. The original file is memory-mapped and never modified;
+ * inserted text is appended to a second buffer, and the document is described by a
+ * list of pieces, each a span of one of the two buffers. An edit only splits or trims
+ * the pieces it touches, so its cost doesn't depend on the size of the document.
+ *
+ * Each buffer keeps a sparse index of its line breaks (the offset after every Nth
+ * one), and each piece knows how many line breaks it spans, which makes finding the
+ * start of a line, or the line an offset is on, logarithmic in the number of pieces.
+ *
+ * Text is stored as UTF-8 and positions are byte offsets. A UTF-8 byte order mark at
+ * the start of the file is skipped. Carriage returns are kept in the buffers (so saving
+ * writes back the original line endings) but left out of text and metrics. Edits at a
+ * position inside a multi-byte sequence are ignored.
+ *
+ * The character methods take positions in QChars instead, counted the way QTextDocument
+ * counts them: UTF-16 code units, with carriage returns left out. Each buffer also keeps
+ * the number of QChars before every Nth byte, and each piece the number it spans, so
+ * converting between the two kinds of position is as cheap as finding a line.
+ *
+ * Editor doesn't use it yet, so the application leaves it out of its build; only the
+ * piece table benchmark (benchmarks/piecetable) compiles it for now.
+ */
+class PieceTable
+{
+public:
+    PieceTable();
+    ~PieceTable();
+
+    bool open(const QString &filePath, QString *errorString);
+    void insert(qint64 position, const QString &text);
+    void remove(qint64 position, qint64 length);
+
+    inline qint64 size() const { return totalSize; }
+    char byteAt(qint64 position) const;
+    QString text(qint64 position, qint64 length) const;
+
+    int lineCount() const;
+    qint64 lineStart(int line) const;
+    int lineOf(qint64 position) const;
+
+    qint64 find(const QString &query, qint64 from, bool caseSensitive, bool wholeWords) const;
+    DocumentMetrics metrics() const;
+
+    qint64 characterCount() const;
+    qint64 characterPosition(qint64 position) const;
+    qint64 bytePosition(qint64 characterPosition) const;
+    void insertCharacters(qint64 characterPosition, const QString &text);
+    void removeCharacters(qint64 characterPosition, qint64 count);
+    QChar characterAt(qint64 characterPosition) const;
+    QString characters(qint64 characterPosition, qint64 count) const;
+    qint64 findCharacters(const QString &query, qint64 fromCharacter, bool caseSensitive, bool wholeWords) const;
+
+    bool write(QIODevice *device) const;
+    bool save(const QString &filePath, QString *errorString) const;
+    qint64 heapBytes() const;
+
+private:
+    struct Buffer
+    {
+        const char *data = nullptr;
+        qint64 size = 0;
+        qint64 newlineCount = 0;
+        QVector<qint64> lineCheckpoints;
+        QVector<qint64> characterCheckpoints;
+
+        void index(qint64 from);
+        qint64 newlinesBefore(qint64 offset) const;
+        qint64 offsetAfterNewline(qint64 newline) const;
+        qint64 charactersBefore(qint64 offset) const;
+        qint64 offsetOfCharacter(qint64 character) const;
+    };
+
+    struct Piece
+    {
+        int buffer;
+        qint64 start;
+        qint64 length;
+        qint64 newlines;
+        qint64 characters;
+    };
+
+    Piece makePiece(int buffer, qint64 start, qint64 length) const;
+    int pieceAt(qint64 position) const;
+    void updatePrefixSums() const;
+    QByteArray bytes(qint64 position, qint64 length) const;
+    bool isWholeWord(qint64 position, qint64 length) const;
+    bool isCodePointBoundary(qint64 position) const;
+    void close();
+
+    static qint64 indexIn(const char *haystack, qint64 length, qint64 from, const QByteArray &needle, bool caseSensitive);
+
+    QFile file;
+    uchar *mappedFile = nullptr;
+    QByteArray originalCopy;
+    QByteArray added;
+    Buffer buffers[2];
+    QVector<Piece> pieces;
+    qint64 totalSize = 0;
+
+    // Start offset, number of line breaks and number of QChars before each piece, rebuilt after edits
+    mutable QVector<qint64> pieceStarts;
+    mutable QVector<qint64> pieceLineStarts;
+    mutable QVector<qint64> pieceCharacterStarts;
+    mutable bool prefixSumsDirty = true;
+
+    static const int originalBuffer = 0;
+    static const int addedBuffer = 1;
+    static const int lineCheckpointStride = 256;
+    static const int characterCheckpointStride = 1024;
+    static const int metricsChunkSize = 1 << 20;
+};
+
+#endif // PIECETABLE_H
@@ -0,0 +1,253 @@
+#include "searchpattern.h"
+
+
+/* Creates a pattern for the given query. A regular expression is compiled right away;
+ * literal text gets a LiteralSearcher.
+ * @param query - the text (or regular expression) to search for
+ * @param caseSensitive - flag denoting whether the search should heed the case of results
+ * @param wholeWords - flag denoting whether the search should look for whole word matches or partials
+ * @param regex - flag denoting whether the query is a regular expression
+ */
+SearchPattern::SearchPattern(const QString &query, bool caseSensitive, bool wholeWords, bool regex)
+    : query(query), sensitivity(caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive), wholeWords(wholeWords), regex(regex)
+{
+    if(regex)
+    {
+        QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+        if(!caseSensitive)
+        {
+            options |= QRegularExpression::CaseInsensitiveOption;
+        }
+
+        expression = QRegularExpression(query, options);
+        expression.optimize();
+    }
+    else
+    {
+        searcher = LiteralSearcher(query, sensitivity);
+    }
+}
+
+
+/* Returns true if this pattern was created with the given query and options.
+ */
+bool SearchPattern::isFor(const QString &query, bool caseSensitive, bool wholeWords, bool regex) const
+{
+    return query == this->query && caseSensitive == (sensitivity == Qt::CaseSensitive) &&
+           wholeWords == this->wholeWords && regex == this->regex;
+}
+
+
+/* Returns every non-overlapping match in the given text, in order, with the given offset
+ * added to their positions. Safe to call from any thread.
+ * @param text - the text to search
+ * @param offset - the position of the text within the document
+ * @param cancelled - if given, a flag another thread may set to stop the search early (the matches found so far are returned)
+ */
+QVector<SearchPattern::Match> SearchPattern::findAll(const QString &text, int offset, const QAtomicInt *cancelled) const
+{
+    QVector<Match> matches;
+
+    if(query.isEmpty() || !isValid())
+    {
+        return matches;
+    }
+
+    if(regex)
+    {
+        QRegularExpressionMatchIterator iterator = expression.globalMatch(text);
+        while(iterator.hasNext() && !isCancelled(cancelled))
+        {
+            QRegularExpressionMatch match = iterator.next();
+            int length = match.capturedLength();
+
+            if(length > 0 && (!wholeWords || isWholeWord(text, match.capturedStart(), length)))
+            {
+                matches.append({offset + match.capturedStart(), length});
+            }
+        }
+        return matches;
+    }
+
+    int position = searcher.indexIn(text, 0);
+    while(position >= 0 && !isCancelled(cancelled))
+    {
+        if(!wholeWords || isWholeWord(text, position, query.length()))
+        {
+            matches.append({offset + position, query.length()});
+            position = searcher.indexIn(text, position + query.length());
+        }
+        else
+        {
+            position = searcher.indexIn(text, position + 1);
+        }
+    }
+
+    return matches;
+}
+
+
+/* Returns true if every match of the other pattern, in any text, starts where a match of
+ * this one does, so that the other pattern's matches can be found by refining this one's.
+ * That holds when both are literal with the same case option, the other query extends
+ * this one, and this one neither requires whole words (which a longer match could break)
+ * nor can overlap itself (which would hide some of its occurrences from findAll).
+ */
+bool SearchPattern::narrowsTo(const SearchPattern &other) const
+{
+    return !regex && !other.regex && !wholeWords && !query.isEmpty() && sensitivity == other.sensitivity &&
+           other.query.startsWith(query, sensitivity) && !overlapsItself();
+}
+
+
+/* Returns the given candidates (the matches of a pattern that narrowsTo this one, in the
+ * same text) at which this pattern matches, with overlapping ones dropped the way findAll
+ * would drop them. Only the candidate positions are looked at. Safe to call from any thread.
+ * @param text - the text the candidates were found in
+ * @param candidates - the matches to check, in order
+ * @param cancelled - if given, a flag another thread may set to stop early
+ */
+QVector<SearchPattern::Match> SearchPattern::refine(const QString &text, const QVector<Match> &candidates, const QAtomicInt *cancelled) const
+{
+    QVector<Match> matches;
+    const ushort *characters = text.utf16();
+    const int length = query.length();
+    int previousEnd = 0;
+
+    for(int i = 0; i < candidates.size(); i++)
+    {
+        const int position = candidates.at(i).position;
+
+        // Checking the flag for every candidate would cost more than the check itself
+        if((i & 1023) == 0 && isCancelled(cancelled))
+        {
+            break;
+        }
+
+        if(position < previousEnd || position + length > text.length() ||
+           searcher.indexIn(characters, position + length, position) != position)
+        {
+            continue;
+        }
+
+        if(!wholeWords || isWholeWord(text, position, length))
+        {
+            matches.append({position, length});
+            previousEnd = position + length;
+        }
+    }
+
+    return matches;
+}
+
+
+/* Returns the text the given match should be replaced with. For a regular expression,
+ * \0 to \9 in the replacement stand for the match and its capture groups, \n and \t for
+ * a line break and a tab, and \\ for a backslash.
+ * @param text - the text the match was found in (without an offset)
+ * @param match - the match to replace
+ * @param with - the replacement, as the user entered it
+ * @param checkText - flag denoting whether the text still needs checking for valid UTF-16; pass false when
+ *                    replacing many matches found by findAll in the same text, or replacing becomes quadratic
+ */
+QString SearchPattern::replacementFor(const QString &text, const Match &match, const QString &with, bool checkText) const
+{
+    if(!regex)
+    {
+        return with;
+    }
+
+    QRegularExpression::MatchOptions options = QRegularExpression::AnchoredMatchOption;
+    if(!checkText)
+    {
+        options |= QRegularExpression::DontCheckSubjectStringMatchOption;
+    }
+
+    QRegularExpressionMatch regexMatch = expression.match(text, match.position, QRegularExpression::NormalMatch, options);
+    return regexMatch.hasMatch() ? expand(with, regexMatch) : with;
+}
+
+
+/* Returns the text of the given document the way patterns search it: one character per
+ * document position, with each block separator turned into a '\n'.
+ */
+QString SearchPattern::searchableText(const QTextDocument *document)
+{
+    return document->toRawText().replace(QChar(QChar::ParagraphSeparator), QLatin1Char('\n'));
+}
+
+
+/* Substitutes the capture group references in the given replacement.
+ */
+QString SearchPattern::expand(const QString &with, const QRegularExpressionMatch &match)
+{
+    QString expanded;
+    expanded.reserve(with.length());
+
+    for(int i = 0; i < with.length(); i++)
+    {
+        QChar next = (i + 1 < with.length()) ? with.at(i + 1) : QChar();
+
+        if(with.at(i) != QLatin1Char('\\') || next.isNull())
+        {
+            expanded += with.at(i);
+            continue;
+        }
+
+        i++;
+        if(next.isDigit())
+        {
+            expanded += match.captured(next.digitValue());
+        }
+        else if(next == QLatin1Char('n'))
+        {
+            expanded += QLatin1Char('\n');
+        }
+        else if(next == QLatin1Char('t'))
+        {
+            expanded += QLatin1Char('\t');
+        }
+        else if(next == QLatin1Char('\\'))
+        {
+            expanded += QLatin1Char('\\');
+        }
+        else
+        {
+            expanded += QLatin1Char('\\');
+            expanded += next;
+        }
+    }
+
+    return expanded;
+}
+
+
+/* Returns true if the query could match twice in a row with the matches overlapping,
+ * that is, if some proper prefix of it is also a suffix of it (like "aba" or "aa").
+ */
+bool SearchPattern::overlapsItself() const
+{
+    for(int length = 1; length < query.length(); length++)
+    {
+        if(query.leftRef(length).compare(query.rightRef(length), sensitivity) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* Returns true if the given match in the given text is neither preceded nor followed by a
+ * letter or digit, the same test QTextDocument::FindWholeWords applies.
+ * @param text - the text the match was found in
+ * @param position - the index of the match
+ * @param length - the length of the match
+ */
+bool SearchPattern::isWholeWord(const QString &text, int position, int length)
+{
+    int end = position + length;
+    bool startsWord = position == 0 || !text.at(position - 1).isLetterOrNumber();
+    bool endsWord = end == text.length() || !text.at(end).isLetterOrNumber();
+    return startsWord && endsWord;
+}
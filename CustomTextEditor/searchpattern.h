@@ -0,0 +1,66 @@
+#ifndef SEARCHPATTERN_H
+#define SEARCHPATTERN_H
+#include <QString>
+#include <QVector>
+#include <QRegularExpression>
+#include <QTextDocument>
+#include <QAtomicInt>
+#include "literalsearcher.h"
+
+
+/* What to search for: either literal text or a regular expression, along with the case
+ * and whole-word options. A regular expression is compiled and optimized (which lets
+ * PCRE2 JIT-compile it) once, when the pattern is created; copies share the compiled
+ * form, so a pattern can be kept for as long as the query stays the same and handed to
+ * worker threads.
+ *
+ * Patterns search plain text in which lines are separated by '\n', a whole document at
+ * a time, so a regular expression may match across lines. Empty matches are skipped.
+ */
+class SearchPattern
+{
+public:
+    struct Match
+    {
+        int position;
+        int length;
+    };
+
+    SearchPattern() {}
+    SearchPattern(const QString &query, bool caseSensitive, bool wholeWords, bool regex);
+
+    bool isFor(const QString &query, bool caseSensitive, bool wholeWords, bool regex) const;
+    inline bool operator==(const SearchPattern &other) const { return isFor(other.query, other.isCaseSensitive(), other.wholeWords, other.regex); }
+    inline bool operator!=(const SearchPattern &other) const { return !(*this == other); }
+
+    inline QString getQuery() const { return query; }
+    inline bool isEmpty() const { return query.isEmpty(); }
+    inline bool isCaseSensitive() const { return sensitivity == Qt::CaseSensitive; }
+    inline bool isWholeWords() const { return wholeWords; }
+    inline bool isRegex() const { return regex; }
+    inline bool isValid() const { return !regex || expression.isValid(); }
+    inline QString getErrorString() const { return expression.errorString(); }
+    inline const QRegularExpression &getRegularExpression() const { return expression; }
+
+    QVector<Match> findAll(const QString &text, int offset = 0, const QAtomicInt *cancelled = nullptr) const;
+    bool narrowsTo(const SearchPattern &other) const;
+    QVector<Match> refine(const QString &text, const QVector<Match> &candidates, const QAtomicInt *cancelled = nullptr) const;
+    QString replacementFor(const QString &text, const Match &match, const QString &with, bool checkText = true) const;
+
+    static QString searchableText(const QTextDocument *document);
+
+private:
+    static bool isWholeWord(const QString &text, int position, int length);
+    bool overlapsItself() const;
+    static inline bool isCancelled(const QAtomicInt *cancelled) { return cancelled != nullptr && cancelled->load() != 0; }
+    static QString expand(const QString &with, const QRegularExpressionMatch &match);
+
+    QString query;
+    Qt::CaseSensitivity sensitivity = Qt::CaseInsensitive;
+    bool wholeWords = false;
+    bool regex = false;
+    QRegularExpression expression;
+    LiteralSearcher searcher;
+};
+
+#endif // SEARCHPATTERN_H
@@ -0,0 +1,221 @@
+#include "streamingloader.h"
+#include "utilityfunctions.h"
+#include "undohistory.h"
+#include <QFile>
+#include <QTextCursor>
+#include <QtConcurrent>
+
+const qint64 StreamingLoader::windowSize;
+
+
+/* Prepares to stream the file at the given path into the given document.
+ * Nothing is read until start is called.
+ */
+StreamingLoader::StreamingLoader(const QString &filePath, QTextDocument *document, QObject *parent)
+    : QObject(parent), filePath(filePath), document(document), cancelled(0)
+{
+    appendTimer.setInterval(0);
+    connect(&appendTimer, SIGNAL(timeout()), this, SLOT(appendDecodedChunks()));
+}
+
+
+/* Stops the worker thread, if it's still running, before this loader goes away.
+ */
+StreamingLoader::~StreamingLoader()
+{
+    cancelled.store(1);
+
+    queueMutex.lock();
+    queueNotFull.wakeAll();
+    queueMutex.unlock();
+
+    reader.waitForFinished();
+}
+
+
+/* Replaces the document's contents with the first screenful of the file and starts
+ * loading the rest in the background. Returns false and describes the problem in
+ * errorString if the file couldn't be read.
+ */
+bool StreamingLoader::start(QString *errorString)
+{
+    elapsedTimer.start();
+    statistics.startMeasuringMemory();
+
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        *errorString = file.errorString();
+        return false;
+    }
+
+    fileSize = file.size();
+    QByteArray firstScreen = file.read(firstScreenBytes);
+    file.close();
+
+    // Like setPlainText, loading a file isn't something the user should be able to undo
+    undoRedoEnabled = document->isUndoRedoEnabled();
+    document->setUndoRedoEnabled(false);
+
+    UndoHistory *undoHistory = UndoHistory::of(document);
+    if(undoHistory != nullptr)
+    {
+        undoHistory->suspend();
+    }
+
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    cursor.select(QTextCursor::Document);
+    cursor.removeSelectedText();
+    cursor.insertText(decoder.decode(firstScreen.constData(), firstScreen.size()));
+    cursor.endEditBlock();
+
+    bytesAppended = firstScreen.size();
+    loading = true;
+    reader = QtConcurrent::run(this, &StreamingLoader::readRemainingWindows);
+    appendTimer.start();
+    return true;
+}
+
+
+/* Stops loading. Whatever was loaded so far stays in the document.
+ */
+void StreamingLoader::cancel()
+{
+    if(!loading)
+    {
+        return;
+    }
+
+    cancelled.store(1);
+
+    queueMutex.lock();
+    queueNotFull.wakeAll();
+    queueMutex.unlock();
+
+    finish(true);
+}
+
+
+/* Runs on a worker thread. Maps the rest of the file one window at a time and decodes
+ * each window, waiting whenever the UI thread falls too far behind so that decoded
+ * text never piles up in memory.
+ */
+void StreamingLoader::readRemainingWindows()
+{
+    QFile file(filePath);
+    qint64 offset = bytesAppended;
+
+    if(file.open(QIODevice::ReadOnly))
+    {
+        while(offset < fileSize && cancelled.load() == 0)
+        {
+            qint64 length = qMin(windowSize, fileSize - offset);
+            DecodedChunk chunk;
+            uchar *window = file.map(offset, length);
+
+            if(window != nullptr)
+            {
+                chunk.text = decoder.decode(reinterpret_cast<const char*>(window), static_cast<int>(length));
+                file.unmap(window);
+            }
+            else
+            {
+                file.seek(offset);
+                QByteArray bytes = file.read(length);
+                if(bytes.isEmpty())
+                {
+                    break;
+                }
+                length = bytes.size();
+                chunk.text = decoder.decode(bytes.constData(), bytes.size());
+            }
+
+            offset += length;
+            chunk.endOffset = offset;
+
+            QMutexLocker locker(&queueMutex);
+            while(decodedChunks.size() >= maxQueuedChunks && cancelled.load() == 0)
+            {
+                queueNotFull.wait(&queueMutex);
+            }
+            decodedChunks.enqueue(chunk);
+        }
+    }
+
+    QMutexLocker locker(&queueMutex);
+    readerDone = true;
+}
+
+
+/* Called from the event loop while the file is loading. Appends decoded chunks to the
+ * end of the document until this frame's time budget is used up.
+ */
+void StreamingLoader::appendDecodedChunks()
+{
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+
+    QTextCursor cursor(document);
+    cursor.movePosition(QTextCursor::End);
+    bool appended = false;
+
+    while(frameTimer.elapsed() < frameBudgetMilliseconds)
+    {
+        queueMutex.lock();
+        bool done = readerDone && decodedChunks.isEmpty();
+        bool available = !decodedChunks.isEmpty();
+        DecodedChunk chunk = available ? decodedChunks.dequeue() : DecodedChunk();
+        queueNotFull.wakeOne();
+        queueMutex.unlock();
+
+        if(done)
+        {
+            finish(false);
+            return;
+        }
+
+        if(!available)
+        {
+            break;
+        }
+
+        cursor.insertText(chunk.text);
+        bytesAppended = chunk.endOffset;
+        appended = true;
+    }
+
+    // Don't spin while the worker thread is still decoding the next window
+    appendTimer.setInterval(appended ? 0 : idleIntervalMilliseconds);
+
+    if(appended)
+    {
+        // Loading isn't an unsaved change
+        document->setModified(false);
+        emit(progressChanged(getProgress()));
+    }
+}
+
+
+/* Restores the document's undo history and reports that loading is over.
+ */
+void StreamingLoader::finish(bool wasCancelled)
+{
+    loading = false;
+    appendTimer.stop();
+    document->setUndoRedoEnabled(undoRedoEnabled);
+    document->setModified(false);
+
+    UndoHistory *undoHistory = UndoHistory::of(document);
+    if(undoHistory != nullptr)
+    {
+        undoHistory->resume();
+    }
+
+    statistics.bytesRead = bytesAppended;
+    statistics.elapsedMilliseconds = elapsedTimer.elapsed();
+    statistics.stopMeasuringMemory();
+
+    emit(progressChanged(getProgress()));
+    emit(finished(wasCancelled));
+}
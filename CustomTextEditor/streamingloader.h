@@ -0,0 +1,81 @@
+#ifndef STREAMINGLOADER_H
+#define STREAMINGLOADER_H
+#include "fileloader.h"
+#include <QObject>
+#include <QTimer>
+#include <QFuture>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+
+/* Loads a large file into a QTextDocument progressively. The first screenful of text
+ * is decoded and inserted immediately; the rest of the file is mapped and decoded on a
+ * worker thread, and the decoded chunks are appended from the event loop a frame's
+ * worth at a time so the UI keeps painting and scrolling while the file loads.
+ */
+class StreamingLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    StreamingLoader(const QString &filePath, QTextDocument *document, QObject *parent = nullptr);
+    ~StreamingLoader() override;
+
+    bool start(QString *errorString);
+    inline int getProgress() const { return fileSize > 0 ? static_cast<int>(bytesAppended * 100 / fileSize) : 100; }
+    inline FileLoader::Statistics getStatistics() const { return statistics; }
+
+    static const qint64 streamingThreshold = 4 * 1024 * 1024;
+
+signals:
+    void progressChanged(int percent);
+    void finished(bool cancelled);
+
+public slots:
+    void cancel();
+
+private slots:
+    void appendDecodedChunks();
+
+private:
+    struct DecodedChunk
+    {
+        QString text;
+        qint64 endOffset = 0;
+    };
+
+    void readRemainingWindows();
+    void finish(bool wasCancelled);
+
+    QString filePath;
+    QTextDocument *document;
+    qint64 fileSize = 0;
+    qint64 bytesAppended = 0;
+    bool undoRedoEnabled = true;
+    bool loading = false;
+
+    TextChunkDecoder decoder;
+    QFuture<void> reader;
+    QAtomicInt cancelled;
+
+    // Chunks decoded by the worker thread, waiting to be appended on the UI thread
+    QMutex queueMutex;
+    QWaitCondition queueNotFull;
+    QQueue<DecodedChunk> decodedChunks;
+    bool readerDone = false;
+
+    QTimer appendTimer;
+    QElapsedTimer elapsedTimer;
+    FileLoader::Statistics statistics;
+
+    static const qint64 firstScreenBytes = 64 * 1024;
+    static const qint64 windowSize = 1024 * 1024;
+    static const int maxQueuedChunks = 8;
+    static const int frameBudgetMilliseconds = 12;
+    static const int idleIntervalMilliseconds = 10;
+};
+
+#endif // STREAMINGLOADER_H
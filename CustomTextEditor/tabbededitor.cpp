@@ -21,6 +21,21 @@ void TabbedEditor::add(Editor *tab)
 }
 
 
+/* Adds the given LargeFileViewer as a new tab, in the same font the editors use.
+ * @tab - the LargeFileViewer object to add as a tab of this widget
+ */
+void TabbedEditor::add(LargeFileViewer *tab)
+{
+    QFont font("Courier", 10);
+    font.setStyleHint(QFont::Monospace);
+    font.setFixedPitch(true);
+    tab->setFont(font);
+
+    QTabWidget::addTab(tab, tab->getFileName());
+    setCurrentWidget(tab);
+}
+
+
 /* Handles input events. Mainly used to allow the user to switch tabs with ctrl + num
  * and ctrl + tab.
  */
@@ -2,6 +2,7 @@
 #define TABBEDEDITOR_H
 #include <QTabWidget>
 #include <editor.h>
+#include "largefileviewer.h"
 
 class TabbedEditor : public QTabWidget
 {
@@ -10,6 +11,7 @@ class TabbedEditor : public QTabWidget
 public:
     TabbedEditor(QWidget *parent = nullptr);
     void add(Editor* tab);
+    void add(LargeFileViewer* tab);
 
 protected:
     bool eventFilter(QObject* obj, QEvent* event) override;
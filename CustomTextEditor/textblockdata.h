@@ -0,0 +1,26 @@
+#ifndef TEXTBLOCKDATA_H
+#define TEXTBLOCKDATA_H
+#include <QTextBlock>
+
+class MetricsTracker;
+
+
+/* Bookkeeping that the editor attaches to each QTextBlock. Qt owns the data and
+ * deletes it together with its block, which is how MetricsTracker learns about
+ * removed blocks without rescanning the document.
+ */
+class TextBlockData : public QTextBlockUserData
+{
+public:
+    TextBlockData(MetricsTracker *tracker) : tracker(tracker) {}
+    ~TextBlockData() override;
+
+    static TextBlockData *of(const QTextBlock &block) { return static_cast<TextBlockData*>(block.userData()); }
+
+    MetricsTracker *tracker;
+    int charCount = 0;
+    int wordCount = 0;
+    bool counted = false;
+};
+
+#endif // TEXTBLOCKDATA_H
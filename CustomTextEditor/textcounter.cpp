@@ -0,0 +1,277 @@
+#include "textcounter.h"
+#include <QtAlgorithms>
+
+#if defined(Q_PROCESSOR_X86) && (defined(Q_CC_GNU) || defined(Q_CC_CLANG))
+#   include <immintrin.h>
+#   define TEXTCOUNTER_SSE2
+#   define TEXTCOUNTER_AVX2
+#   define TEXTCOUNTER_TARGET(features) __attribute__((target(features)))
+#elif defined(Q_CC_MSVC) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#   include <emmintrin.h>
+#   define TEXTCOUNTER_SSE2
+#   define TEXTCOUNTER_TARGET(features)
+#endif
+
+
+namespace
+{
+    /* Running totals carried from one stretch of text to the next. inWord records whether
+     * the last whitespace or alphanumeric character seen was alphanumeric; any other
+     * character (punctuation, symbols) leaves it unchanged.
+     */
+    struct Tally
+    {
+        int newlines = 0;
+        int words = 0;
+        bool inWord = false;
+    };
+
+
+    inline bool isWhitespace(ushort character)
+    {
+        return character == ' ' || (character >= '\t' && character <= '\r');
+    }
+
+
+    inline bool isAlphanumeric(ushort character)
+    {
+        return (character >= '0' && character <= '9') ||
+               ((character | 0x20) >= 'a' && (character | 0x20) <= 'z');
+    }
+
+
+    /* Counts the given characters one at a time. Used for short inputs, for the tail
+     * that doesn't fill a whole vector, and on CPUs without SSE2.
+     */
+    void countScalar(const ushort *text, int length, Tally &tally)
+    {
+        for(int i = 0; i < length; i++)
+        {
+            ushort character = text[i];
+
+            if(isWhitespace(character))
+            {
+                tally.newlines += character == '\n';
+                tally.inWord = false;
+            }
+            else if(isAlphanumeric(character))
+            {
+                tally.words += !tally.inWord;
+                tally.inWord = true;
+            }
+        }
+    }
+
+
+    /* Folds the classification masks of 64 consecutive characters into the tally.
+     * A word starts at every alphanumeric character whose closest preceding whitespace or
+     * alphanumeric character is whitespace. That "closest preceding" value is propagated
+     * across punctuation with six shift-and-fill steps instead of a per-character loop.
+     */
+    inline void accumulate(quint64 alphanumeric, quint64 whitespace, Tally &tally)
+    {
+        quint64 relevant = alphanumeric | whitespace;
+        quint64 previousWasAlphanumeric = (alphanumeric << 1) | (tally.inWord ? 1 : 0);
+        quint64 known = (relevant << 1) | 1;
+
+        for(int shift = 1; shift < 64; shift <<= 1)
+        {
+            previousWasAlphanumeric |= ~known & (previousWasAlphanumeric << shift);
+            known |= known << shift;
+        }
+
+        tally.words += qPopulationCount(alphanumeric & ~previousWasAlphanumeric);
+
+        if(relevant != 0)
+        {
+            int last = 63 - qCountLeadingZeroBits(relevant);
+            tally.inWord = (alphanumeric >> last) & 1;
+        }
+    }
+
+
+#ifdef TEXTCOUNTER_SSE2
+    /* Returns a mask with all bits set in each lane whose value lies in [low, high]. */
+    TEXTCOUNTER_TARGET("sse2")
+    inline __m128i inRange(__m128i characters, ushort low, ushort high)
+    {
+        __m128i offset = _mm_sub_epi16(characters, _mm_set1_epi16(static_cast<short>(low)));
+        __m128i excess = _mm_subs_epu16(offset, _mm_set1_epi16(static_cast<short>(high - low)));
+        return _mm_cmpeq_epi16(excess, _mm_setzero_si128());
+    }
+
+
+    /* Classifies 16 characters, returning one bit per character for each class. */
+    TEXTCOUNTER_TARGET("sse2")
+    inline void classify16(const ushort *text, quint32 &alphanumeric, quint32 &whitespace, quint32 &newline)
+    {
+        __m128i masks[2][3];
+
+        for(int half = 0; half < 2; half++)
+        {
+            __m128i characters = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + half * 8));
+            __m128i folded = _mm_or_si128(characters, _mm_set1_epi16(0x20));
+
+            masks[half][0] = _mm_or_si128(inRange(characters, '0', '9'), inRange(folded, 'a', 'z'));
+            masks[half][1] = _mm_or_si128(inRange(characters, '\t', '\r'), _mm_cmpeq_epi16(characters, _mm_set1_epi16(' ')));
+            masks[half][2] = _mm_cmpeq_epi16(characters, _mm_set1_epi16('\n'));
+        }
+
+        alphanumeric = static_cast<quint32>(_mm_movemask_epi8(_mm_packs_epi16(masks[0][0], masks[1][0])));
+        whitespace = static_cast<quint32>(_mm_movemask_epi8(_mm_packs_epi16(masks[0][1], masks[1][1])));
+        newline = static_cast<quint32>(_mm_movemask_epi8(_mm_packs_epi16(masks[0][2], masks[1][2])));
+    }
+
+
+    /* Counts as many whole 64-character stretches as possible and returns how many characters it consumed. */
+    TEXTCOUNTER_TARGET("sse2")
+    int countSse2(const ushort *text, int length, Tally &tally)
+    {
+        int i = 0;
+
+        for(; i + 64 <= length; i += 64)
+        {
+            quint64 alphanumeric = 0;
+            quint64 whitespace = 0;
+            quint64 newline = 0;
+
+            for(int part = 0; part < 4; part++)
+            {
+                quint32 a, w, n;
+                classify16(text + i + part * 16, a, w, n);
+                alphanumeric |= quint64(a) << (part * 16);
+                whitespace |= quint64(w) << (part * 16);
+                newline |= quint64(n) << (part * 16);
+            }
+
+            tally.newlines += qPopulationCount(newline);
+            accumulate(alphanumeric, whitespace, tally);
+        }
+
+        return i;
+    }
+#endif
+
+
+#ifdef TEXTCOUNTER_AVX2
+    TEXTCOUNTER_TARGET("avx2")
+    inline __m256i inRange256(__m256i characters, ushort low, ushort high)
+    {
+        __m256i offset = _mm256_sub_epi16(characters, _mm256_set1_epi16(static_cast<short>(low)));
+        __m256i excess = _mm256_subs_epu16(offset, _mm256_set1_epi16(static_cast<short>(high - low)));
+        return _mm256_cmpeq_epi16(excess, _mm256_setzero_si256());
+    }
+
+
+    /* Packs two 16-lane masks into one bit per character. packs works within 128-bit
+     * lanes, so the 64-bit quarters have to be put back in order before the movemask.
+     */
+    TEXTCOUNTER_TARGET("avx2")
+    inline quint32 toBits(__m256i low, __m256i high)
+    {
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xD8);
+        return static_cast<quint32>(_mm256_movemask_epi8(packed));
+    }
+
+
+    TEXTCOUNTER_TARGET("avx2")
+    int countAvx2(const ushort *text, int length, Tally &tally)
+    {
+        int i = 0;
+
+        for(; i + 64 <= length; i += 64)
+        {
+            __m256i masks[4][3];
+
+            for(int part = 0; part < 4; part++)
+            {
+                __m256i characters = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i + part * 16));
+                __m256i folded = _mm256_or_si256(characters, _mm256_set1_epi16(0x20));
+
+                masks[part][0] = _mm256_or_si256(inRange256(characters, '0', '9'), inRange256(folded, 'a', 'z'));
+                masks[part][1] = _mm256_or_si256(inRange256(characters, '\t', '\r'),
+                                                 _mm256_cmpeq_epi16(characters, _mm256_set1_epi16(' ')));
+                masks[part][2] = _mm256_cmpeq_epi16(characters, _mm256_set1_epi16('\n'));
+            }
+
+            quint64 alphanumeric = toBits(masks[0][0], masks[1][0]) | (quint64(toBits(masks[2][0], masks[3][0])) << 32);
+            quint64 whitespace = toBits(masks[0][1], masks[1][1]) | (quint64(toBits(masks[2][1], masks[3][1])) << 32);
+            quint64 newline = toBits(masks[0][2], masks[1][2]) | (quint64(toBits(masks[2][2], masks[3][2])) << 32);
+
+            tally.newlines += qPopulationCount(newline);
+            accumulate(alphanumeric, whitespace, tally);
+        }
+
+        return i;
+    }
+#endif
+
+
+    enum class Kernel
+    {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+
+    /* Picks the widest kernel the current CPU supports. */
+    Kernel detectKernel()
+    {
+#if defined(TEXTCOUNTER_AVX2)
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+        {
+            return Kernel::Avx2;
+        }
+        if(__builtin_cpu_supports("sse2"))
+        {
+            return Kernel::Sse2;
+        }
+        return Kernel::Scalar;
+#elif defined(TEXTCOUNTER_SSE2)
+        return Kernel::Sse2;
+#else
+        return Kernel::Scalar;
+#endif
+    }
+}
+
+
+/* Counts the characters, words and lines in the given text.
+ */
+DocumentMetrics TextCounter::count(const QString &text)
+{
+    return count(text.utf16(), text.length());
+}
+
+
+/* Counts the characters, words and lines in the given UTF-16 buffer without allocating.
+ * @param text - the first UTF-16 code unit to count
+ * @param length - the number of code units to count
+ */
+DocumentMetrics TextCounter::count(const ushort *text, int length)
+{
+    static const Kernel kernel = detectKernel();
+    Tally tally;
+    int counted = 0;
+
+    switch(kernel)
+    {
+#ifdef TEXTCOUNTER_AVX2
+        case(Kernel::Avx2): counted = countAvx2(text, length, tally); break;
+#endif
+#ifdef TEXTCOUNTER_SSE2
+        case(Kernel::Sse2): counted = countSse2(text, length, tally); break;
+#endif
+        default: break;
+    }
+
+    countScalar(text + counted, length - counted, tally);
+
+    DocumentMetrics metrics;
+    metrics.charCount = length - tally.newlines;
+    metrics.wordCount = tally.words;
+    metrics.lineCount = tally.newlines + 1;
+    return metrics;
+}
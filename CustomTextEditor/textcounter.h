@@ -0,0 +1,18 @@
+#ifndef TEXTCOUNTER_H
+#define TEXTCOUNTER_H
+#include "documentmetrics.h"
+#include <QString>
+
+
+/* Single-pass character, word and line counting over UTF-16 text. Uses SSE2 or AVX2
+ * when the CPU supports them and falls back to a scalar loop otherwise. Newlines are
+ * not counted as characters, and a word is any run of non-whitespace characters that
+ * contains at least one alphanumeric character.
+ */
+namespace TextCounter
+{
+    DocumentMetrics count(const QString &text);
+    DocumentMetrics count(const ushort *text, int length);
+}
+
+#endif // TEXTCOUNTER_H
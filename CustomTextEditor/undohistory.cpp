@@ -0,0 +1,816 @@
+#include "undohistory.h"
+#include <QTextCursor>
+#include <QTextBlock>
+#include <QDataStream>
+#include <QSettings>
+#include <algorithm>
+
+
+namespace
+{
+    // Chunks are packed again each time editing moves to another one, so compression is fast rather than thorough
+    QByteArray compress(const QString &text)
+    {
+        return text.isEmpty() ? QByteArray() : qCompress(reinterpret_cast<const uchar*>(text.constData()), text.length() * int(sizeof(QChar)), 1);
+    }
+
+    QString uncompress(const QByteArray &compressed)
+    {
+        const QByteArray bytes = compressed.isEmpty() ? QByteArray() : qUncompress(compressed);
+        return QString(reinterpret_cast<const QChar*>(bytes.constData()), bytes.size() / int(sizeof(QChar)));
+    }
+}
+
+
+const int UndoHistory::defaultMemoryBudgetMB;
+const int UndoHistory::chunkLength;
+const qint64 UndoHistory::minimumReclaimedBytes;
+
+
+/* Takes over the undo history of the given document, which becomes this object's parent.
+ * The budget is the one chosen under View > Undo Memory Budget.
+ * @param document - the document whose edits should be recorded
+ */
+UndoHistory::UndoHistory(QTextDocument *document) : QObject(document)
+{
+    this->document = document;
+    memoryBudget = qint64(configuredMemoryBudgetMB()) * 1024 * 1024;
+
+    document->setUndoRedoEnabled(false);
+    resetText();
+    cleanIndex = document->isModified() ? -1 : 0;
+
+    connect(document, SIGNAL(contentsChange(int,int,int)), this, SLOT(on_contentsChange(int,int,int)));
+    connect(document, SIGNAL(modificationChanged(bool)), this, SLOT(on_modificationChanged(bool)));
+}
+
+
+UndoHistory::~UndoHistory()
+{
+}
+
+
+/* Returns the undo history of the given document, or nullptr if it doesn't have one.
+ */
+UndoHistory *UndoHistory::of(QTextDocument *document)
+{
+    return document->findChild<UndoHistory*>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+
+/* Returns the memory budget, in megabytes, that new undo histories start out with.
+ */
+int UndoHistory::configuredMemoryBudgetMB()
+{
+    QSettings settings;
+    return settings.value("undoMemoryBudgetMB", defaultMemoryBudgetMB).toInt();
+}
+
+
+/* Stops recording edits, and forgets the ones recorded so far along with the copy of the
+ * text. Call resume once done.
+ */
+void UndoHistory::suspend()
+{
+    recording = false;
+    clear();
+
+    chunks.clear();
+    chunkStarts.clear();
+    textLength = 0;
+    compressedBytes = 0;
+    unpackedChunk = -1;
+    unpackedText = QString();
+}
+
+
+/* Starts recording edits again, from the document as it is now.
+ */
+void UndoHistory::resume()
+{
+    recording = true;
+    resynchronize();
+}
+
+
+/* Forgets every entry, so that there is nothing left to undo or redo.
+ */
+void UndoHistory::clear()
+{
+    bool couldUndo = canUndo();
+    bool couldRedo = canRedo();
+
+    entries.clear();
+    current = 0;
+    cleanIndex = document->isModified() ? -1 : 0;
+    entryBytes = 0;
+    spillBytes = 0;
+
+    if(spillFile.isOpen())
+    {
+        spillFile.resize(0);
+    }
+
+    notify(couldUndo, couldRedo);
+}
+
+
+/* Undoes the most recent entry. Returns the position just past the text it put back, or
+ * -1 if there was nothing to undo.
+ */
+int UndoHistory::undo()
+{
+    if(!canUndo())
+    {
+        return -1;
+    }
+
+    bool couldUndo = canUndo();
+    bool couldRedo = canRedo();
+    Entry &entry = entries[current - 1];
+
+    // An entry that can't be read back, or no longer fits the document, leaves nothing to trust
+    if(!restore(entry) || entry.position + entry.added.length() > textLength)
+    {
+        clear();
+        return -1;
+    }
+
+    int position = entry.position + entry.removed.length();
+    apply(entry.position, entry.added.length(), entry.removed);
+
+    // Applying it found the copy of the text out of step with the document, and cleared the history
+    if(entries.isEmpty())
+    {
+        return -1;
+    }
+    current--;
+
+    if(current == cleanIndex)
+    {
+        document->setModified(false);
+    }
+
+    enforceBudget();
+    notify(couldUndo, couldRedo);
+    return position;
+}
+
+
+/* Redoes the most recently undone entry. Returns the position just past the text it put
+ * back, or -1 if there was nothing to redo.
+ */
+int UndoHistory::redo()
+{
+    if(!canRedo())
+    {
+        return -1;
+    }
+
+    bool couldUndo = canUndo();
+    bool couldRedo = canRedo();
+    Entry &entry = entries[current];
+
+    if(!restore(entry) || entry.position + entry.removed.length() > textLength)
+    {
+        clear();
+        return -1;
+    }
+
+    int position = entry.position + entry.added.length();
+    apply(entry.position, entry.removed.length(), entry.added);
+
+    if(entries.isEmpty())
+    {
+        return -1;
+    }
+    current++;
+
+    if(current == cleanIndex)
+    {
+        document->setModified(false);
+    }
+
+    enforceBudget();
+    notify(couldUndo, couldRedo);
+    return position;
+}
+
+
+/* Sets the number of bytes the entries held in memory may take up, spilling the oldest
+ * ones to disk right away if they now take up more.
+ */
+void UndoHistory::setMemoryBudget(qint64 bytes)
+{
+    memoryBudget = bytes;
+    enforceBudget();
+    notify(canUndo(), canRedo());
+}
+
+
+/* Called whenever the document's text changes. Keeps the copy of the text up to date and,
+ * unless the change is an undo or redo being applied, records it.
+ */
+void UndoHistory::on_contentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if(!recording)
+    {
+        return;
+    }
+
+    const int documentLength = document->characterCount() - 1;
+
+    // Qt sometimes counts the document's final paragraph separator as part of a change
+    charsRemoved = qMin(charsRemoved, textLength - position);
+    charsAdded = qMin(charsAdded, documentLength - position);
+
+    if(position < 0 || charsRemoved < 0 || charsAdded < 0 || textLength - charsRemoved + charsAdded != documentLength)
+    {
+        // The copy no longer matches the document, so none of the entries can be trusted
+        resynchronize();
+        return;
+    }
+
+    QString removed = textAt(position, charsRemoved);
+
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(position + charsAdded, QTextCursor::KeepAnchor);
+    QString added = cursor.selectedText();
+
+    // Formatting changes leave the text as it was
+    if(removed == added)
+    {
+        return;
+    }
+
+    replaceText(position, charsRemoved, added);
+
+    if(!applying)
+    {
+        record(position, removed, added);
+    }
+}
+
+
+/* Called when the document is saved (or otherwise marked unmodified). Undoing or redoing
+ * back to this point marks it unmodified again.
+ */
+void UndoHistory::on_modificationChanged(bool modified)
+{
+    if(!modified)
+    {
+        cleanIndex = current;
+    }
+}
+
+
+/* Adds an edit to the history, in place of anything that could have been redone.
+ */
+void UndoHistory::record(int position, const QString &removed, const QString &added)
+{
+    bool couldUndo = canUndo();
+    bool couldRedo = canRedo();
+
+    dropRedoEntries();
+
+    if(!coalesce(position, removed, added))
+    {
+        bool typing = (removed.isEmpty() && added.length() == 1 && added.at(0) != QChar::ParagraphSeparator) ||
+                      (added.isEmpty() && removed.length() == 1 && removed.at(0) != QChar::ParagraphSeparator);
+
+        Entry entry = {position, removed, added, typing, -1, 0};
+        entries.append(entry);
+        entryBytes += bytesOf(entry);
+        current++;
+    }
+
+    enforceBudget();
+    notify(couldUndo, couldRedo);
+}
+
+
+/* Merges a keystroke into the latest entry if both are part of the same run of typing,
+ * backspacing or deleting. Returns true if it did.
+ */
+bool UndoHistory::coalesce(int position, const QString &removed, const QString &added)
+{
+    // Undoing back to the saved text has to stay possible
+    if(current == 0 || current == cleanIndex)
+    {
+        return false;
+    }
+
+    Entry &last = entries[current - 1];
+    bool keystroke = (removed.isEmpty() && added.length() == 1) || (added.isEmpty() && removed.length() == 1);
+
+    // A new line starts a new entry
+    if(!last.typing || last.spillOffset >= 0 || !keystroke || (added + removed).at(0) == QChar::ParagraphSeparator)
+    {
+        return false;
+    }
+
+    const int end = last.position + last.added.length();
+    entryBytes -= bytesOf(last);
+
+    // Typing on
+    if(removed.isEmpty() && position == end)
+    {
+        last.added += added;
+    }
+    // Backspacing over what was just typed
+    else if(added.isEmpty() && !last.added.isEmpty() && position + 1 == end)
+    {
+        last.added.chop(1);
+    }
+    // Deleting the character after the entry
+    else if(added.isEmpty() && position == end)
+    {
+        last.removed += removed;
+    }
+    // Backspacing on past the start of the entry
+    else if(added.isEmpty() && last.added.isEmpty() && position + 1 == last.position)
+    {
+        last.removed.prepend(removed);
+        last.position = position;
+    }
+    else
+    {
+        entryBytes += bytesOf(last);
+        return false;
+    }
+
+    // Typing a character and then backspacing over it leaves nothing to undo
+    if(last.added.isEmpty() && last.removed.isEmpty())
+    {
+        entries.removeLast();
+        current--;
+        return true;
+    }
+
+    entryBytes += bytesOf(last);
+    return true;
+}
+
+
+/* Forgets the entries past the current one, which an edit makes impossible to redo.
+ */
+void UndoHistory::dropRedoEntries()
+{
+    if(current == entries.size())
+    {
+        return;
+    }
+
+    for(int i = current; i < entries.size(); i++)
+    {
+        entryBytes -= bytesOf(entries.at(i));
+        spillBytes -= entries.at(i).spillSize;
+    }
+    entries.erase(entries.begin() + current, entries.end());
+
+    if(cleanIndex > current)
+    {
+        cleanIndex = -1;
+    }
+
+    reclaimSpillSpace();
+}
+
+
+/* Spills the oldest entries to disk until those left in memory fit the budget. The entries on either side of the current position are
+ * kept, since they are the next to be undone or redone.
+ */
+void UndoHistory::enforceBudget()
+{
+    int i = 0;
+
+    while(memoryUsage() > memoryBudget && i < entries.size())
+    {
+        if(i == current - 1 || i == current || entries.at(i).spillOffset >= 0 || spill(entries[i]))
+        {
+            i++;
+            continue;
+        }
+
+        // The spill file can't be written to, so the oldest entry is forgotten instead
+        if(current == 0)
+        {
+            dropRedoEntries();
+            break;
+        }
+
+        entryBytes -= bytesOf(entries.first());
+        spillBytes -= entries.first().spillSize;
+        entries.removeFirst();
+        current--;
+        cleanIndex = cleanIndex > 0 ? cleanIndex - 1 : -1;
+        i = 0;
+    }
+
+    reclaimSpillSpace();
+}
+
+
+/* Compresses the text of the given entry and moves it to the spill file. Returns false
+ * if the file couldn't be written to, in which case the entry is left as it was.
+ */
+bool UndoHistory::spill(Entry &entry)
+{
+    if(!spillFile.isOpen() && !spillFile.open())
+    {
+        return false;
+    }
+
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream << entry.removed << entry.added;
+    QByteArray compressed = qCompress(bytes);
+
+    qint64 offset = spillFile.size();
+    if(!spillFile.seek(offset) || spillFile.write(compressed) != compressed.size())
+    {
+        return false;
+    }
+
+    entryBytes -= bytesOf(entry);
+    entry.removed = QString();
+    entry.added = QString();
+    entry.spillOffset = offset;
+    entry.spillSize = compressed.size();
+    entryBytes += bytesOf(entry);
+    spillBytes += entry.spillSize;
+    return true;
+}
+
+
+/* Reads the text of the given entry back from the spill file, if it was spilled.
+ * Returns false if it couldn't be read.
+ */
+bool UndoHistory::restore(Entry &entry)
+{
+    if(entry.spillOffset < 0)
+    {
+        return true;
+    }
+
+    if(!spillFile.seek(entry.spillOffset))
+    {
+        return false;
+    }
+
+    QByteArray bytes = qUncompress(spillFile.read(entry.spillSize));
+    QDataStream stream(bytes);
+    QString removed;
+    QString added;
+    stream >> removed >> added;
+
+    if(stream.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    entryBytes -= bytesOf(entry);
+    entry.removed = removed;
+    entry.added = added;
+    spillBytes -= entry.spillSize;
+    entry.spillOffset = -1;
+    entry.spillSize = 0;
+    entryBytes += bytesOf(entry);
+    reclaimSpillSpace();
+    return true;
+}
+
+
+/* Gives back the space in the spill file that entries no longer use (because they were
+ * read back or forgotten), once there is more of it than of space in use. The spilled
+ * entries are moved down to the start of the file, in the order they appear in it, and
+ * the file is cut short after them. Should moving one fail, the rest stay where they
+ * are; an entry that can no longer be read back is dealt with when it is undone.
+ */
+void UndoHistory::reclaimSpillSpace()
+{
+    if(!spillFile.isOpen())
+    {
+        return;
+    }
+
+    const qint64 unused = spillFile.size() - spillBytes;
+
+    if(spillBytes == 0)
+    {
+        spillFile.resize(0);
+        return;
+    }
+
+    if(unused <= spillBytes || unused < minimumReclaimedBytes)
+    {
+        return;
+    }
+
+    QVector<int> spilled;
+    for(int i = 0; i < entries.size(); i++)
+    {
+        if(entries.at(i).spillOffset >= 0)
+        {
+            spilled.append(i);
+        }
+    }
+
+    std::sort(spilled.begin(), spilled.end(), [this](int a, int b) { return entries.at(a).spillOffset < entries.at(b).spillOffset; });
+
+    // Each entry moves down (or stays), so its text is read before anything overwrites it
+    qint64 end = 0;
+    for(int i : spilled)
+    {
+        Entry &entry = entries[i];
+
+        if(entry.spillOffset != end)
+        {
+            if(!spillFile.seek(entry.spillOffset))
+            {
+                return;
+            }
+
+            QByteArray bytes = spillFile.read(entry.spillSize);
+            if(bytes.size() != entry.spillSize || !spillFile.seek(end) || spillFile.write(bytes) != bytes.size())
+            {
+                return;
+            }
+
+            entry.spillOffset = end;
+        }
+
+        end += entry.spillSize;
+    }
+
+    spillFile.resize(end);
+}
+
+
+/* Replaces the given range of the document with the given text, as one edit that isn't
+ * itself recorded.
+ */
+void UndoHistory::apply(int position, int length, const QString &text)
+{
+    applying = true;
+
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+    cursor.beginEditBlock();
+    cursor.removeSelectedText();
+    cursor.insertText(text);
+    cursor.endEditBlock();
+
+    applying = false;
+}
+
+
+/* Reports any change in what can be undone or redone, along with the memory in use.
+ */
+void UndoHistory::notify(bool couldUndo, bool couldRedo)
+{
+    if(couldUndo != canUndo())
+    {
+        emit(undoAvailable(canUndo()));
+    }
+    if(couldRedo != canRedo())
+    {
+        emit(redoAvailable(canRedo()));
+    }
+    emit(memoryUsageChanged(memoryUsage(), spillBytes));
+}
+
+
+/* Returns the number of bytes of memory the given entry takes up.
+ */
+qint64 UndoHistory::bytesOf(const Entry &entry)
+{
+    return qint64(sizeof(Entry)) + qint64(entry.removed.size() + entry.added.size()) * int(sizeof(QChar));
+}
+
+
+/* Replaces the copy of the text with the document's current text, a block at a time.
+ */
+void UndoHistory::resetText()
+{
+    chunks.clear();
+    textLength = 0;
+    compressedBytes = 0;
+    unpackedChunk = -1;
+    unpackedText = QString();
+
+    QString chunk;
+    for(QTextBlock block = document->begin(); block.isValid(); block = block.next())
+    {
+        if(block != document->begin())
+        {
+            chunk += QChar::ParagraphSeparator;
+        }
+        chunk += block.text();
+
+        // Blocks longer than a chunk make for longer chunks, which is fine
+        if(chunk.length() >= chunkLength)
+        {
+            const Chunk packed = {chunk.length(), compress(chunk)};
+            textLength += packed.length;
+            compressedBytes += packed.compressed.size();
+            chunks.append(packed);
+            chunk.clear();
+        }
+    }
+
+    if(!chunk.isEmpty() || chunks.isEmpty())
+    {
+        const Chunk packed = {chunk.length(), compress(chunk)};
+        textLength += packed.length;
+        compressedBytes += packed.compressed.size();
+        chunks.append(packed);
+    }
+
+    indexChunks(0);
+}
+
+
+/* Forgets every entry and copies the document's text afresh. Called when the copy of the
+ * text has to be (or may be) out of step with the document.
+ */
+void UndoHistory::resynchronize()
+{
+    resetText();
+    clear();
+}
+
+
+/* Returns the given range of the copy of the text.
+ */
+QString UndoHistory::textAt(int position, int length) const
+{
+    QString text;
+    text.reserve(length);
+
+    int offset = position;
+    for(int i = chunkAt(&offset); i >= 0 && i < chunks.size() && text.length() < length; i++)
+    {
+        text += unpack(i).midRef(offset, length - text.length());
+        offset = 0;
+    }
+
+    return text;
+}
+
+
+/* Replaces the given range of the copy of the text with the given text.
+ */
+void UndoHistory::replaceText(int position, int length, const QString &text)
+{
+    if(chunks.isEmpty())
+    {
+        const Chunk empty = {0, QByteArray()};
+        chunks.append(empty);
+        chunkStarts.append(0);
+    }
+
+    int offset = position;
+    const int first = chunkAt(&offset);
+    const int firstLength = chunks.at(first).length;
+    textLength += text.length() - length;
+
+    // Most edits fall within a single chunk
+    if(offset + length <= firstLength && firstLength - length + text.length() <= 2 * chunkLength)
+    {
+        QString &chunk = unpack(first);
+        chunk.replace(offset, length, text);
+        chunks[first].length = chunk.length();
+        int next = first + 1;
+
+        if(chunk.isEmpty() && chunks.size() > 1)
+        {
+            compressedBytes -= chunks.at(first).compressed.size();
+            chunks.remove(first);
+            chunkStarts.remove(first);
+            unpackedChunk = -1;
+            next = first;
+        }
+
+        for(int i = next; i < chunks.size(); i++)
+        {
+            chunkStarts[i] += text.length() - length;
+        }
+        return;
+    }
+
+    // Otherwise the chunks the edit spans are rebuilt
+    QString merged = unpack(first).left(offset) + text;
+    int remaining = length - (firstLength - offset);
+    int last = first;
+
+    if(remaining < 0)
+    {
+        merged += unpack(first).midRef(offset + length);
+    }
+
+    while(remaining > 0 && last + 1 < chunks.size())
+    {
+        last++;
+
+        if(remaining < chunks.at(last).length)
+        {
+            merged += unpack(last).midRef(remaining);
+        }
+        remaining -= chunks.at(last).length;
+    }
+
+    // The unpacked chunk is either replaced along with the rest or packed away
+    if(unpackedChunk >= first && unpackedChunk <= last)
+    {
+        unpackedChunk = -1;
+        unpackedText = QString();
+    }
+    packUnpacked();
+
+    QVector<Chunk> rebuilt = chunks.mid(0, first);
+    for(int i = first; i <= last; i++)
+    {
+        compressedBytes -= chunks.at(i).compressed.size();
+    }
+    for(int i = 0; i < merged.length(); i += chunkLength)
+    {
+        const QString piece = merged.mid(i, chunkLength);
+        const Chunk packed = {piece.length(), compress(piece)};
+        compressedBytes += packed.compressed.size();
+        rebuilt.append(packed);
+    }
+    rebuilt += chunks.mid(last + 1);
+    chunks = rebuilt;
+    indexChunks(first);
+}
+
+
+/* Works out where each chunk of the copy of the text starts, from the given chunk on.
+ */
+void UndoHistory::indexChunks(int from)
+{
+    chunkStarts.resize(chunks.size());
+
+    for(int i = from; i < chunks.size(); i++)
+    {
+        chunkStarts[i] = i > 0 ? chunkStarts.at(i - 1) + chunks.at(i - 1).length : 0;
+    }
+}
+
+
+/* Returns the index of the chunk holding the given position of the text, and turns the
+ * position into an offset within that chunk. The end of the text belongs to the last
+ * chunk. Returns -1 if there are no chunks.
+ */
+int UndoHistory::chunkAt(int *position) const
+{
+    if(chunks.isEmpty())
+    {
+        return -1;
+    }
+
+    // The last chunk starting at or before the position; empty chunks only ever come last
+    const int i = int(std::upper_bound(chunkStarts.constBegin(), chunkStarts.constEnd(), *position) - chunkStarts.constBegin()) - 1;
+    const int chunk = qBound(0, i, chunks.size() - 1);
+
+    *position -= chunkStarts.at(chunk);
+    return chunk;
+}
+
+
+/* Returns the text of the given chunk, unpacking it first (and packing the chunk that was
+ * unpacked before) unless it already is.
+ */
+QString &UndoHistory::unpack(int index) const
+{
+    if(index != unpackedChunk)
+    {
+        packUnpacked();
+        unpackedText = uncompress(chunks.at(index).compressed);
+        unpackedChunk = index;
+    }
+
+    return unpackedText;
+}
+
+
+/* Compresses the unpacked chunk, if any, back into its place.
+ */
+void UndoHistory::packUnpacked() const
+{
+    if(unpackedChunk < 0)
+    {
+        return;
+    }
+
+    Chunk &chunk = chunks[unpackedChunk];
+    compressedBytes -= chunk.compressed.size();
+    chunk.compressed = compress(unpackedText);
+    compressedBytes += chunk.compressed.size();
+
+    unpackedChunk = -1;
+    unpackedText = QString();
+}
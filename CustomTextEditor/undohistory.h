@@ -0,0 +1,132 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+#include <QObject>
+#include <QTextDocument>
+#include <QTemporaryFile>
+#include <QString>
+#include <QList>
+#include <QVector>
+
+
+/* The undo history of a document, kept within a memory budget. QTextDocument's own undo
+ * stack can't be bounded: every edit keeps the text it replaced alive for as long as the
+ * document exists. So the document's undo is switched off, and each edit is recorded
+ * here instead as the text it removed and the text it added. Consecutive keystrokes
+ * (typing, backspacing or deleting characters in a row) extend a single entry.
+ *
+ * QTextDocument only reports an edit once it has happened (and has no signal before one),
+ * so to recover the text an edit removed, the history keeps its own copy of the
+ * document's text, updated as edits come in. The copy is split into chunks that are kept
+ * compressed, except for the one last edited or read, so it takes a fraction of the
+ * document's own memory; typing in one place only ever touches that one chunk. The copy
+ * doesn't count against the budget, which only governs the entries: once those held in
+ * memory go over it, the oldest are compressed and written to a temporary file, to be
+ * read back only if the user undoes that far. Space in the file that entries no longer
+ * use is reclaimed once there is more of it than of used space.
+ *
+ * The history is a child of its document. Code that rewrites the whole document (loading
+ * a file, say) suspends it beforehand and resumes it afterwards, which starts it afresh.
+ */
+class UndoHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    UndoHistory(QTextDocument *document);
+    ~UndoHistory() override;
+
+    static UndoHistory *of(QTextDocument *document);
+    static int configuredMemoryBudgetMB();
+
+    void suspend();
+    void resume();
+    void clear();
+
+    int undo();
+    int redo();
+    inline bool canUndo() const { return current > 0; }
+    inline bool canRedo() const { return current < entries.size(); }
+
+    void setMemoryBudget(qint64 bytes);
+    inline qint64 getMemoryBudget() const { return memoryBudget; }
+    inline qint64 memoryUsage() const { return entryBytes; }
+    inline qint64 spilledBytes() const { return spillBytes; }
+    inline qint64 textCopyBytes() const { return compressedBytes + qint64(unpackedText.capacity()) * int(sizeof(QChar)); }
+
+    static const int defaultMemoryBudgetMB = 64;
+
+signals:
+    void undoAvailable(bool available);
+    void redoAvailable(bool available);
+    void memoryUsageChanged(qint64 inMemory, qint64 onDisk);
+
+private slots:
+    void on_contentsChange(int position, int charsRemoved, int charsAdded);
+    void on_modificationChanged(bool modified);
+
+private:
+    struct Entry
+    {
+        int position;
+        QString removed;
+        QString added;
+        bool typing;
+
+        // Where the entry's text went in the spill file, if it isn't in memory
+        qint64 spillOffset;
+        int spillSize;
+    };
+
+    void record(int position, const QString &removed, const QString &added);
+    bool coalesce(int position, const QString &removed, const QString &added);
+    void dropRedoEntries();
+    void enforceBudget();
+    bool spill(Entry &entry);
+    bool restore(Entry &entry);
+    void reclaimSpillSpace();
+    void apply(int position, int length, const QString &text);
+    void notify(bool couldUndo, bool couldRedo);
+    static qint64 bytesOf(const Entry &entry);
+
+    // The copy of the document's text
+    void resetText();
+    void resynchronize();
+    QString textAt(int position, int length) const;
+    void replaceText(int position, int length, const QString &text);
+    void indexChunks(int from);
+    int chunkAt(int *position) const;
+    QString &unpack(int index) const;
+    void packUnpacked() const;
+
+    QTextDocument *document;
+    QList<Entry> entries;
+    int current = 0;
+    int cleanIndex = 0;
+    bool recording = true;
+    bool applying = false;
+
+    qint64 memoryBudget;
+    qint64 entryBytes = 0;
+    qint64 spillBytes = 0;
+    QTemporaryFile spillFile;
+
+    // The copy of the text: each chunk's length and compressed UTF-16, where each chunk
+    // starts, and the one chunk that is unpacked (its compressed form is then stale)
+    struct Chunk
+    {
+        int length;
+        QByteArray compressed;
+    };
+
+    mutable QVector<Chunk> chunks;
+    QVector<int> chunkStarts;
+    int textLength = 0;
+    mutable qint64 compressedBytes = 0;
+    mutable int unpackedChunk = -1;
+    mutable QString unpackedText;
+
+    static const int chunkLength = 1 << 16;
+    static const qint64 minimumReclaimedBytes = 1024 * 1024;
+};
+
+#endif // UNDOHISTORY_H
@@ -2,6 +2,48 @@
 #include <QStack>
 #include <QtDebug>
 #include <QQueue>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+
+#if defined(Q_OS_WIN)
+#   include <windows.h>
+#   include <psapi.h>
+#elif defined(Q_OS_MACOS)
+#   include <sys/resource.h>
+#   include <mach/mach.h>
+#elif defined(Q_OS_UNIX) && !defined(Q_OS_LINUX)
+#   include <sys/resource.h>
+#endif
+
+#if defined(Q_OS_UNIX)
+#   include <sys/stat.h>
+#endif
+
+
+#if defined(Q_OS_LINUX)
+namespace
+{
+    // Returns a memory figure from /proc/self/status (given as "VmHWM:   123456 kB"), in bytes
+    qint64 memoryStatus(const QByteArray &field)
+    {
+        QFile status("/proc/self/status");
+        if(!status.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            return -1;
+        }
+
+        foreach(const QByteArray &line, status.readAll().split('\n'))
+        {
+            if(line.startsWith(field + ':'))
+            {
+                return line.mid(field.size() + 1).trimmed().split(' ').first().toLongLong() * 1024;
+            }
+        }
+        return -1;
+    }
+}
+#endif
 
 
 /* Launches a Yes or No message box within the context of the given
@@ -39,3 +81,121 @@ bool Utility::closingBraceNeeded(QString context)
 
     return !openingBraces.empty();
 }
+
+
+/* Returns the largest amount of physical memory this process has used since it started
+ * (or since resetPeakResidentSetSize last succeeded), in bytes, or -1 if the platform
+ * doesn't report it.
+ */
+qint64 Utility::peakResidentSetSize()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return static_cast<qint64>(counters.PeakWorkingSetSize);
+    }
+    return -1;
+#elif defined(Q_OS_LINUX)
+    return memoryStatus("VmHWM");
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#   if defined(Q_OS_MACOS)
+        return static_cast<qint64>(usage.ru_maxrss);
+#   else
+        // The BSDs and other Unixes report it in kilobytes
+        return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#   endif
+    }
+    return -1;
+#else
+    return -1;
+#endif
+}
+
+
+/* Starts measuring peakResidentSetSize afresh from the memory in use now. Only Linux
+ * allows this; returns false if the peak can't be reset.
+ */
+bool Utility::resetPeakResidentSetSize()
+{
+#if defined(Q_OS_LINUX)
+    QFile clearRefs("/proc/self/clear_refs");
+    return clearRefs.open(QIODevice::WriteOnly) && clearRefs.write("5") == 1;
+#else
+    return false;
+#endif
+}
+
+
+/* Returns the amount of physical memory this process is using right now, in bytes, or
+ * -1 if the platform doesn't report it.
+ */
+qint64 Utility::residentSetSize()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return static_cast<qint64>(counters.WorkingSetSize);
+    }
+    return -1;
+#elif defined(Q_OS_LINUX)
+    return memoryStatus("VmRSS");
+#elif defined(Q_OS_MACOS)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+    {
+        return static_cast<qint64>(info.resident_size);
+    }
+    return -1;
+#else
+    return -1;
+#endif
+}
+
+
+/* Returns a number that identifies the file at the given path itself rather than its
+ * name, so that a new file created under the same name (after the old one was renamed
+ * away, say) gets a different one: its file index on Windows, its inode number (mixed
+ * with its device) on Unix, and its creation time elsewhere. Returns 0 if the file
+ * doesn't exist or the number can't be had.
+ */
+quint64 Utility::fileIdentity(const QString &filePath)
+{
+#if defined(Q_OS_WIN)
+    HANDLE handle = CreateFileW(reinterpret_cast<const wchar_t*>(filePath.utf16()), FILE_READ_ATTRIBUTES,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if(handle == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+
+    BY_HANDLE_FILE_INFORMATION information;
+    bool succeeded = GetFileInformationByHandle(handle, &information) != 0;
+    CloseHandle(handle);
+    return succeeded ? (quint64(information.nFileIndexHigh) << 32) | information.nFileIndexLow : 0;
+#elif defined(Q_OS_UNIX)
+    struct stat status;
+    if(stat(QFile::encodeName(filePath).constData(), &status) != 0)
+    {
+        return 0;
+    }
+    return quint64(status.st_ino) ^ (quint64(status.st_dev) << 48);
+#else
+    QFileInfo fileInfo(filePath);
+    return fileInfo.exists() ? quint64(fileInfo.created().toMSecsSinceEpoch()) : 0;
+#endif
+}
+
+
+/* Formats the given number of bytes as megabytes with one decimal place (e.g., "12.5 MB").
+ */
+QString Utility::toMegabytes(qint64 bytes)
+{
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+}
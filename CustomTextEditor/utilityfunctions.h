@@ -8,6 +8,11 @@ namespace Utility
 {
     QMessageBox::StandardButton promptYesOrNo(QWidget *parent, QString title, QString prompt);
     bool closingBraceNeeded(QString context);
+    qint64 peakResidentSetSize();
+    bool resetPeakResidentSetSize();
+    qint64 residentSetSize();
+    quint64 fileIdentity(const QString &filePath);
+    QString toMegabytes(qint64 bytes);
 }
 
 #endif // UTILITYFUNCTIONS_H
@@ -0,0 +1,226 @@
+#include "watchlist.h"
+#include "searchpattern.h"
+#include <QTextBlock>
+#include <QtConcurrent>
+#include <algorithm>
+
+
+/* Creates an empty watch list for the given document.
+ */
+WatchList::WatchList(QTextDocument *document, QObject *parent) : QObject(parent), document(document)
+{
+    connect(document, SIGNAL(contentsChange(int, int, int)), this, SLOT(on_contentsChange(int, int, int)));
+    connect(&scanWatcher, SIGNAL(finished()), this, SLOT(on_scanFinished()));
+}
+
+
+/* Stops a scan in progress, and waits for it before the list goes away.
+ */
+WatchList::~WatchList()
+{
+    cancelScan();
+    scanWatcher.waitForFinished();
+}
+
+
+/* Starts watching for the given patterns instead of the current ones. An empty list
+ * stops watching altogether.
+ * @param patterns - the literal patterns to search for
+ * @param caseSensitive - flag denoting whether the search should heed the case of results
+ */
+void WatchList::setPatterns(const QStringList &patterns, bool caseSensitive)
+{
+    cancelScan();
+    this->patterns = patterns;
+    matches.clear();
+    counts.fill(0, patterns.size());
+    ready = false;
+
+    if(patterns.isEmpty())
+    {
+        searcher.clear();
+        emit(updated());
+        return;
+    }
+
+    searcher = QSharedPointer<MultiPatternSearcher>::create(patterns, caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+    startScan();
+}
+
+
+/* Searches a snapshot of the whole document for all of the patterns on a worker thread.
+ */
+void WatchList::startScan()
+{
+    cancelScan();
+    scanCancelled = QSharedPointer<QAtomicInt>::create(0);
+    scannedEdits = edits;
+    scanWatcher.setFuture(QtConcurrent::run(&WatchList::scan, searcher, SearchPattern::searchableText(document), scanCancelled));
+}
+
+
+/* Tells the scan in progress, if any, to stop; its result is ignored.
+ */
+void WatchList::cancelScan()
+{
+    if(scanCancelled)
+    {
+        scanCancelled->store(1);
+    }
+}
+
+
+QVector<WatchList::Match> WatchList::scan(QSharedPointer<MultiPatternSearcher> searcher, QString text, QSharedPointer<QAtomicInt> cancelled)
+{
+    return searcher->findAll(text, cancelled.data());
+}
+
+
+/* Called whenever the document changes. Drops the occurrences in the blocks that were
+ * touched, shifts the ones after them, and rescans just those blocks.
+ * @param position - where the change happened
+ * @param charsRemoved - the number of characters removed there
+ * @param charsAdded - the number of characters added there
+ */
+void WatchList::on_contentsChange(int position, int charsRemoved, int charsAdded)
+{
+    edits++;
+
+    // Without a finished scan there's nothing to update; a scan in progress starts over once it's done
+    if(!searcher || !ready)
+    {
+        return;
+    }
+
+    QTextBlock firstBlock = document->findBlock(position);
+    QTextBlock lastBlock = document->findBlock(position + charsAdded);
+    if(!firstBlock.isValid())
+    {
+        firstBlock = document->lastBlock();
+    }
+    if(!lastBlock.isValid())
+    {
+        lastBlock = document->lastBlock();
+    }
+
+    const int start = firstBlock.position();
+    const int delta = charsAdded - charsRemoved;
+    const int oldEnd = lastBlock.position() + lastBlock.length() - delta;
+
+    const int firstIndex = static_cast<int>(firstMatchAtOrAfter(start) - matches.constBegin());
+    int lastIndex = firstIndex;
+    while(lastIndex < matches.size() && matches.at(lastIndex).position < oldEnd)
+    {
+        counts[matches.at(lastIndex).pattern]--;
+        lastIndex++;
+    }
+    matches.remove(firstIndex, lastIndex - firstIndex);
+
+    for(int i = firstIndex; i < matches.size(); i++)
+    {
+        matches[i].position += delta;
+    }
+
+    QString text;
+    for(QTextBlock block = firstBlock; block.isValid(); block = block.next())
+    {
+        text += block.text();
+        if(block == lastBlock)
+        {
+            break;
+        }
+        text += QLatin1Char('\n');
+    }
+
+    QVector<Match> found = searcher->findAll(text);
+    for(Match &match : found)
+    {
+        match.position += start;
+        counts[match.pattern]++;
+    }
+    matches.insert(firstIndex, found.size(), Match());
+    std::copy(found.constBegin(), found.constEnd(), matches.begin() + firstIndex);
+
+    emit(updated());
+}
+
+
+/* Called when the worker thread is done scanning. Scans again if the document was
+ * edited in the meantime; otherwise, keeps the matches and counts them per pattern, and
+ * from then on follows edits incrementally.
+ */
+void WatchList::on_scanFinished()
+{
+    if(scanCancelled->load() != 0)
+    {
+        return;
+    }
+
+    if(edits != scannedEdits)
+    {
+        startScan();
+        return;
+    }
+
+    matches = scanWatcher.result();
+    ready = true;
+    counts.fill(0, patterns.size());
+    for(const Match &match : matches)
+    {
+        counts[match.pattern]++;
+    }
+
+    emit(updated());
+}
+
+
+/* Returns the occurrences that start at or after the first position, and before the second.
+ */
+QVector<WatchList::Match> WatchList::matchesBetween(int from, int to) const
+{
+    QVector<Match>::const_iterator first = firstMatchAtOrAfter(from);
+    QVector<Match>::const_iterator last = first;
+    while(last != matches.constEnd() && last->position < to)
+    {
+        last++;
+    }
+
+    return matches.mid(static_cast<int>(first - matches.constBegin()), static_cast<int>(last - first));
+}
+
+
+/* Returns the first occurrence of the given pattern that starts at or after the given
+ * position, or one with a position of -1 if there is none.
+ */
+WatchList::Match WatchList::nextMatch(int pattern, int position) const
+{
+    for(QVector<Match>::const_iterator match = firstMatchAtOrAfter(position); match != matches.constEnd(); match++)
+    {
+        if(match->pattern == pattern)
+        {
+            return *match;
+        }
+    }
+    return Match{-1, 0, pattern};
+}
+
+
+/* Binary searches the occurrences for the first one that starts at or after the given position.
+ */
+QVector<WatchList::Match>::const_iterator WatchList::firstMatchAtOrAfter(int position) const
+{
+    return std::lower_bound(matches.constBegin(), matches.constEnd(), position,
+                            [](const Match &match, int position) { return match.position < position; });
+}
+
+
+/* Returns the color the occurrences of the pattern with the given index are highlighted in.
+ */
+QColor WatchList::colorFor(int pattern)
+{
+    static const QColor colors[] = {QColor(255, 179, 179), QColor(179, 217, 255), QColor(179, 255, 179),
+                                    QColor(255, 217, 153), QColor(217, 179, 255), QColor(153, 238, 238),
+                                    QColor(255, 179, 230), QColor(221, 221, 153), QColor(204, 204, 204),
+                                    QColor(255, 204, 153), QColor(179, 204, 153), QColor(153, 187, 255)};
+    return colors[pattern % (sizeof(colors) / sizeof(colors[0]))];
+}
@@ -0,0 +1,70 @@
+#ifndef WATCHLIST_H
+#define WATCHLIST_H
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+#include <QColor>
+#include <QTextDocument>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include "multipatternsearcher.h"
+
+
+/* Keeps the sorted positions of every occurrence of a list of literal patterns in a
+ * document, and how many occurrences each pattern has. The whole document is searched
+ * for all of the patterns in a single pass, on a worker thread, when the list changes.
+ * After that, each edit only rescans the blocks it touched and shifts the occurrences
+ * after them, the way MatchIndex does; patterns are single lines, so occurrences never
+ * span blocks. Edits made during a scan start another once it's done.
+ */
+class WatchList : public QObject
+{
+    Q_OBJECT
+
+public:
+    WatchList(QTextDocument *document, QObject *parent = nullptr);
+    ~WatchList() override;
+
+    typedef MultiPatternSearcher::Match Match;
+
+    void setPatterns(const QStringList &patterns, bool caseSensitive);
+    inline QStringList getPatterns() const { return patterns; }
+    inline QVector<int> getCounts() const { return counts; }
+    inline bool isEmpty() const { return patterns.isEmpty(); }
+
+    QVector<Match> matchesBetween(int from, int to) const;
+    Match nextMatch(int pattern, int position) const;
+    static QColor colorFor(int pattern);
+
+signals:
+    void updated();
+
+private slots:
+    void on_contentsChange(int position, int charsRemoved, int charsAdded);
+    void on_scanFinished();
+
+private:
+    void startScan();
+    void cancelScan();
+    QVector<Match>::const_iterator firstMatchAtOrAfter(int position) const;
+
+    static QVector<Match> scan(QSharedPointer<MultiPatternSearcher> searcher, QString text, QSharedPointer<QAtomicInt> cancelled);
+
+    QTextDocument *document;
+    QStringList patterns;
+    QSharedPointer<MultiPatternSearcher> searcher;
+
+    QVector<Match> matches;
+    QVector<int> counts;
+    bool ready = false;
+
+    // Edits are counted here rather than read from QTextDocument::revision, which isn't
+    // maintained while undo is disabled (see UndoHistory)
+    int edits = 0;
+    int scannedEdits = -1;
+    QFutureWatcher<QVector<Match>> scanWatcher;
+    QSharedPointer<QAtomicInt> scanCancelled;
+};
+
+#endif // WATCHLIST_H
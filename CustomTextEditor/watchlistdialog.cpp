@@ -0,0 +1,156 @@
+#include "watchlistdialog.h"
+#include "watchlist.h"
+#include "fileloader.h"
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QPixmap>
+#include <QIcon>
+#include <QLocale>
+#include <QSet>
+
+
+/* Initializes this WatchListDialog object.
+ */
+WatchListDialog::WatchListDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    // Initialize all members
+    patternsLabel = new QLabel(tr("Watch for (one per line):"));
+    patternsEdit = new QPlainTextEdit();
+    countsList = new QListWidget();
+    loadButton = new QPushButton(tr("&Load from file..."));
+    watchButton = new QPushButton(tr("&Watch"));
+    clearButton = new QPushButton(tr("&Clear"));
+    caseSensitiveCheckBox = new QCheckBox(tr("&Match case"));
+
+    patternsEdit->setLineWrapMode(QPlainTextEdit::NoWrap);
+    countsList->setToolTip(tr("Double-click a pattern to jump to its next occurrence"));
+
+    setFocusProxy(patternsEdit);
+
+    // Set up all the widgets and layouts
+    buttonsLayout = new QHBoxLayout();
+    verticalLayout = new QVBoxLayout();
+
+    verticalLayout->addWidget(patternsLabel);
+    verticalLayout->addWidget(patternsEdit);
+    verticalLayout->addLayout(buttonsLayout);
+    verticalLayout->addWidget(countsList);
+
+    buttonsLayout->addWidget(caseSensitiveCheckBox);
+    buttonsLayout->addWidget(loadButton);
+    buttonsLayout->addWidget(watchButton);
+    buttonsLayout->addWidget(clearButton);
+
+    setLayout(verticalLayout);
+    setWindowTitle(tr("Watch List"));
+
+    connect(watchButton, SIGNAL(clicked()), this, SLOT(on_watchButton_clicked()));
+    connect(clearButton, SIGNAL(clicked()), this, SLOT(on_clearButton_clicked()));
+    connect(loadButton, SIGNAL(clicked()), this, SLOT(on_loadButton_clicked()));
+    connect(countsList, SIGNAL(itemActivated(QListWidgetItem*)), this, SLOT(on_countsList_activated(QListWidgetItem*)));
+}
+
+
+/* Performs all required memory cleanup operations.
+ */
+WatchListDialog::~WatchListDialog()
+{
+    delete patternsLabel;
+    delete patternsEdit;
+    delete countsList;
+    delete loadButton;
+    delete watchButton;
+    delete clearButton;
+    delete caseSensitiveCheckBox;
+    delete buttonsLayout;
+    delete verticalLayout;
+}
+
+
+/* Called when the user clicks the Watch button. Emits startWatching with the non-empty
+ * lines of the patterns field, each one only once.
+ */
+void WatchListDialog::on_watchButton_clicked()
+{
+    bool caseSensitive = caseSensitiveCheckBox->isChecked();
+    QStringList patterns;
+    QSet<QString> seen;
+
+    for(const QString &line : patternsEdit->toPlainText().split(QLatin1Char('\n')))
+    {
+        QString key = caseSensitive ? line : line.toCaseFolded();
+
+        if(!line.isEmpty() && !seen.contains(key))
+        {
+            seen.insert(key);
+            patterns.append(line);
+        }
+    }
+
+    if(patterns.isEmpty())
+    {
+        QMessageBox::information(this, tr("Empty Field"), tr("Please enter at least one pattern."));
+        return;
+    }
+
+    emit(startWatching(patterns, caseSensitive));
+}
+
+
+/* Called when the user clicks the Clear button. Stops watching.
+ */
+void WatchListDialog::on_clearButton_clicked()
+{
+    emit(startWatching(QStringList(), caseSensitiveCheckBox->isChecked()));
+}
+
+
+/* Called when the user clicks the Load from file button. Fills the patterns field with
+ * the contents of the file the user picks, one pattern per line.
+ */
+void WatchListDialog::on_loadButton_clicked()
+{
+    QString filePath = QFileDialog::getOpenFileName(this, tr("Load Watch List"));
+
+    if(filePath.isNull())
+    {
+        return;
+    }
+
+    QString text;
+    QString errorString;
+    if(!FileLoader::readAll(filePath, &text, &errorString))
+    {
+        QMessageBox::warning(this, "Warning", "Cannot open file: " + errorString);
+        return;
+    }
+
+    patternsEdit->setPlainText(text);
+}
+
+
+/* Lists the watched patterns in their highlight colors, with how many times each occurs.
+ * @param patterns - the watched patterns
+ * @param counts - the number of occurrences of each pattern
+ */
+void WatchListDialog::onWatchListCountsReady(QStringList patterns, QVector<int> counts)
+{
+    QLocale locale;
+    countsList->clear();
+
+    for(int i = 0; i < patterns.size() && i < counts.size(); i++)
+    {
+        QPixmap swatch(12, 12);
+        swatch.fill(WatchList::colorFor(i));
+        countsList->addItem(new QListWidgetItem(QIcon(swatch), tr("%1: %2").arg(locale.toString(counts.at(i)), patterns.at(i))));
+    }
+}
+
+
+/* Called when the user double-clicks a pattern (or hits Enter on it).
+ */
+void WatchListDialog::on_countsList_activated(QListWidgetItem *item)
+{
+    emit(findWatched(countsList->row(item)));
+}
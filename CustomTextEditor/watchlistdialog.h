@@ -0,0 +1,53 @@
+#ifndef WATCHLISTDIALOG_H
+#define WATCHLISTDIALOG_H
+#include <QDialog>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPlainTextEdit>
+#include <QListWidget>
+#include <QPushButton>
+#include <QCheckBox>
+#include <QLabel>
+#include <QLayout>
+
+class WatchListDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+
+    WatchListDialog(QWidget *parent = nullptr);
+    ~WatchListDialog();
+
+signals:
+
+    void startWatching(QStringList patterns, bool caseSensitive);
+    void findWatched(int pattern);
+
+public slots:
+
+    void onWatchListCountsReady(QStringList patterns, QVector<int> counts);
+
+private slots:
+
+    void on_watchButton_clicked();
+    void on_clearButton_clicked();
+    void on_loadButton_clicked();
+    void on_countsList_activated(QListWidgetItem *item);
+
+private:
+
+    QLabel *patternsLabel;
+    QPlainTextEdit *patternsEdit;
+    QListWidget *countsList;
+    QPushButton *loadButton;
+    QPushButton *watchButton;
+    QPushButton *clearButton;
+    QCheckBox *caseSensitiveCheckBox;
+
+    QHBoxLayout *buttonsLayout;
+    QVBoxLayout *verticalLayout;
+};
+
+#endif // WATCHLISTDIALOG_H
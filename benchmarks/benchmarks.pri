@@ -0,0 +1,17 @@
+# Settings shared by every benchmark. EDITOR is the directory of the
+# editor's sources, which the benchmarks compile in directly.
+
+QT       += core gui
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+EDITOR = $$PWD/../CustomTextEditor
+INCLUDEPATH += $$EDITOR $$PWD/common
+
+SOURCES += \
+    $$PWD/common/benchmark.cpp
+
+HEADERS += \
+    $$PWD/common/benchmark.h
@@ -0,0 +1,15 @@
+#-------------------------------------------------
+#
+# Benchmarks for the editor's text engines. Each one is a
+# console program that prints a table; build them with
+# qmake && make from this directory.
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    textcounter \
+    literalsearch \
+    lexer \
+    piecetable
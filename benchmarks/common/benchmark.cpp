@@ -0,0 +1,157 @@
+#include "benchmark.h"
+#include <QElapsedTimer>
+#include <QtAlgorithms>
+#include <limits>
+
+
+namespace
+{
+    const int columnWidth = 14;
+}
+
+
+/* Runs the given work the given number of times and returns the fastest run's duration,
+ * which is the one least disturbed by the rest of the system.
+ * @param runs - how often to run the work
+ * @param work - the work to time
+ */
+double Benchmark::bestMilliseconds(int runs, const std::function<void()> &work)
+{
+    double best = std::numeric_limits<double>::max();
+    QElapsedTimer timer;
+
+    for(int run = 0; run < runs; run++)
+    {
+        timer.start();
+        work();
+        best = qMin(best, timer.nsecsElapsed() / 1e6);
+    }
+
+    return best;
+}
+
+
+/* Returns the given number of characters of text that looks roughly like source code:
+ * indented lines of identifiers, numbers, operators, strings and comments, with the odd
+ * non-ASCII word. A 64K block is generated once and repeated to fill the length.
+ */
+QString Benchmark::sampleText(int length)
+{
+    static const char *const tokens[] =
+    {
+        "int", "return", "value", "count", "Widget", "std::vector<int>", "i", "42", "0x1F",
+        "(", ")", "{", "}", ";", ",", "=", "+=", "->", "\"text\"", "// note", "/* block */",
+        "gr\xc3\xb6\xc3\x9f" "e", "na\xc3\xaf" "ve", "\xe6\x95\xb0\xe6\x8d\xae", "if", "while", "nullptr"
+    };
+    static const int tokenCount = int(sizeof(tokens) / sizeof(tokens[0]));
+    static const int blockLength = 64 * 1024;
+
+    Benchmark::Random random(1);
+    QString block;
+    block.reserve(blockLength + 256);
+
+    while(block.length() < blockLength)
+    {
+        block += QString(4 * random.below(4), ' ');
+
+        for(int words = 3 + random.below(8); words > 0; words--)
+        {
+            block += QString::fromUtf8(tokens[random.below(tokenCount)]);
+            block += words > 1 ? QChar(' ') : QChar('\n');
+        }
+    }
+
+    QString text;
+    text.reserve(length);
+
+    while(text.length() + block.length() <= length)
+    {
+        text += block;
+    }
+
+    text += block.left(length - text.length());
+    return text;
+}
+
+
+/* Returns the sizes, in megabytes, given on the command line, or the given defaults if
+ * there are none.
+ */
+QList<int> Benchmark::megabytesFromArguments(const QStringList &arguments, const QList<int> &defaults)
+{
+    QList<int> megabytes;
+
+    for(int i = 1; i < arguments.size(); i++)
+    {
+        bool isNumber = false;
+        int size = arguments[i].toInt(&isNumber);
+
+        if(isNumber && size > 0)
+        {
+            megabytes.append(size);
+        }
+    }
+
+    return megabytes.isEmpty() ? defaults : megabytes;
+}
+
+
+/* Returns how often to repeat work over the given number of bytes: small inputs often
+ * enough to time them reliably, large ones only once.
+ */
+int Benchmark::runsFor(qint64 bytes)
+{
+    if(bytes <= 4 * 1024 * 1024)
+    {
+        return 20;
+    }
+    return bytes <= 256 * 1024 * 1024 ? 3 : 1;
+}
+
+
+QString Benchmark::milliseconds(double milliseconds)
+{
+    return QString::number(milliseconds, 'f', milliseconds < 10 ? 3 : 1) + " ms";
+}
+
+
+/* Formats the rate at which the given number of bytes was processed, in GB/s. */
+QString Benchmark::throughput(qint64 bytes, double milliseconds)
+{
+    if(milliseconds <= 0)
+    {
+        return "-";
+    }
+    return QString::number(bytes / (milliseconds * 1e6), 'f', 2) + " GB/s";
+}
+
+
+/* Formats how many times faster the measured time is than the baseline. */
+QString Benchmark::ratio(double baseline, double measured)
+{
+    if(measured <= 0)
+    {
+        return "-";
+    }
+    return QString::number(baseline / measured, 'f', 1) + "x";
+}
+
+
+/* Prints one row of a table, each column left-aligned in a fixed width.
+ */
+void Benchmark::printRow(const QStringList &columns)
+{
+    for(const QString &column : columns)
+    {
+        out() << column.leftJustified(columnWidth - 1) << ' ';
+    }
+    out() << endl;
+}
+
+
+/* Returns a stream that writes to standard output. */
+QTextStream &Benchmark::out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
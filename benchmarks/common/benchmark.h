@@ -0,0 +1,41 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <functional>
+
+
+/* Helpers shared by the benchmarks: timing a piece of work, generating text to run it on
+ * and printing the results as a table.
+ */
+namespace Benchmark
+{
+    /* A small linear congruential generator, so that every run (and every platform) makes
+     * the same sample text and picks the same positions.
+     */
+    class Random
+    {
+    public:
+        explicit Random(quint64 seed) : state(seed) {}
+        inline int below(int bound) { state = state * 6364136223846793005ull + 1442695040888963407ull; return int((state >> 33) % quint64(bound)); }
+
+    private:
+        quint64 state;
+    };
+
+    double bestMilliseconds(int runs, const std::function<void()> &work);
+    QString sampleText(int length);
+    QList<int> megabytesFromArguments(const QStringList &arguments, const QList<int> &defaults);
+    int runsFor(qint64 bytes);
+
+    QString milliseconds(double milliseconds);
+    QString throughput(qint64 bytes, double milliseconds);
+    QString ratio(double baseline, double measured);
+    void printRow(const QStringList &columns);
+
+    QTextStream &out();
+}
+
+#endif // BENCHMARK_H
@@ -0,0 +1,23 @@
+include(../benchmarks.pri)
+
+TARGET = lexerbenchmark
+TEMPLATE = app
+
+SOURCES += \
+    main.cpp \
+    regexhighlighter.cpp \
+    $$EDITOR/keywordtable.cpp \
+    $$EDITOR/lexer.cpp \
+    $$EDITOR/grammar.cpp \
+    $$EDITOR/language.cpp
+
+HEADERS += \
+    regexhighlighter.h \
+    $$EDITOR/keywordtable.h \
+    $$EDITOR/lexer.h \
+    $$EDITOR/grammar.h \
+    $$EDITOR/language.h
+
+# The language definitions
+RESOURCES += \
+    $$EDITOR/resources.qrc
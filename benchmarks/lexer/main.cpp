@@ -0,0 +1,251 @@
+#include "benchmark.h"
+#include "grammar.h"
+#include "regexhighlighter.h"
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <algorithm>
+
+
+/* Compares the Lexer with the regular expression rules it replaced, on the source files
+ * (or directories of them) given on the command line, and times both. Files are picked
+ * by extension from the languages the old rules covered: C, C++, Java and Python. For
+ * each file it prints how many lines the two highlight differently, and with
+ * --differences it prints those lines too, marking each character's style underneath:
+ * k for keywords, c for class names, f for function names, s for strings and comments.
+ *
+ * The lexer doesn't reproduce what the overlapping rules got wrong, so some lines are
+ * expected to differ:
+ *  - ".*" colored everything from the first double quote on a line to the last.
+ *  - Comment delimiters inside strings started comments.
+ *  - C++-only keywords were bold even inside strings and comments, as their rules came
+ *    after every other.
+ *  - Character literals with more than one character after the backslash, such as
+ *    '\xFF', weren't colored as strings.
+ *  - "operator(" and "catch(" were keywords in C++, not functions.
+ *  - Python's ''' never spanned lines: its start and end patterns matched the same quotes.
+ */
+namespace
+{
+    struct SourceFile
+    {
+        QString path;
+        QString language;
+        QStringList lines;
+    };
+
+    typedef QVector<RegexHighlighter::Style> Styles;
+
+
+    /* Lexes one line and styles its characters by the tokens found, the way the
+     * highlighter formats them. Returns the state the line ends in.
+     */
+    int lexLine(const Lexer &lexer, const QString &text, int state, QVector<Lexer::Token> *tokens, Styles *styles)
+    {
+        tokens->clear();
+        state = lexer.tokenize(text, state, tokens);
+        styles->fill(RegexHighlighter::Plain, text.length());
+
+        for(const Lexer::Token &token : *tokens)
+        {
+            std::fill(styles->begin() + token.start, styles->begin() + token.start + token.length, RegexHighlighter::styleOf(token.type));
+        }
+
+        return state;
+    }
+
+
+    /* Returns a line with one letter per character standing for its style. */
+    QString marks(const Styles &styles)
+    {
+        static const char letters[] = {' ', 'k', 'c', 'f', 's'};
+        QString line;
+
+        for(RegexHighlighter::Style style : styles)
+        {
+            line += QChar(letters[style]);
+        }
+
+        return line;
+    }
+
+
+    /* Maps the extensions of every language the old rules covered to that language. */
+    QHash<QString, QString> languagesByExtension()
+    {
+        QHash<QString, QString> languages;
+
+        for(const QString &language : Grammar::languages())
+        {
+            if(RegexHighlighter::supports(language))
+            {
+                for(const QString &extension : Grammar::of(language)->getExtensions())
+                {
+                    languages.insert(extension, language);
+                }
+            }
+        }
+
+        return languages;
+    }
+
+
+    /* Reads the given files, and every file under the given directories, in a language
+     * the old rules covered.
+     */
+    QList<SourceFile> readSources(const QStringList &paths)
+    {
+        const QHash<QString, QString> languages = languagesByExtension();
+        QStringList filePaths;
+        QList<SourceFile> sources;
+
+        for(const QString &path : paths)
+        {
+            if(QFileInfo(path).isDir())
+            {
+                QDirIterator iterator(path, QDir::Files, QDirIterator::Subdirectories);
+                while(iterator.hasNext())
+                {
+                    filePaths.append(iterator.next());
+                }
+            }
+            else
+            {
+                filePaths.append(path);
+            }
+        }
+
+        for(const QString &filePath : filePaths)
+        {
+            QFile file(filePath);
+            const QString language = languages.value(QFileInfo(filePath).suffix().toLower());
+
+            if(language.isEmpty() || !file.open(QIODevice::ReadOnly))
+            {
+                continue;
+            }
+
+            SourceFile source = {filePath, language, QString::fromUtf8(file.readAll()).remove('\r').split('\n')};
+            sources.append(source);
+        }
+
+        return sources;
+    }
+
+
+    /* Highlights every line of the given file both ways and returns how many lines came
+     * out differently, printing them if asked to.
+     */
+    int countDifferences(const SourceFile &source, const RegexHighlighter &rules, const Lexer &lexer, bool printDifferences)
+    {
+        QVector<Lexer::Token> tokens;
+        Styles oldStyles, newStyles;
+        int oldState = 0, newState = Lexer::Normal;
+        int differences = 0;
+
+        for(int i = 0; i < source.lines.size(); i++)
+        {
+            const QString &line = source.lines[i];
+            oldState = rules.highlight(line, oldState, &oldStyles);
+            newState = lexLine(lexer, line, newState, &tokens, &newStyles);
+
+            if(oldStyles != newStyles)
+            {
+                differences++;
+
+                if(printDifferences)
+                {
+                    Benchmark::out() << source.path << ':' << i + 1 << endl
+                                     << "  text:  " << QString(line).replace('\t', ' ') << endl
+                                     << "  rules: " << marks(oldStyles) << endl
+                                     << "  lexer: " << marks(newStyles) << endl;
+                }
+            }
+        }
+
+        return differences;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QStringList paths = application.arguments().mid(1);
+    const bool printDifferences = paths.removeAll("--differences") > 0;
+
+    for(const QString &error : Grammar::loadErrors())
+    {
+        Benchmark::out() << error << endl;
+    }
+
+    const QList<SourceFile> sources = readSources(paths);
+
+    if(sources.isEmpty())
+    {
+        Benchmark::out() << "Usage: lexerbenchmark [--differences] <source files or directories...>" << endl;
+        return 1;
+    }
+
+    QHash<QString, RegexHighlighter*> rulesByLanguage;
+    int lineCount = 0, differenceCount = 0;
+    qint64 bytes = 0;
+
+    for(const SourceFile &source : sources)
+    {
+        if(!rulesByLanguage.contains(source.language))
+        {
+            rulesByLanguage.insert(source.language, new RegexHighlighter(source.language));
+        }
+
+        int differences = countDifferences(source, *rulesByLanguage[source.language], Grammar::of(source.language)->getLexer(), printDifferences);
+        Benchmark::out() << source.path << ": " << differences << " of " << source.lines.size() << " lines differ" << endl;
+
+        lineCount += source.lines.size();
+        differenceCount += differences;
+
+        for(const QString &line : source.lines)
+        {
+            bytes += (line.length() + 1) * int(sizeof(QChar));
+        }
+    }
+
+    // Time both over every file, without comparing
+    QVector<Lexer::Token> tokens;
+    Styles styles;
+
+    double rulesTime = Benchmark::bestMilliseconds(5, [&]{
+        for(const SourceFile &source : sources)
+        {
+            const RegexHighlighter &rules = *rulesByLanguage[source.language];
+            int state = 0;
+            for(const QString &line : source.lines)
+            {
+                state = rules.highlight(line, state, &styles);
+            }
+        }
+    });
+
+    double lexerTime = Benchmark::bestMilliseconds(5, [&]{
+        for(const SourceFile &source : sources)
+        {
+            const Lexer &lexer = Grammar::of(source.language)->getLexer();
+            int state = Lexer::Normal;
+            for(const QString &line : source.lines)
+            {
+                state = lexLine(lexer, line, state, &tokens, &styles);
+            }
+        }
+    });
+
+    qDeleteAll(rulesByLanguage);
+
+    Benchmark::out() << endl << sources.size() << " files, " << differenceCount << " of " << lineCount << " lines differ" << endl << endl;
+    Benchmark::printRow({"", "Time", "Throughput", "Speedup"});
+    Benchmark::printRow({"Regex rules", Benchmark::milliseconds(rulesTime), Benchmark::throughput(bytes, rulesTime), ""});
+    Benchmark::printRow({"Lexer", Benchmark::milliseconds(lexerTime), Benchmark::throughput(bytes, lexerTime), Benchmark::ratio(rulesTime, lexerTime)});
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "regexhighlighter.h"
+#include <algorithm>
+
+
+namespace
+{
+    const QStringList cKeywords =
+    {
+        "auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else",
+        "enum", "extern", "float", "for", "goto", "if", "int", "long", "register", "return",
+        "short", "signed", "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned",
+        "void", "volatile", "while"
+    };
+
+    const QStringList cppOnlyKeywords =
+    {
+        "asm", "bool", "catch", "class", "const_cast", "delete", "dynamic_cast", "explicit",
+        "false", "friend", "inline", "mutable", "namespace", "new", "operator", "private",
+        "protected", "public", "reinterpret_cast", "static_cast", "template", "this", "throw",
+        "true", "try", "typeid", "typename", "virtual", "using", "wchar_t"
+    };
+
+    const QStringList javaKeywords =
+    {
+        "abstract", "assert", "boolean", "break", "byte", "case", "catch", "char", "class",
+        "const", "continue", "default", "do", "double", "else", "enum", "extends", "final",
+        "finally", "float", "for", "goto", "if", "implements", "import", "instanceof", "int",
+        "interface", "long", "native", "new", "package", "private", "protected", "public",
+        "return", "short", "static", "strictfp", "super", "switch", "synchronized", "this",
+        "throw", "throws", "transient", "try", "void", "volatile", "while", "true", "false", "null"
+    };
+
+    const QStringList pythonKeywords =
+    {
+        "and", "as", "assert", "break", "class", "continue", "def", "del", "elif", "else",
+        "except", "False", "finally", "for", "from", "global", "if", "import", "in", "is",
+        "lambda", "None", "nonlocal", "not", "or", "pass", "raise", "return", "True", "try",
+        "while", "with", "yield"
+    };
+}
+
+
+/* Returns whether the old highlighter had rules for the language with the given name.
+ */
+bool RegexHighlighter::supports(const QString &language)
+{
+    return language == "C" || language == "C++" || language == "Java" || language == "Python";
+}
+
+
+/* Returns the style the Lexer's tokens of the given type are shown in.
+ */
+RegexHighlighter::Style RegexHighlighter::styleOf(Lexer::TokenType type)
+{
+    switch(type)
+    {
+        case(Lexer::Keyword): return Keyword;
+        case(Lexer::ClassName): return ClassName;
+        case(Lexer::FunctionName): return FunctionName;
+        default: return Green;
+    }
+}
+
+
+/* Sets up the rules the old highlighter used for the given language, in the same order.
+ * @param language - the name of a language the old highlighter supports
+ */
+RegexHighlighter::RegexHighlighter(const QString &language)
+{
+    const bool python = language == "Python";
+
+    addKeywords(python ? pythonKeywords : language == "Java" ? javaKeywords : cKeywords);
+    addRule("\\b[A-Z_][a-zA-Z0-9_]*\\b", ClassName);
+    addRule(python ? "(\".*\")|('.*')" : "(\".*\")|('\\\\.')|('.{0,1}')", Green);
+    addRule("\\b[A-Za-z_][A-Za-z0-9_]*(?=\\()", FunctionName);
+    addRule(python ? "#.*" : "//.*", Green);
+    blockCommentStart.setPattern(python ? "'''" : "/\\*");
+    blockCommentEnd.setPattern(python ? "'''" : "\\*/");
+
+    // The C++ highlighter added its own keywords to a finished C one, after every other rule
+    if(language == "C++")
+    {
+        addKeywords(cppOnlyKeywords);
+    }
+}
+
+
+void RegexHighlighter::addKeywords(const QStringList &keywords)
+{
+    for(const QString &keyword : keywords)
+    {
+        addRule("\\b" + keyword + "\\b", Keyword);
+    }
+}
+
+
+void RegexHighlighter::addRule(const QString &pattern, Style style)
+{
+    Rule rule;
+    rule.pattern.setPattern(pattern);
+    rule.style = style;
+    rules.append(rule);
+}
+
+
+/* Styles a range of characters, clipped to the line like QSyntaxHighlighter::setFormat.
+ */
+void RegexHighlighter::setStyle(QVector<Style> *styles, int start, int count, Style style)
+{
+    if(start < 0 || start >= styles->size())
+    {
+        return;
+    }
+
+    std::fill(styles->begin() + start, styles->begin() + qMin(start + count, styles->size()), style);
+}
+
+
+/* Highlights one line the way the old highlightBlock did, and returns the state the line
+ * ends in.
+ * @param text - the line to highlight
+ * @param previousState - the state the previous line ended in
+ * @param styles - receives the style of each character
+ */
+int RegexHighlighter::highlight(const QString &text, int previousState, QVector<Style> *styles) const
+{
+    styles->fill(Plain, text.length());
+
+    for(const Rule &rule : rules)
+    {
+        QRegularExpressionMatchIterator iterator = rule.pattern.globalMatch(text);
+
+        while(iterator.hasNext())
+        {
+            QRegularExpressionMatch match = iterator.next();
+            setStyle(styles, match.capturedStart(), match.capturedLength(), rule.style);
+        }
+    }
+
+    int state = NotInComment;
+    int startIndex = previousState == InComment ? 0 : text.indexOf(blockCommentStart);
+
+    while(startIndex >= 0)
+    {
+        QRegularExpressionMatch match = blockCommentEnd.match(text, startIndex);
+        int endIndex = match.capturedStart();
+        int commentLength = 0;
+
+        if(endIndex == -1)
+        {
+            state = InComment;
+            commentLength = text.length() - startIndex;
+        }
+        else
+        {
+            commentLength = endIndex - startIndex + match.capturedLength();
+        }
+
+        setStyle(styles, startIndex, commentLength, Green);
+        startIndex = text.indexOf(blockCommentStart, startIndex + commentLength);
+    }
+
+    return state;
+}
@@ -0,0 +1,64 @@
+#ifndef REGEXHIGHLIGHTER_H
+#define REGEXHIGHLIGHTER_H
+#include "lexer.h"
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+
+/* The rules the editor highlighted C, C++, Java and Python with before it had a Lexer,
+ * ported from the old QSyntaxHighlighter subclass. Every rule is a regular expression run
+ * over the whole line, in the order the rules were added, and each match overwrites the
+ * style of whatever earlier rules matched; block comments are found last, starting from
+ * the state the previous line ended in. Instead of formatting a block, a line is
+ * highlighted into one style per character, so that the result can be compared with the
+ * Lexer's.
+ */
+class RegexHighlighter
+{
+public:
+
+    // What a character looks like. Strings and both kinds of comments share a format
+    // (dark green), so they're one style here.
+    enum Style
+    {
+        Plain,
+        Keyword,
+        ClassName,
+        FunctionName,
+        Green
+    };
+
+    static bool supports(const QString &language);
+    static Style styleOf(Lexer::TokenType type);
+
+    explicit RegexHighlighter(const QString &language);
+
+    int highlight(const QString &text, int previousState, QVector<Style> *styles) const;
+
+private:
+
+    struct Rule
+    {
+        QRegularExpression pattern;
+        Style style;
+    };
+
+    enum BlockState
+    {
+        NotInComment,
+        InComment
+    };
+
+    void addKeywords(const QStringList &keywords);
+    void addRule(const QString &pattern, Style style);
+    static void setStyle(QVector<Style> *styles, int start, int count, Style style);
+
+    QList<Rule> rules;
+    QRegularExpression blockCommentStart;
+    QRegularExpression blockCommentEnd;
+};
+
+#endif // REGEXHIGHLIGHTER_H
@@ -0,0 +1,13 @@
+include(../benchmarks.pri)
+
+TARGET = literalsearchbenchmark
+TEMPLATE = app
+
+SOURCES += \
+    main.cpp \
+    twowaysearcher.cpp \
+    $$EDITOR/literalsearcher.cpp
+
+HEADERS += \
+    twowaysearcher.h \
+    $$EDITOR/literalsearcher.h
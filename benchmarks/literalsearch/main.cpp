@@ -0,0 +1,158 @@
+#include "benchmark.h"
+#include "literalsearcher.h"
+#include "twowaysearcher.h"
+#include <QGuiApplication>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <new>
+
+
+/* Compares LiteralSearcher with the other ways of finding literal text: QTextDocument::find,
+ * which Find used before the match index existed, QString::indexOf, and the Two-Way
+ * algorithm. Every one counts the non-overlapping matches of short, medium, long and
+ * periodic needles, with and without case sensitivity, in sample text of each size given
+ * on the command line in megabytes (1 and 100 by default). The counts must agree or the
+ * benchmark fails.
+ *
+ * QTextDocument needs a QGuiApplication; run with -platform offscreen where there's no
+ * display.
+ */
+namespace
+{
+    struct Needle
+    {
+        QString name;
+        QString text;
+    };
+
+
+    /* Returns the longest line that starts within the given length of the text. */
+    QString longestLine(const QString &text, int length)
+    {
+        QString longest;
+        for(const QString &line : text.left(length).split('\n'))
+        {
+            if(line.length() > longest.length())
+            {
+                longest = line;
+            }
+        }
+        return longest;
+    }
+
+
+    /* Counts matches by searching for the next one right after the end of the last. */
+    template<typename Searcher>
+    int countMatches(const Searcher &searcher, const QString &text, int needleLength)
+    {
+        int count = 0;
+        for(int from = searcher.indexIn(text.utf16(), text.length(), 0); from >= 0;
+            from = searcher.indexIn(text.utf16(), text.length(), from + needleLength))
+        {
+            count++;
+        }
+        return count;
+    }
+
+
+    int countWithIndexOf(const QString &needle, Qt::CaseSensitivity sensitivity, const QString &text)
+    {
+        int count = 0;
+        for(int from = text.indexOf(needle, 0, sensitivity); from >= 0; from = text.indexOf(needle, from + needle.length(), sensitivity))
+        {
+            count++;
+        }
+        return count;
+    }
+
+
+    int countInDocument(const QString &needle, Qt::CaseSensitivity sensitivity, const QTextDocument &document)
+    {
+        QTextDocument::FindFlags flags = sensitivity == Qt::CaseSensitive ? QTextDocument::FindCaseSensitively : QTextDocument::FindFlags();
+        int count = 0;
+        for(QTextCursor cursor = document.find(needle, 0, flags); !cursor.isNull(); cursor = document.find(needle, cursor, flags))
+        {
+            count++;
+        }
+        return count;
+    }
+
+
+    /* Times every searcher on the given amount of text and prints a row per needle and
+     * case sensitivity. Returns false if any of them counted differently.
+     */
+    bool measure(int megabytes)
+    {
+        const qint64 bytes = qint64(megabytes) * 1024 * 1024;
+        const QString text = Benchmark::sampleText(int(bytes / int(sizeof(QChar))));
+        const int runs = Benchmark::runsFor(bytes);
+
+        QTextDocument document;
+        document.setPlainText(text);
+
+        // The sample text repeats every 64K characters, so each of its lines matches at least once per repetition
+        const QList<Needle> needles =
+        {
+            {"short", "count"},
+            {"medium", "std::vector<int>"},
+            {"long", longestLine(text, 64 * 1024)},
+            {"periodic", QString(12, ' ') + "nullptr"}
+        };
+
+        Benchmark::out() << endl << megabytes << " MB" << endl;
+        Benchmark::printRow({"Needle", "Case", "Matches", "QTextDocument", "indexOf", "Two-Way", "LiteralSearch", "Throughput"});
+
+        for(const Needle &needle : needles)
+        {
+            for(Qt::CaseSensitivity sensitivity : {Qt::CaseSensitive, Qt::CaseInsensitive})
+            {
+                const LiteralSearcher literalSearcher(needle.text, sensitivity);
+                const TwoWaySearcher twoWaySearcher(needle.text, sensitivity);
+                int inDocument = 0, withIndexOf = 0, withTwoWay = 0, withLiteralSearcher = 0;
+
+                double documentTime = Benchmark::bestMilliseconds(runs, [&]{ inDocument = countInDocument(needle.text, sensitivity, document); });
+                double indexOfTime = Benchmark::bestMilliseconds(runs, [&]{ withIndexOf = countWithIndexOf(needle.text, sensitivity, text); });
+                double twoWayTime = Benchmark::bestMilliseconds(runs, [&]{ withTwoWay = countMatches(twoWaySearcher, text, needle.text.length()); });
+                double literalTime = Benchmark::bestMilliseconds(runs, [&]{ withLiteralSearcher = countMatches(literalSearcher, text, needle.text.length()); });
+
+                Benchmark::printRow({needle.name, sensitivity == Qt::CaseSensitive ? "sensitive" : "insensitive",
+                                     QString::number(withLiteralSearcher), Benchmark::milliseconds(documentTime),
+                                     Benchmark::milliseconds(indexOfTime), Benchmark::milliseconds(twoWayTime),
+                                     Benchmark::milliseconds(literalTime), Benchmark::throughput(bytes, literalTime)});
+
+                if(inDocument != withLiteralSearcher || withIndexOf != withLiteralSearcher || withTwoWay != withLiteralSearcher)
+                {
+                    Benchmark::out() << "Match counts differ: QTextDocument " << inDocument << ", indexOf " << withIndexOf
+                                     << ", Two-Way " << withTwoWay << ", LiteralSearcher " << withLiteralSearcher << endl;
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication application(argc, argv);
+    const QList<int> sizes = Benchmark::megabytesFromArguments(application.arguments(), {1, 100});
+
+    for(int megabytes : sizes)
+    {
+        try
+        {
+            if(!measure(megabytes))
+            {
+                return 1;
+            }
+        }
+        catch(const std::bad_alloc &)
+        {
+            Benchmark::out() << endl << megabytes << " MB skipped: not enough memory" << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "twowaysearcher.h"
+#include <QtAlgorithms>
+#include <algorithm>
+
+
+/* Prepares to search for the given needle by finding its critical factorization: the
+ * later of its maximal suffixes under the two opposite orderings of characters.
+ * @param needle - the text to search for
+ * @param sensitivity - whether the search should heed the case of results
+ */
+TwoWaySearcher::TwoWaySearcher(const QString &needle, Qt::CaseSensitivity sensitivity)
+    : needle(needle), foldCase(sensitivity == Qt::CaseInsensitive)
+{
+    for(int i = 0; foldCase && i < this->needle.length(); i++)
+    {
+        this->needle[i] = QChar(fold(this->needle.at(i).unicode()));
+    }
+
+    int forwardPeriod = 1;
+    int reversedPeriod = 1;
+    int forwardSplit = maximalSuffix(false, &forwardPeriod);
+    int reversedSplit = maximalSuffix(true, &reversedPeriod);
+
+    split = qMax(forwardSplit, reversedSplit);
+    period = forwardSplit > reversedSplit ? forwardPeriod : reversedPeriod;
+
+    // The left part repeats at the period, so the period is the needle's own
+    const ushort *characters = this->needle.utf16();
+    periodic = period + split + 1 <= this->needle.length() &&
+               std::equal(characters, characters + split + 1, characters + period);
+
+    if(!periodic)
+    {
+        period = qMax(split + 1, this->needle.length() - split - 1) + 1;
+    }
+}
+
+
+/* Returns the index just before the needle's maximal suffix under the ordering of
+ * characters given, and stores that suffix's period.
+ * @param reversed - whether to order characters from the largest down
+ * @param period - receives the period of the suffix
+ */
+int TwoWaySearcher::maximalSuffix(bool reversed, int *period) const
+{
+    const ushort *characters = needle.utf16();
+    const int length = needle.length();
+    int suffix = -1;
+    int j = 0;
+    int k = 1;
+    *period = 1;
+
+    while(j + k < length)
+    {
+        ushort candidate = characters[j + k];
+        ushort current = characters[suffix + k];
+
+        if(reversed ? candidate > current : candidate < current)
+        {
+            j += k;
+            k = 1;
+            *period = j - suffix;
+        }
+        else if(candidate == current)
+        {
+            if(k != *period)
+            {
+                k++;
+            }
+            else
+            {
+                j += *period;
+                k = 1;
+            }
+        }
+        else
+        {
+            suffix = j;
+            j = suffix + 1;
+            k = 1;
+            *period = 1;
+        }
+    }
+
+    return suffix;
+}
+
+
+/* Returns the index of the first occurrence of the needle in the given text at or after
+ * the given index, or -1 if there is none.
+ * @param text - the first UTF-16 code unit to search
+ * @param length - the number of code units to search
+ * @param from - the index to start searching at
+ */
+int TwoWaySearcher::indexIn(const ushort *text, int length, int from) const
+{
+    const ushort *characters = needle.utf16();
+    const int needleLength = needle.length();
+
+    if(needleLength == 0 || from < 0)
+    {
+        return -1;
+    }
+
+    // How much of the left part is known to match after a shift by the period
+    int memory = -1;
+
+    for(int j = from; j + needleLength <= length;)
+    {
+        int i = qMax(split, memory) + 1;
+
+        while(i < needleLength && characters[i] == fold(text[j + i]))
+        {
+            i++;
+        }
+
+        if(i < needleLength)
+        {
+            j += i - split;
+            memory = -1;
+            continue;
+        }
+
+        i = split;
+
+        while(i > memory && characters[i] == fold(text[j + i]))
+        {
+            i--;
+        }
+
+        if(i <= memory)
+        {
+            return j;
+        }
+
+        j += period;
+        memory = periodic ? needleLength - period - 1 : -1;
+    }
+
+    return -1;
+}
@@ -0,0 +1,38 @@
+#ifndef TWOWAYSEARCHER_H
+#define TWOWAYSEARCHER_H
+#include <QString>
+
+
+/* Finds literal text with the Two-Way algorithm (Crochemore and Perrin): the needle is
+ * split at a critical position, the right part is matched left to right and the left
+ * part right to left, and a mismatch shifts the needle by the distance matched or by
+ * the needle's period. It needs no tables and never looks at a text character more than
+ * twice, so it does well on long and repetitive needles, where LiteralSearcher's
+ * first/last character filter lets through many candidates that only fail late.
+ *
+ * Only here to compare LiteralSearcher against; it folds case the same way, ASCII
+ * letters only.
+ */
+class TwoWaySearcher
+{
+public:
+    TwoWaySearcher(const QString &needle, Qt::CaseSensitivity sensitivity);
+
+    int indexIn(const ushort *text, int length, int from) const;
+
+private:
+    inline ushort fold(ushort character) const
+    {
+        return foldCase && character >= 'A' && character <= 'Z' ? character | 0x20 : character;
+    }
+
+    int maximalSuffix(bool reversed, int *period) const;
+
+    QString needle;
+    bool foldCase;
+    int split;      // The last index of the needle's left part; -1 if that part is empty
+    int period;
+    bool periodic;  // Whether the left part occurs again at the needle's period
+};
+
+#endif // TWOWAYSEARCHER_H
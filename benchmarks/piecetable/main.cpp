@@ -0,0 +1,266 @@
+#include "benchmark.h"
+#include "fileloader.h"
+#include "piecetable.h"
+#include "utilityfunctions.h"
+#include <QGuiApplication>
+#include <QTemporaryFile>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <new>
+
+
+/* Compares PieceTable with QTextDocument, the storage the editor uses, on a file of
+ * each size given on the command line in megabytes (10 and 100 by default). Both open the
+ * file, then make the same random edits and lookups at the same QChar positions:
+ * inserting a word, deleting a word, reading 64 characters and finding the start of a
+ * line. Memory is how much the process's resident set grew while opening the file, per
+ * megabyte of file; for the table, that includes the pages of the mapped file it read.
+ * The file has Windows line endings, which both leave out of positions, and the two must
+ * end up with the same text, read the same characters and find the same line starts, or
+ * the benchmark fails.
+ *
+ * QTextDocument needs a QGuiApplication; run with -platform offscreen where there's no
+ * display.
+ */
+namespace
+{
+    const int operationCount = 10000;
+    const int readLength = 64;
+    const QString insertedText = "word ";
+
+
+    /* Fills the given file with about the given number of megabytes of sample text. */
+    bool writeSampleFile(QTemporaryFile *file, int megabytes)
+    {
+        const QByteArray chunk = Benchmark::sampleText(1024 * 1024).replace("\n", "\r\n").toUtf8();
+
+        if(!file->open())
+        {
+            return false;
+        }
+
+        for(int i = 0; i < megabytes; i++)
+        {
+            if(file->write(chunk) != chunk.size())
+            {
+                return false;
+            }
+        }
+
+        file->close();
+        return true;
+    }
+
+
+    /* Formats how much the resident set grew during a load, per megabyte of the file. */
+    QString memoryPerMegabyte(const FileLoader::Statistics &statistics, double fileMegabytes)
+    {
+        if(!statistics.memoryMeasured())
+        {
+            return "-";
+        }
+
+        double grown = (statistics.peakResidentBytes - statistics.residentBytesBefore) / (1024.0 * 1024.0);
+        return QString::number(grown / fileMegabytes, 'f', 2) + " MB";
+    }
+
+
+    void printRow(const QString &operation, double documentTime, double tableTime)
+    {
+        Benchmark::printRow({operation, Benchmark::milliseconds(documentTime), Benchmark::milliseconds(tableTime), Benchmark::ratio(documentTime, tableTime)});
+    }
+
+
+    bool fail(const QString &problem)
+    {
+        Benchmark::out() << problem << endl;
+        return false;
+    }
+
+
+    /* Opens a file of the given size both ways, times the edits and lookups on each and
+     * prints a row per operation. Returns false if the two disagree.
+     */
+    bool measure(int megabytes)
+    {
+        QTemporaryFile file;
+        QString errorString;
+
+        if(!writeSampleFile(&file, megabytes))
+        {
+            return fail("Couldn't write the sample file: " + file.errorString());
+        }
+
+        const double fileMegabytes = file.size() / (1024.0 * 1024.0);
+        bool opened = false;
+
+        PieceTable table;
+        FileLoader::Statistics tableStatistics;
+        tableStatistics.startMeasuringMemory();
+        double tableOpenTime = Benchmark::bestMilliseconds(1, [&]{ opened = table.open(file.fileName(), &errorString); });
+        tableStatistics.stopMeasuringMemory();
+
+        if(!opened)
+        {
+            return fail("PieceTable couldn't open the sample file: " + errorString);
+        }
+
+        QTextDocument document;
+        FileLoader::Statistics documentStatistics;
+        double documentOpenTime = Benchmark::bestMilliseconds(1, [&]{ opened = FileLoader::load(file.fileName(), &document, &errorString, &documentStatistics); });
+
+        if(!opened)
+        {
+            return fail("QTextDocument couldn't open the sample file: " + errorString);
+        }
+
+        const int characterCount = document.characterCount() - 1;
+        if(table.characterCount() != characterCount)
+        {
+            return fail(QString("QTextDocument has %1 characters, but PieceTable has %2").arg(characterCount).arg(table.characterCount()));
+        }
+
+        Benchmark::Random random(7);
+        QVector<int> insertions, deletions, reads, lines;
+
+        for(int i = 0; i < operationCount; i++)
+        {
+            insertions.append(random.below(characterCount + i * insertedText.length() + 1));
+        }
+        for(int i = 0; i < operationCount; i++)
+        {
+            deletions.append(random.below(characterCount + (operationCount - i) * insertedText.length() - insertedText.length() + 1));
+        }
+        for(int i = 0; i < operationCount; i++)
+        {
+            reads.append(random.below(characterCount - readLength + 1));
+        }
+
+        QTextCursor cursor(&document);
+
+        double documentInsertTime = Benchmark::bestMilliseconds(1, [&]{
+            for(int position : insertions)
+            {
+                cursor.setPosition(position);
+                cursor.insertText(insertedText);
+            }
+        });
+
+        double tableInsertTime = Benchmark::bestMilliseconds(1, [&]{
+            for(int position : insertions)
+            {
+                table.insertCharacters(position, insertedText);
+            }
+        });
+
+        double documentDeleteTime = Benchmark::bestMilliseconds(1, [&]{
+            for(int position : deletions)
+            {
+                cursor.setPosition(position);
+                cursor.setPosition(position + insertedText.length(), QTextCursor::KeepAnchor);
+                cursor.removeSelectedText();
+            }
+        });
+
+        double tableDeleteTime = Benchmark::bestMilliseconds(1, [&]{
+            for(int position : deletions)
+            {
+                table.removeCharacters(position, insertedText.length());
+            }
+        });
+
+        QStringList documentReads, tableReads;
+
+        double documentReadTime = Benchmark::bestMilliseconds(1, [&]{
+            for(int position : reads)
+            {
+                cursor.setPosition(position);
+                cursor.setPosition(position + readLength, QTextCursor::KeepAnchor);
+                documentReads.append(cursor.selectedText().replace(QChar::ParagraphSeparator, '\n'));
+            }
+        });
+
+        double tableReadTime = Benchmark::bestMilliseconds(1, [&]{
+            for(int position : reads)
+            {
+                tableReads.append(table.characters(position, readLength));
+            }
+        });
+
+        // Deleting words joins lines, so lines are picked once the edits are done
+        if(table.lineCount() != document.blockCount())
+        {
+            return fail(QString("QTextDocument has %1 lines, but PieceTable has %2").arg(document.blockCount()).arg(table.lineCount()));
+        }
+
+        for(int i = 0; i < operationCount; i++)
+        {
+            lines.append(random.below(document.blockCount()));
+        }
+
+        QVector<qint64> documentLineStarts, tableLineStarts;
+
+        double documentLineTime = Benchmark::bestMilliseconds(1, [&]{
+            for(int line : lines)
+            {
+                documentLineStarts.append(document.findBlockByNumber(line).position());
+            }
+        });
+
+        double tableLineTime = Benchmark::bestMilliseconds(1, [&]{
+            for(int line : lines)
+            {
+                tableLineStarts.append(table.characterPosition(table.lineStart(line)));
+            }
+        });
+
+        Benchmark::out() << endl << QString::number(fileMegabytes, 'f', 1) << " MB file, " << operationCount << " operations each" << endl;
+        Benchmark::printRow({"", "QTextDocument", "PieceTable", "Speedup"});
+        printRow("Open", documentOpenTime, tableOpenTime);
+        printRow("Insert", documentInsertTime, tableInsertTime);
+        printRow("Delete", documentDeleteTime, tableDeleteTime);
+        printRow("Read", documentReadTime, tableReadTime);
+        printRow("Line lookup", documentLineTime, tableLineTime);
+        Benchmark::printRow({"Memory per MB", memoryPerMegabyte(documentStatistics, fileMegabytes), memoryPerMegabyte(tableStatistics, fileMegabytes)});
+
+        if(documentReads != tableReads)
+        {
+            return fail("PieceTable read different characters than QTextDocument");
+        }
+        if(documentLineStarts != tableLineStarts)
+        {
+            return fail("PieceTable found different line starts than QTextDocument");
+        }
+        if(document.toPlainText() != table.characters(0, table.characterCount()))
+        {
+            return fail("PieceTable ended up with different text than QTextDocument");
+        }
+
+        return true;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication application(argc, argv);
+    const QList<int> sizes = Benchmark::megabytesFromArguments(application.arguments(), {10, 100});
+
+    for(int megabytes : sizes)
+    {
+        try
+        {
+            if(!measure(megabytes))
+            {
+                return 1;
+            }
+        }
+        catch(const std::bad_alloc &)
+        {
+            Benchmark::out() << endl << megabytes << " MB skipped: not enough memory" << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+include(../benchmarks.pri)
+
+QT += widgets
+
+TARGET = piecetablebenchmark
+TEMPLATE = app
+
+SOURCES += \
+    main.cpp \
+    $$EDITOR/piecetable.cpp \
+    $$EDITOR/fileloader.cpp \
+    $$EDITOR/textcounter.cpp \
+    $$EDITOR/linediff.cpp \
+    $$EDITOR/undohistory.cpp \
+    $$EDITOR/utilityfunctions.cpp
+
+HEADERS += \
+    $$EDITOR/piecetable.h \
+    $$EDITOR/fileloader.h \
+    $$EDITOR/textcounter.h \
+    $$EDITOR/documentmetrics.h \
+    $$EDITOR/linediff.h \
+    $$EDITOR/undohistory.h \
+    $$EDITOR/utilityfunctions.h
+
+# Peak memory reporting (GetProcessMemoryInfo)
+win32: LIBS += -lpsapi
@@ -0,0 +1,177 @@
+#include "benchmark.h"
+#include "textcounter.h"
+#include <QCoreApplication>
+#include <QVariant>
+#include <cctype>
+#include <new>
+
+
+/* Compares TextCounter::count with the loops it replaced, on sample text of each size
+ * given on the command line in megabytes (1, 100 and 1024 by default). A size is the
+ * size of the text in memory, two bytes per UTF-16 code unit.
+ *
+ * "old loop" is the editor's original updateFileMetrics, which rescanned the whole
+ * document after every edit; "scalar" is a plain loop with TextCounter's semantics, and
+ * its counts must agree with TextCounter's or the benchmark fails.
+ */
+namespace
+{
+    /* The original Editor::updateFileMetrics, minus the editor: a UTF-8 round trip of the
+     * whole text, then a loop that builds each word up in a QString.
+     */
+    DocumentMetrics countLikeOldLoop(const QString &text)
+    {
+        QString documentContents = text.toUtf8();
+        int documentLength = documentContents.length();
+        DocumentMetrics metrics;
+        QString currentWord = "";
+
+        for(int i = 0; i < documentLength; i++)
+        {
+            unsigned char currentCharacter = qvariant_cast<unsigned char>(documentContents[i].toLatin1());
+
+            if(currentCharacter == '\n')
+            {
+                if(!currentWord.isEmpty())
+                {
+                    metrics.wordCount++;
+                    currentWord.clear();
+                }
+            }
+            else
+            {
+                metrics.charCount++;
+
+                if(isalnum(currentCharacter))
+                {
+                    currentWord += qvariant_cast<char>(currentCharacter);
+                }
+                else if(isspace(currentCharacter))
+                {
+                    if(!currentWord.isEmpty())
+                    {
+                        metrics.wordCount++;
+                        currentWord.clear();
+                    }
+                    else
+                    {
+                        while(i + 1 < documentLength &&
+                              isspace(qvariant_cast<unsigned char>(documentContents[i + 1].toLatin1())))
+                        {
+                            i++;
+                        }
+                    }
+                }
+            }
+        }
+
+        if(!currentWord.isEmpty())
+        {
+            metrics.wordCount++;
+        }
+
+        return metrics;
+    }
+
+
+    /* Counts one character at a time, with the same rules as TextCounter. */
+    DocumentMetrics countScalar(const QString &text)
+    {
+        DocumentMetrics metrics;
+        bool inWord = false;
+
+        for(int i = 0; i < text.length(); i++)
+        {
+            ushort character = text.at(i).unicode();
+            bool whitespace = character == ' ' || (character >= '\t' && character <= '\r');
+            bool alphanumeric = (character >= '0' && character <= '9') ||
+                                ((character | 0x20) >= 'a' && (character | 0x20) <= 'z');
+
+            if(character == '\n')
+            {
+                metrics.lineCount++;
+            }
+            else
+            {
+                metrics.charCount++;
+            }
+
+            if(whitespace)
+            {
+                inWord = false;
+            }
+            else if(alphanumeric && !inWord)
+            {
+                metrics.wordCount++;
+                inWord = true;
+            }
+        }
+
+        return metrics;
+    }
+
+
+    bool sameCounts(const DocumentMetrics &first, const DocumentMetrics &second)
+    {
+        return first.charCount == second.charCount &&
+               first.wordCount == second.wordCount &&
+               first.lineCount == second.lineCount;
+    }
+
+
+    /* Times every counter on the given amount of text and prints a row of results.
+     * Returns false if TextCounter and the scalar loop disagree.
+     */
+    bool measure(int megabytes)
+    {
+        const qint64 bytes = qint64(megabytes) * 1024 * 1024;
+        const QString text = Benchmark::sampleText(int(bytes / int(sizeof(QChar))));
+        const int runs = Benchmark::runsFor(bytes);
+
+        DocumentMetrics old, scalar, vectorized;
+        double oldTime = Benchmark::bestMilliseconds(runs, [&]{ old = countLikeOldLoop(text); });
+        double scalarTime = Benchmark::bestMilliseconds(runs, [&]{ scalar = countScalar(text); });
+        double vectorizedTime = Benchmark::bestMilliseconds(runs, [&]{ vectorized = TextCounter::count(text); });
+
+        Benchmark::printRow({QString::number(megabytes) + " MB", Benchmark::milliseconds(oldTime),
+                             Benchmark::milliseconds(scalarTime), Benchmark::milliseconds(vectorizedTime),
+                             Benchmark::throughput(bytes, vectorizedTime), Benchmark::ratio(oldTime, vectorizedTime),
+                             Benchmark::ratio(scalarTime, vectorizedTime)});
+
+        if(!sameCounts(scalar, vectorized))
+        {
+            Benchmark::out() << "TextCounter counted " << vectorized.charCount << " characters, " << vectorized.wordCount
+                             << " words and " << vectorized.lineCount << " lines, but the scalar loop counted "
+                             << scalar.charCount << ", " << scalar.wordCount << " and " << scalar.lineCount << endl;
+            return false;
+        }
+
+        return true;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    const QList<int> sizes = Benchmark::megabytesFromArguments(application.arguments(), {1, 100, 1024});
+
+    Benchmark::printRow({"Size", "Old loop", "Scalar", "TextCounter", "Throughput", "vs old loop", "vs scalar"});
+
+    for(int megabytes : sizes)
+    {
+        try
+        {
+            if(!measure(megabytes))
+            {
+                return 1;
+            }
+        }
+        catch(const std::bad_alloc &)
+        {
+            Benchmark::printRow({QString::number(megabytes) + " MB", "skipped: not enough memory"});
+        }
+    }
+
+    return 0;
+}
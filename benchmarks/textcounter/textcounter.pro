@@ -0,0 +1,12 @@
+include(../benchmarks.pri)
+
+TARGET = textcounterbenchmark
+TEMPLATE = app
+
+SOURCES += \
+    main.cpp \
+    $$EDITOR/textcounter.cpp
+
+HEADERS += \
+    $$EDITOR/textcounter.h \
+    $$EDITOR/documentmetrics.h